@@ -0,0 +1,31 @@
+//  Instinct Reactive Planning Library
+//  Minimal stand in for the Arduino core, so that the planner can be built and benchmarked on a Linux host
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef _INSTINCT_BENCHMARK_ARDUINO_H_
+#define _INSTINCT_BENCHMARK_ARDUINO_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// program memory is ordinary memory on the host
+#define PROGMEM
+#define sscanf_P sscanf
+#define snprintf_P snprintf
+
+#endif // _INSTINCT_BENCHMARK_ARDUINO_H_
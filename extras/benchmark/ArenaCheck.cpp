@@ -0,0 +1,220 @@
+//  Instinct Reactive Planning Library
+//  Check that a plan fits in an arena buffer of planArenaSize() bytes, and never in one any smaller
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each generated plan is loaded into a Planner whose Allocator always fails, so that the plan can only come from the
+// arena buffer given by setArenaBuffer(), which is exactly planArenaSize() bytes. The plan must load at every offset
+// of the buffer from an INSTINCT_ARENA_ALIGN boundary, and nothing outside the buffer may be written. Where the buffer
+// is furthest from alignment, the plan is run alongside the same plan loaded onto the heap, and the trace of the
+// Actions each executes, the world's checksum after every cycle, must be the same. There a buffer one byte smaller
+// must make initialisePlan() fail, leaving an empty plan that runs nothing, and that buffer must not be written past
+// its end either. The Allocator must never be asked for memory.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp ArenaCheck.cpp -o ArenaCheck
+//    ./ArenaCheck [plans] [cycles]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+#define CHECK_GUARD		0x5A // fills the memory around the arena buffer, which must not change
+
+// an Allocator with no memory, counting the requests it refuses
+class FailingAllocator : public Allocator {
+public:
+	unsigned long ulRequests;
+	FailingAllocator() { ulRequests = 0; }
+	void * allocate(const unsigned long)
+	{
+		ulRequests++;
+		return 0;
+	}
+	void release(void *) {}
+};
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+// load the plan, returning the number of commands refused
+static unsigned int loadCommands(CmdPlanner *pPlan, const CommandListType *pList)
+{
+	char szRtn[20];
+	unsigned int uiRefused = 0;
+
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+	{
+		if (!pPlan->executeCommand(pList->pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn)))
+			uiRefused++;
+	}
+
+	return uiRefused;
+}
+
+// true if the memory either side of the arena buffer still holds the guard
+static unsigned char guardKept(const unsigned char *pBlock, const unsigned long ulBlockSize, const unsigned char *pBuffer,
+	const unsigned long ulBufferSize)
+{
+	for (const unsigned char *p = pBlock; p < pBuffer; p++)
+	{
+		if (*p != CHECK_GUARD)
+			return false;
+	}
+	for (const unsigned char *p = pBuffer + ulBufferSize; p < pBlock + ulBlockSize; p++)
+	{
+		if (*p != CHECK_GUARD)
+			return false;
+	}
+
+	return true;
+}
+
+// run a plan cycle, with a timer tick before it as a robot would, and return the trace so far
+static unsigned long runCycle(CmdPlanner *pPlan, ScriptedWorldType *pWorld)
+{
+	pPlan->processTimers(1);
+	pPlan->runPlan();
+
+	return pWorld->ulChecksum ^ (pWorld->ulActions << 16);
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiPlans = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int uiCycles = argc > 2 ? atoi(argv[2]) : 1000;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	unsigned long ulCycles = 0;
+	unsigned long ulFailed = 0;
+	unsigned long ulLoadFailed = 0;
+	unsigned long ulShortFailed = 0;
+	FailingAllocator sAllocator;
+
+	for (unsigned int p = 1; p <= uiPlans; p++)
+	{
+		CommandListType sList;
+		ScriptedWorldType sWorld, sArenaWorld;
+		ScriptedSenses senses(&sWorld), arenaSenses(&sArenaWorld);
+		ScriptedActions actions(&sWorld), arenaActions(&sArenaWorld);
+		unsigned int uiPlanSize[INSTINCT_NODE_TYPES];
+		instinctID nPlanSize[INSTINCT_NODE_TYPES];
+
+		planGenDefaults(&sParams);
+		sParams.ulSeed = p;
+		sParams.uiDrives = 1 + p % 8;
+		sParams.uiDepth = p % 4;
+		memset(&sList, 0, sizeof(sList));
+		if (!planGenerate(&sParams, addCommand, &sList))
+			continue;
+
+		// the "R I" command that starts the plan gives the size of each plan buffer
+		if (sscanf(sList.pLines, "R I %u %u %u %u %u %u", uiPlanSize, uiPlanSize + 1, uiPlanSize + 2, uiPlanSize + 3,
+			uiPlanSize + 4, uiPlanSize + 5) != INSTINCT_NODE_TYPES)
+		{
+			ulLoadFailed++;
+			free((void *)sList.pLines);
+			continue;
+		}
+		for (unsigned int i = 0; i < INSTINCT_NODE_TYPES; i++)
+			nPlanSize[i] = (instinctID)uiPlanSize[i];
+		unsigned long ulArenaSize = CmdPlanner::planArenaSize(nPlanSize);
+
+		// room for the buffer at any offset from an aligned start, with guard memory either side
+		unsigned long ulBlockSize = ulArenaSize + 3 * INSTINCT_ARENA_ALIGN;
+		unsigned char *pBlock = (unsigned char *)malloc(ulBlockSize);
+		if (!pBlock)
+			return 1;
+		unsigned char *pAligned = pBlock + INSTINCT_ARENA_ALIGN - (size_t)pBlock % INSTINCT_ARENA_ALIGN;
+
+		CmdPlanner *pArena = new CmdPlanner(nNoPlan, &arenaSenses, &arenaActions, 0);
+		pArena->setAllocator(&sAllocator);
+		for (unsigned int uiOffset = 0; uiOffset < INSTINCT_ARENA_ALIGN; uiOffset++)
+		{
+			memset(pBlock, CHECK_GUARD, ulBlockSize);
+			pArena->setArenaBuffer(pAligned + uiOffset, ulArenaSize);
+			if (loadCommands(pArena, &sList) || !guardKept(pBlock, ulBlockSize, pAligned + uiOffset, ulArenaSize))
+			{
+				if (ulLoadFailed++ < 10)
+					printf("# plan %u does not load at offset %u\n", p, uiOffset);
+			}
+		}
+
+		// one byte past an aligned start the buffer has the most to skip, so must be all planArenaSize() allows for
+		memset(pBlock, CHECK_GUARD, ulBlockSize);
+		pArena->setArenaBuffer(pAligned + 1, ulArenaSize);
+		loadCommands(pArena, &sList);
+		memset(&sWorld, 0, sizeof(sWorld));
+		sWorld.ulSeed = p;
+		sArenaWorld = sWorld;
+		CmdPlanner *pPlan = new CmdPlanner(nNoPlan, &senses, &actions, 0);
+		loadCommands(pPlan, &sList);
+		for (unsigned int i = 0; i < uiCycles; i++)
+		{
+			ulCycles++;
+			if (runCycle(pPlan, &sWorld) != runCycle(pArena, &sArenaWorld))
+			{
+				if (ulFailed++ < 10)
+					printf("# plan %u differs at cycle %u\n", p, i);
+			}
+		}
+		if (!guardKept(pBlock, ulBlockSize, pAligned + 1, ulArenaSize))
+		{
+			if (ulFailed++ < 10)
+				printf("# plan %u writes outside its arena buffer\n", p);
+		}
+
+		// a byte less is not enough, and leaves an empty plan. Every command but the closing "L P" is refused
+		memset(pBlock, CHECK_GUARD, ulBlockSize);
+		pArena->setArenaBuffer(pAligned + 1, ulArenaSize - 1);
+		unsigned char bClean = !pArena->initialisePlan(nPlanSize) && (loadCommands(pArena, &sList) == sList.uiLines - 1) &&
+			!pArena->maxElementID() && (pArena->runPlan() != INSTINCT_SUCCESS) && !pArena->arenaSize() &&
+			guardKept(pBlock, ulBlockSize, pAligned + 1, ulArenaSize - 1);
+		if (!bClean)
+		{
+			if (ulShortFailed++ < 10)
+				printf("# plan %u does not fail cleanly in %lu bytes\n", p, ulArenaSize - 1);
+		}
+
+		delete pPlan;
+		delete pArena;
+		free((void *)pBlock);
+		free((void *)sList.pLines);
+	}
+
+	printf("plans,cycles,cycles_differing,loads_failed,short_loads_not_failed,allocator_requests\n");
+	printf("%u,%lu,%lu,%lu,%lu,%lu\n", uiPlans, ulCycles, ulFailed, ulLoadFailed, ulShortFailed, sAllocator.ulRequests);
+
+	return (ulFailed || ulLoadFailed || ulShortFailed || sAllocator.ulRequests) ? 1 : 0;
+}
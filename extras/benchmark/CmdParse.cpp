@@ -0,0 +1,208 @@
+//  Instinct Reactive Planning Library
+//  Benchmark of the CmdPlanner command parser against sscanf
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// CmdPlanner::parseCommand() is timed against the sscanf() call that executeCommand() used before, over the
+// commands of a generated plan and display commands for each of its elements. Loading the whole plan through
+// executeCommand() is timed as well.
+//
+// Before timing, both parsers are run over the same commands and over random strings of command characters,
+// digits, signs and white space. They must agree on every result that executeCommand() acts upon - whether
+// the command has exactly the number of parameters it needs, or fewer, and the values of those read.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp CmdParse.cpp -o CmdParse
+//    ./CmdParse [drives] [random strings]
+
+#include <chrono>
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+static int scanCommand(const char *pCmd, char *pCmdChars, int *pParams)
+{
+	return sscanf(pCmd, "%c %c %i %i %i %i %i %i %i %i %i %i %i %i", &pCmdChars[0], &pCmdChars[1], &pParams[0], &pParams[1],
+		&pParams[2], &pParams[3], &pParams[4], &pParams[5], &pParams[6], &pParams[7], &pParams[8], &pParams[9], &pParams[10], &pParams[11]);
+}
+
+// the number of parameters parseCommand() reads for a command, found by giving it more than any command takes
+static int commandParams(const char *pCmdChars)
+{
+	char szCmd[64];
+	char cCmd[2];
+	int nParams[INSTINCT_MAX_COMMAND_PARAMS];
+
+	snprintf(szCmd, sizeof(szCmd), "%c %c 1 2 3 4 5 6 7 8 9 10 11 12 13", pCmdChars[0], pCmdChars[1]);
+	int nRtn = CmdPlanner::parseCommand(szCmd, cCmd, nParams);
+
+	return (nRtn > INSTINCT_MAX_COMMAND_PARAMS + 1) ? INSTINCT_MAX_COMMAND_PARAMS : nRtn - 3;
+}
+
+// true if both parsers lead executeCommand() to do the same thing with the command
+static unsigned char sameResult(const char *pCmd)
+{
+	char cScan[2] = { 0, 0 };
+	char cParse[2] = { 0, 0 };
+	int nScan[INSTINCT_MAX_COMMAND_PARAMS];
+	int nParse[INSTINCT_MAX_COMMAND_PARAMS];
+
+	memset(nScan, 0, sizeof(nScan));
+	memset(nParse, 0, sizeof(nParse));
+	int nScanRtn = scanCommand(pCmd, cScan, nScan);
+	int nParseRtn = CmdPlanner::parseCommand(pCmd, cParse, nParse);
+
+	if ((nScanRtn < 2) || (nParseRtn < 2))
+		return ((nScanRtn < 2) && (nParseRtn < 2)) ? true : false;
+	if ((cScan[0] != cParse[0]) || (cScan[1] != cParse[1]))
+		return false;
+
+	int nParams = commandParams(cParse);
+	for (int i = 2; i <= nParams + 2; i++)
+	{
+		if ((nScanRtn == i) != (nParseRtn == i))
+			return false;
+	}
+	for (int i = 0; i < nParams; i++)
+	{
+		if (nScan[i] != nParse[i])
+			return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	CommandListType sList;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	unsigned long ulRandom = 12345;
+	unsigned long ulFailed = 0;
+	char szCmd[48];
+
+	planGenDefaults(&sParams);
+	sParams.uiDrives = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned long ulStrings = argc > 2 ? strtoul(argv[2], 0, 10) : 1000000;
+
+	memset(&sList, 0, sizeof(sList));
+	if (!planGenerate(&sParams, addCommand, &sList))
+	{
+		printf("the plan is too large\n");
+		return 1;
+	}
+	for (unsigned long ulID = 1; ulID <= planGenSize(&sParams, 0); ulID++)
+	{
+		snprintf(szCmd, sizeof(szCmd), "D N %lu", ulID);
+		addCommand(&sList, szCmd);
+		snprintf(szCmd, sizeof(szCmd), "D C %lu", ulID);
+		addCommand(&sList, szCmd);
+	}
+
+	// the two parsers must agree before there is any point in timing them
+	for (unsigned int i = 0; i < sList.uiLines; i++)
+	{
+		if (!sameResult(sList.pLines + i * PLANGEN_LINE_LENGTH))
+		{
+			if (ulFailed++ < 10)
+				printf("# differs: [%s]\n", sList.pLines + i * PLANGEN_LINE_LENGTH);
+		}
+	}
+	static const char szChars[] = "ADCPELMNGRISHWVUXx0123456789abfAF+-  \t";
+	for (unsigned long j = 0; j < ulStrings; j++)
+	{
+		unsigned int uiLength = (unsigned int)planGenRandom(&ulRandom, sizeof(szCmd) - 1);
+		for (unsigned int k = 0; k < uiLength; k++)
+			szCmd[k] = szChars[planGenRandom(&ulRandom, sizeof(szChars) - 1)];
+		szCmd[uiLength] = 0;
+		if (!sameResult(szCmd))
+		{
+			if (ulFailed++ < 10)
+				printf("# differs: [%s]\n", szCmd);
+		}
+	}
+	if (ulFailed)
+	{
+		printf("%lu commands were parsed differently\n", ulFailed);
+		return 1;
+	}
+
+	char cCmd[2];
+	int nParams[INSTINCT_MAX_COMMAND_PARAMS];
+	unsigned long ulCheck = 0;
+	unsigned int uiRepeats = 20;
+
+	printf("parser,commands,ns_per_command\n");
+
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+	for (unsigned int r = 0; r < uiRepeats; r++)
+	{
+		for (unsigned int i = 0; i < sList.uiLines; i++)
+			ulCheck += scanCommand(sList.pLines + i * PLANGEN_LINE_LENGTH, cCmd, nParams) + nParams[0];
+	}
+	double dScan = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count();
+	printf("sscanf,%u,%.1f\n", sList.uiLines, dScan / uiRepeats / sList.uiLines);
+
+	tStart = std::chrono::steady_clock::now();
+	for (unsigned int r = 0; r < uiRepeats; r++)
+	{
+		for (unsigned int i = 0; i < sList.uiLines; i++)
+			ulCheck += CmdPlanner::parseCommand(sList.pLines + i * PLANGEN_LINE_LENGTH, cCmd, nParams) + nParams[0];
+	}
+	double dParse = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count();
+	printf("parseCommand,%u,%.1f\n", sList.uiLines, dParse / uiRepeats / sList.uiLines);
+
+	// load the plan itself, just as a robot would over serial
+	unsigned int uiPlanLines = (unsigned int)planGenSize(&sParams, 0) + 2; // with the R I and L P commands
+	char szRtn[20];
+	tStart = std::chrono::steady_clock::now();
+	for (unsigned int r = 0; r < uiRepeats; r++)
+	{
+		CmdPlanner *pPlan = new CmdPlanner(nNoPlan, 0, 0, 0);
+		for (unsigned int i = 0; i < uiPlanLines; i++)
+			ulCheck += pPlan->executeCommand(sList.pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+		delete pPlan;
+	}
+	double dLoad = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count();
+	printf("executeCommand,%u,%.1f\n", uiPlanLines, dLoad / uiRepeats / uiPlanLines);
+	printf("# speedup %.2f, check %lu\n", dScan / dParse, ulCheck);
+
+	free((void *)sList.pLines);
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+//  Instinct Reactive Planning Library
+//  Check that a plan run from a plan image runs just as the same plan loaded from text
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each generated plan is loaded from text by one Planner, which writes it out with writePlanImage() and is then
+// destroyed. Two more Planners adopt that one image with adoptPlanImage() and run side by side, each in its own
+// scripted world, while a fourth Planner runs the plan loaded from text. The trace of the Actions each executes, the
+// world's checksum after every cycle, must be the same for all three. The image must not be changed by running it.
+// Every other plan is written without its index, so that adoptPlanImage() builds one.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp ImageCheck.cpp -o ImageCheck
+//    ./ImageCheck [plans] [cycles]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+static CmdPlanner * loadCommands(const CommandListType *pList, Senses *pSenses, Actions *pActions)
+{
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	char szRtn[20];
+
+	CmdPlanner *pPlan = new CmdPlanner(nNoPlan, pSenses, pActions, 0);
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+		pPlan->executeCommand(pList->pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+
+	return pPlan;
+}
+
+// run a plan cycle, with a timer tick before it as a robot would, and return the trace so far
+static unsigned long runCycle(CmdPlanner *pPlan, ScriptedWorldType *pWorld)
+{
+	pPlan->processTimers(1);
+	pPlan->runPlan();
+
+	return pWorld->ulChecksum ^ (pWorld->ulActions << 16);
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiPlans = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int uiCycles = argc > 2 ? atoi(argv[2]) : 1000;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	unsigned long ulCycles = 0;
+	unsigned long ulFailed = 0;
+	unsigned long ulImageFailed = 0;
+
+	for (unsigned int p = 1; p <= uiPlans; p++)
+	{
+		CommandListType sList;
+		ScriptedWorldType sWorld[3];
+		ScriptedSenses senses0(sWorld), senses1(sWorld + 1), senses2(sWorld + 2);
+		ScriptedActions actions0(sWorld), actions1(sWorld + 1), actions2(sWorld + 2);
+		unsigned char bIncludeIndex = (p % 2) ? true : false;
+
+		planGenDefaults(&sParams);
+		sParams.ulSeed = p;
+		sParams.uiDrives = 1 + p % 8;
+		sParams.uiDepth = p % 4;
+		memset(&sList, 0, sizeof(sList));
+		if (!planGenerate(&sParams, addCommand, &sList))
+			continue;
+
+		// write the image from a Planner that is gone before the image is run. malloc() aligns it for a PlanElement
+		CmdPlanner *pWriter = loadCommands(&sList, &senses0, &actions0);
+		unsigned long ulImageSize = pWriter->planImageSize(bIncludeIndex);
+		unsigned char *pImage = (unsigned char *)malloc(ulImageSize);
+		unsigned char *pImageCopy = (unsigned char *)malloc(ulImageSize);
+		if (!pImage || !pImageCopy || !pWriter->writePlanImage(pImage, ulImageSize, bIncludeIndex))
+		{
+			if (ulImageFailed++ < 10)
+				printf("# plan %u could not be written\n", p);
+			free((void *)pImageCopy);
+			free((void *)pImage);
+			delete pWriter;
+			free((void *)sList.pLines);
+			continue;
+		}
+		memcpy(pImageCopy, pImage, ulImageSize);
+		delete pWriter;
+
+		CmdPlanner *pText = loadCommands(&sList, &senses0, &actions0);
+		CmdPlanner *pAdopted1 = new CmdPlanner(nNoPlan, &senses1, &actions1, 0);
+		CmdPlanner *pAdopted2 = new CmdPlanner(nNoPlan, &senses2, &actions2, 0);
+		if (!pAdopted1->adoptPlanImage(pImage, ulImageSize) || !pAdopted2->adoptPlanImage(pImage, ulImageSize))
+		{
+			if (ulImageFailed++ < 10)
+				printf("# plan %u could not be adopted\n", p);
+		}
+
+		memset(sWorld, 0, sizeof(sWorld));
+		for (unsigned int w = 0; w < 3; w++)
+			sWorld[w].ulSeed = p;
+		for (unsigned int i = 0; i < uiCycles; i++)
+		{
+			ulCycles++;
+			unsigned long ulTrace = runCycle(pText, sWorld);
+			if ((runCycle(pAdopted1, sWorld + 1) != ulTrace) || (runCycle(pAdopted2, sWorld + 2) != ulTrace))
+			{
+				if (ulFailed++ < 10)
+					printf("# plan %u differs at cycle %u\n", p, i);
+			}
+		}
+
+		// the runtime values are kept apart from the image, so it is only read
+		if (memcmp(pImage, pImageCopy, ulImageSize))
+		{
+			if (ulImageFailed++ < 10)
+				printf("# plan %u changed its image\n", p);
+		}
+
+		delete pAdopted2;
+		delete pAdopted1;
+		delete pText;
+		free((void *)pImageCopy);
+		free((void *)pImage);
+		free((void *)sList.pLines);
+	}
+
+	printf("plans,cycles,cycles_differing,images_failed\n");
+	printf("%u,%lu,%lu,%lu\n", uiPlans, ulCycles, ulFailed, ulImageFailed);
+
+	return (ulFailed || ulImageFailed) ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+//  Instinct Reactive Planning Library
+//  Check the latency histograms against times set by a fake clock
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each generated plan is run by two Planners, each in its own scripted world. One has latency histograms enabled with
+// a Clock that only moves when a sense is read or an Action is called, each by a fixed number of ticks chosen to land
+// on either side of the bucket boundaries. A Monitor2 on that Planner works out the histogram each Action and releaser
+// should have from the notifications it is given. Every Action and releaser histogram from latencyHistogram() must
+// match, and the Drive histograms must count each time the Drive ran. Each "D L" line must list the non zero buckets
+// of the element's histograms, and "D L" must be refused once the histograms are disabled. The trace of the Actions
+// each Planner executes, the world's checksum after every cycle, must be the same.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp LatencyCheck.cpp -o LatencyCheck
+//    ./LatencyCheck [plans] [cycles]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+// the ticks taken by each Action and each sense, to be counted by the Action's ID or the senseID modulo the count
+static const unsigned long ulActionTicks[] = { 0, 1, 2, 3, 4, 7, 8, 15, 16, 255, 256, 16383, 16384, 65536, 1000000 };
+static const unsigned long ulSenseTicks[] = { 1, 2, 5, 6, 100, 1023, 1024, 70000 };
+
+#define CHECK_ACTION_TICKS(nAction)	ulActionTicks[(nAction) % (sizeof(ulActionTicks) / sizeof(unsigned long))]
+#define CHECK_SENSE_TICKS(nSense)	ulSenseTicks[(nSense) % (sizeof(ulSenseTicks) / sizeof(unsigned long))]
+
+// a Clock that is moved on by hand
+class StepClock : public Clock {
+public:
+	unsigned long ulNow;
+	StepClock() { ulNow = 0; }
+	unsigned long readClock(void) { return ulNow; }
+};
+
+class TimedSenses : public ScriptedSenses {
+public:
+	TimedSenses(ScriptedWorldType *pWorld, StepClock *pClock) : ScriptedSenses(pWorld) { _pClock = pClock; }
+	int readSense(const senseID nSense)
+	{
+		_pClock->ulNow += CHECK_SENSE_TICKS(nSense);
+		return ScriptedSenses::readSense(nSense);
+	}
+
+private:
+	StepClock *_pClock;
+};
+
+class TimedActions : public ScriptedActions {
+public:
+	TimedActions(ScriptedWorldType *pWorld, StepClock *pClock) : ScriptedActions(pWorld) { _pClock = pClock; }
+	unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete)
+	{
+		_pClock->ulNow += CHECK_ACTION_TICKS(nAction);
+		return ScriptedActions::executeAction(nAction, nActionValue, bCheckForComplete);
+	}
+
+private:
+	StepClock *_pClock;
+};
+
+// the bucket for a time, from the bucket bounds rather than by shifting as the Planner does
+static unsigned int expectedBucket(const unsigned long ulTicks)
+{
+	unsigned int uiBucket = 0;
+
+	while ((uiBucket < INSTINCT_LATENCY_BUCKETS - 1) && (ulTicks >= (1UL << uiBucket)))
+		uiBucket++;
+
+	return uiBucket;
+}
+
+// builds the histograms each element should have from the notifications of the Planner
+class ExpectedLatency : public Monitor2 {
+public:
+	NodeLatencyType *pExpected;
+	unsigned long *pDriveRuns;
+	unsigned int uiSize;
+	ExpectedLatency(const unsigned int uiElements)
+	{
+		uiSize = uiElements;
+		pExpected = (NodeLatencyType *)calloc(uiSize, sizeof(NodeLatencyType));
+		pDriveRuns = (unsigned long *)calloc(uiSize, sizeof(unsigned long));
+	}
+	~ExpectedLatency()
+	{
+		free((void *)pDriveRuns);
+		free((void *)pExpected);
+	}
+	unsigned char nodeExecuted(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const PlanElement *)
+	{
+		instinctID nID = pElement->sReferences.bRuntime_ElementID;
+		if (bNodeType == INSTINCT_ACTION)
+			pExpected[nID].sExecute.uiCount[expectedBucket(CHECK_ACTION_TICKS(pElement->sAction.bActionID))]++;
+		else if (bNodeType == INSTINCT_DRIVE)
+			pDriveRuns[nID]++;
+		return true;
+	}
+	unsigned char nodeSuccess(const PlanElement *, const RuntimeElement *, const unsigned char, const PlanElement *) { return true; }
+	unsigned char nodeInProgress(const PlanElement *, const RuntimeElement *, const unsigned char, const PlanElement *) { return true; }
+	unsigned char nodeFail(const PlanElement *, const RuntimeElement *, const unsigned char, const PlanElement *) { return true; }
+	unsigned char nodeError(const PlanElement *, const RuntimeElement *, const unsigned char, const PlanElement *) { return true; }
+	unsigned char nodeSense(const PlanElement *pElement, const RuntimeElement *, const unsigned char, const ReleaserType *pReleaser,
+		const int, const PlanElement *)
+	{
+		// TR and FL releasers do not read their sense, so take no time
+		unsigned long ulTicks = 0;
+		if ((pReleaser->bComparator != INSTINCT_COMPARATOR_TR) && (pReleaser->bComparator != INSTINCT_COMPARATOR_FL))
+			ulTicks = CHECK_SENSE_TICKS(pReleaser->bSenseID);
+		pExpected[pElement->sReferences.bRuntime_ElementID].sReleaser.uiCount[expectedBucket(ulTicks)]++;
+		return true;
+	}
+};
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+static CmdPlanner * loadCommands(const CommandListType *pList, Senses *pSenses, Actions *pActions)
+{
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	char szRtn[20];
+
+	CmdPlanner *pPlan = new CmdPlanner(nNoPlan, pSenses, pActions, 0);
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+		pPlan->executeCommand(pList->pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+
+	return pPlan;
+}
+
+// run a plan cycle, with a timer tick before it as a robot would, and return the trace so far
+static unsigned long runCycle(CmdPlanner *pPlan, ScriptedWorldType *pWorld)
+{
+	pPlan->processTimers(1);
+	pPlan->runPlan();
+
+	return pWorld->ulChecksum ^ (pWorld->ulActions << 16);
+}
+
+// true if the histograms of an element are those expected. Only the total is known for a Drive, as its time includes
+// that of everything it runs
+static unsigned char sameHistograms(CmdPlanner *pPlan, const ExpectedLatency *pExpected, const instinctID nID)
+{
+	const LatencyHistogramType *pExecute = pPlan->latencyHistogram(nID, false);
+	const LatencyHistogramType *pReleaser = pPlan->latencyHistogram(nID, true);
+	unsigned long ulRuns = 0;
+
+	if (!pExecute || !pReleaser)
+		return false;
+	for (unsigned int i = 0; i < INSTINCT_LATENCY_BUCKETS; i++)
+	{
+		if (pReleaser->uiCount[i] != pExpected->pExpected[nID].sReleaser.uiCount[i])
+			return false;
+		if (!pExpected->pDriveRuns[nID] && (pExecute->uiCount[i] != pExpected->pExpected[nID].sExecute.uiCount[i]))
+			return false;
+		ulRuns += pExecute->uiCount[i];
+	}
+
+	return (!pExpected->pDriveRuns[nID] || (ulRuns == pExpected->pDriveRuns[nID])) ? true : false;
+}
+
+// true if the "D L" line for an element lists its non zero buckets, execution first
+static unsigned char sameDisplay(CmdPlanner *pPlan, const instinctID nID)
+{
+	char szCmd[20];
+	char szRtn[600];
+	char szExpected[600];
+	int nLen;
+
+	snprintf(szCmd, sizeof(szCmd), "D L %u", (unsigned int)nID);
+	if (!pPlan->executeCommand(szCmd, szRtn, sizeof(szRtn)))
+		return false;
+
+	nLen = snprintf(szExpected, sizeof(szExpected), "%u", (unsigned int)nID);
+	for (unsigned int r = 0; r < 2; r++)
+	{
+		const LatencyHistogramType *pHistogram = pPlan->latencyHistogram(nID, r ? true : false);
+		nLen += snprintf(szExpected + nLen, sizeof(szExpected) - nLen, r ? " R" : " E");
+		for (unsigned int i = 0; i < INSTINCT_LATENCY_BUCKETS; i++)
+		{
+			if (pHistogram->uiCount[i])
+				nLen += snprintf(szExpected + nLen, sizeof(szExpected) - nLen, " %u:%u", i, pHistogram->uiCount[i]);
+		}
+	}
+
+	return strcmp(szRtn, szExpected) ? false : true;
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiPlans = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int uiCycles = argc > 2 ? atoi(argv[2]) : 1000;
+	unsigned long ulCycles = 0;
+	unsigned long ulFailed = 0;
+	unsigned long ulHistogramFailed = 0;
+	unsigned long ulDisplayFailed = 0;
+	unsigned long ulBuckets[INSTINCT_LATENCY_BUCKETS];
+	char szRtn[20];
+
+	memset(ulBuckets, 0, sizeof(ulBuckets));
+	for (unsigned int p = 1; p <= uiPlans; p++)
+	{
+		CommandListType sList;
+		ScriptedWorldType sWorld, sTimedWorld;
+		StepClock sClock;
+		ScriptedSenses senses(&sWorld);
+		ScriptedActions actions(&sWorld);
+		TimedSenses timedSenses(&sTimedWorld, &sClock);
+		TimedActions timedActions(&sTimedWorld, &sClock);
+
+		planGenDefaults(&sParams);
+		sParams.ulSeed = p;
+		sParams.uiDrives = 1 + p % 8;
+		sParams.uiDepth = p % 4;
+		memset(&sList, 0, sizeof(sList));
+		if (!planGenerate(&sParams, addCommand, &sList))
+			continue;
+
+		memset(&sWorld, 0, sizeof(sWorld));
+		sWorld.ulSeed = p;
+		sTimedWorld = sWorld;
+		CmdPlanner *pPlan = loadCommands(&sList, &senses, &actions);
+		CmdPlanner *pTimed = loadCommands(&sList, &timedSenses, &timedActions);
+		instinctID nMaxID = pTimed->maxElementID();
+		ExpectedLatency sExpected((unsigned int)nMaxID + 1);
+		pTimed->setMonitor(&sExpected);
+		pTimed->setGlobalMonitorFlags(true, false, false, false, false, true);
+		if (!pTimed->enableLatencyHistograms(&sClock))
+			ulHistogramFailed++;
+
+		for (unsigned int i = 0; i < uiCycles; i++)
+		{
+			ulCycles++;
+			if (runCycle(pPlan, &sWorld) != runCycle(pTimed, &sTimedWorld))
+			{
+				if (ulFailed++ < 10)
+					printf("# plan %u differs at cycle %u\n", p, i);
+			}
+		}
+
+		for (instinctID nID = 1; nID <= nMaxID; nID++)
+		{
+			if (!sameHistograms(pTimed, &sExpected, nID))
+			{
+				if (ulHistogramFailed++ < 10)
+					printf("# plan %u element %u has the wrong histograms\n", p, (unsigned int)nID);
+			}
+			if (!sameDisplay(pTimed, nID))
+			{
+				if (ulDisplayFailed++ < 10)
+					printf("# plan %u element %u is displayed wrongly\n", p, (unsigned int)nID);
+			}
+			for (unsigned int i = 0; i < INSTINCT_LATENCY_BUCKETS; i++)
+				ulBuckets[i] += sExpected.pExpected[nID].sExecute.uiCount[i] + sExpected.pExpected[nID].sReleaser.uiCount[i];
+		}
+
+		// there is nothing to display once the histograms are disabled
+		pTimed->enableLatencyHistograms(0);
+		if (pTimed->executeCommand("D L 1", szRtn, sizeof(szRtn)))
+			ulDisplayFailed++;
+
+		delete pTimed;
+		delete pPlan;
+		free((void *)sList.pLines);
+	}
+
+	printf("plans,cycles,cycles_differing,histograms_differing,displays_differing\n");
+	printf("%u,%lu,%lu,%lu,%lu\n", uiPlans, ulCycles, ulFailed, ulHistogramFailed, ulDisplayFailed);
+	printf("# Action and releaser times by bucket:");
+	for (unsigned int i = 0; i < INSTINCT_LATENCY_BUCKETS; i++)
+		printf(" %lu", ulBuckets[i]);
+	printf("\n");
+
+	return (ulFailed || ulHistogramFailed || ulDisplayFailed) ? 1 : 0;
+}
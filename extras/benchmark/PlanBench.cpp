@@ -0,0 +1,477 @@
+//  Instinct Reactive Planning Library
+//  Benchmark suite for the planner core, to track performance between releases
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each case is run on synthetic plans of a given shape - a number of Drives, each running a chain of Competences
+// uiDepth deep. Every Competence has an OR group of uiWidth CE's, each running an Action when its sense is released,
+// and a default CE at lower priority that runs the next Competence in the chain, or an Action Pattern at the end.
+//
+//    load     - CmdPlanner construction, then executeCommand() for every "A" command of the plan, then linkPlan()
+//    loadplan - CmdPlanner construction, then loadPlan() of the same commands as a single script
+//    grow     - CmdPlanner construction with no plan buffers and plan growth enabled, then the "A" commands and linkPlan()
+//    run      - runPlan(), with senses that change from cycle to cycle
+//    timers   - processTimers(1), with ramping Drives
+//    timers_tickless - the same with enableTicklessTimers(), which only touches the Drives whose timers expire
+//    swap     - swapPlan() with a staging CmdPlanner holding the same plan, carrying the runtime values across.
+//               First a plan with changed Drive priorities is swapped into a running planner, which must then run
+//               just as a new planner loaded with the changed plan and given the old state by restoreRuntimeState()
+//    display  - displayNode() for every element in the plan
+//    names    - Names::getElementName() and getElementID() for elements spread across the plan
+//
+// Results are written as CSV, one line per case and plan shape: the time per operation and the heap allocations
+// per operation. Allocations are counted by wrapping malloc, so are only counted where glibc is used.
+// The run case is followed by a comment line with the Planner's work counters per plan cycle, which only change
+// when the planner's algorithms do.
+//
+// Build and run from this directory with 16 bit ID's, so that the larger plans can be built:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp PlanBench.cpp -o PlanBench
+//    ./PlanBench                      all of the standard plan shapes
+//    ./PlanBench drives depth width   just one plan shape
+
+#include <chrono>
+
+#include "Arduino.h"
+#include "Instinct.h"
+
+using namespace Instinct;
+
+#define BENCH_SENSES			8
+#define BENCH_ACTIONS			16
+#define BENCH_PATTERN_LENGTH	4
+#define BENCH_LINE_LENGTH		80
+
+// ** allocation counting
+static unsigned long ulAllocs = 0;
+static unsigned long ulAllocBytes = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc(size_t uiSize);
+void *__libc_calloc(size_t uiCount, size_t uiSize);
+void *__libc_realloc(void *pMem, size_t uiSize);
+
+void *malloc(size_t uiSize)
+{
+	ulAllocs++;
+	ulAllocBytes += uiSize;
+	return __libc_malloc(uiSize);
+}
+
+void *calloc(size_t uiCount, size_t uiSize)
+{
+	ulAllocs++;
+	ulAllocBytes += uiCount * uiSize;
+	return __libc_calloc(uiCount, uiSize);
+}
+
+void *realloc(void *pMem, size_t uiSize)
+{
+	ulAllocs++;
+	ulAllocBytes += uiSize;
+	return __libc_realloc(pMem, uiSize);
+}
+}
+#endif
+
+// ** scripted senses and actions, so that every run does the same work
+class BenchSenses : public Senses {
+public:
+	unsigned long ulTick;
+	int readSense(const senseID nSense)
+	{
+		unsigned long x = (ulTick / (nSense + 1) + nSense) * 2654435761u;
+		return (int)((x >> 16) % 10);
+	}
+};
+
+class BenchActions : public Actions {
+public:
+	BenchSenses *pSenses;
+	unsigned long ulCount;
+	unsigned long ulTrace; // a hash of the Actions executed
+	unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete)
+	{
+		pSenses->ulTick++;
+		ulTrace = (ulTrace * 31 + nAction + 1) & 0xFFFFFFFFUL;
+		return (++ulCount & 3) ? INSTINCT_SUCCESS : INSTINCT_IN_PROGRESS;
+	}
+};
+
+typedef struct {
+	unsigned int uiDrives;
+	unsigned int uiDepth;
+	unsigned int uiWidth;
+} PlanShapeType;
+
+// the plan as a list of "A" commands, each BENCH_LINE_LENGTH long, and the plan size they need
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+	instinctID nPlanSize[INSTINCT_NODE_TYPES];
+	instinctID nMaxID;
+} PlanScriptType;
+
+static void addLine(PlanScriptType *pScript, const unsigned char nNodeType, const char *pLine)
+{
+	snprintf(pScript->pLines + pScript->uiLines * BENCH_LINE_LENGTH, BENCH_LINE_LENGTH, "%s", pLine);
+	pScript->uiLines++;
+	pScript->nPlanSize[nNodeType]++;
+}
+
+static unsigned char buildScript(const PlanShapeType *pShape, PlanScriptType *pScript)
+{
+	unsigned int uiPerDrive = 1 + pShape->uiDepth * (pShape->uiWidth + 2) + 1 + BENCH_PATTERN_LENGTH;
+	unsigned long ulLines = BENCH_ACTIONS + (unsigned long)pShape->uiDrives * uiPerDrive;
+	char szLine[BENCH_LINE_LENGTH];
+	unsigned int uiID = 1;
+
+	if (ulLines >= (unsigned long)INSTINCT_MAX_INSTINCTID)
+		return false; // needs wider ID's
+
+	memset(pScript, 0, sizeof(PlanScriptType));
+	pScript->uiMaxLines = (unsigned int)ulLines;
+	pScript->pLines = (char *)malloc(ulLines * BENCH_LINE_LENGTH);
+	if (!pScript->pLines)
+		return false;
+
+	// the Actions are shared by every Drive
+	for (unsigned int i = 0; i < BENCH_ACTIONS; i++)
+	{
+		snprintf(szLine, sizeof(szLine), "A A %u %u %u", uiID++, i, i % 3);
+		addLine(pScript, INSTINCT_ACTION, szLine);
+	}
+
+	for (unsigned int d = 0; d < pShape->uiDrives; d++)
+	{
+		unsigned int uiDriveID = uiID++;
+		unsigned int uiPatternID = uiID++;
+		unsigned int uiChildID = uiPatternID;
+
+		snprintf(szLine, sizeof(szLine), "A P %u", uiPatternID);
+		addLine(pScript, INSTINCT_ACTIONPATTERN, szLine);
+		for (unsigned int i = 0; i < BENCH_PATTERN_LENGTH; i++)
+		{
+			snprintf(szLine, sizeof(szLine), "A L %u %u %u %u", uiID++, uiPatternID, 1 + (d + i) % BENCH_ACTIONS, i + 1);
+			addLine(pScript, INSTINCT_ACTIONPATTERNELEMENT, szLine);
+		}
+
+		// build the chain of Competences from the bottom up, each running the one below by default
+		for (unsigned int k = 0; k < pShape->uiDepth; k++)
+		{
+			unsigned int uiCompetenceID = uiID++;
+			snprintf(szLine, sizeof(szLine), "A C %u %u", uiCompetenceID, pShape->uiWidth > 1 ? 1 : 0);
+			addLine(pScript, INSTINCT_COMPETENCE, szLine);
+			for (unsigned int w = 0; w < pShape->uiWidth; w++)
+			{
+				snprintf(szLine, sizeof(szLine), "A E %u %u %u 2 0 %u %u %u 1 1", uiID++, uiCompetenceID, 1 + (d + k + w) % BENCH_ACTIONS,
+					(k + w) % BENCH_SENSES, INSTINCT_COMPARATOR_EQ, (d + w) % 10);
+				addLine(pScript, INSTINCT_COMPETENCEELEMENT, szLine);
+			}
+			snprintf(szLine, sizeof(szLine), "A E %u %u %u 1 0 0 %u 0 0 0", uiID++, uiCompetenceID, uiChildID, INSTINCT_COMPARATOR_TR);
+			addLine(pScript, INSTINCT_COMPETENCEELEMENT, szLine);
+			uiChildID = uiCompetenceID;
+		}
+
+		snprintf(szLine, sizeof(szLine), "A D %u %u %u %u %u %u 3 1 1 1 0 %u", uiDriveID, uiChildID, 1 + d % 10, d % 3,
+			d % BENCH_SENSES, INSTINCT_COMPARATOR_GT, 5 + d % 7);
+		addLine(pScript, INSTINCT_DRIVE, szLine);
+	}
+	pScript->nMaxID = (instinctID)(uiID - 1);
+
+	return true;
+}
+
+static CmdPlanner * loadScript(PlanScriptType *pScript, BenchSenses *pSenses, BenchActions *pActions)
+{
+	char szRtn[20];
+
+	CmdPlanner *pPlan = new CmdPlanner(pScript->nPlanSize, pSenses, pActions, 0);
+	for (unsigned int i = 0; i < pScript->uiLines; i++)
+		pPlan->executeCommand(pScript->pLines + i * BENCH_LINE_LENGTH, szRtn, sizeof(szRtn));
+	pPlan->linkPlan();
+
+	return pPlan;
+}
+
+// reverse the priorities of the Drives, which are 1 to 10
+static void patchDrives(CmdPlanner *pPlan, const PlanScriptType *pScript)
+{
+	PlanNode sNode;
+
+	for (unsigned int id = 1; id <= pScript->nMaxID; id++)
+	{
+		if (pPlan->getNode(&sNode, (instinctID)id) && (sNode.bNodeType == INSTINCT_DRIVE))
+		{
+			sNode.sElement.sDrive.sDrivePriority.bPriority = 11 - sNode.sElement.sDrive.sDrivePriority.bPriority;
+			pPlan->patchNode(&sNode);
+		}
+	}
+	pPlan->linkPlan();
+}
+
+// Swap a changed plan into a running planner, carrying its runtime values across, and run it alongside a new planner loaded
+// with the changed plan and given the state of the running planner with restoreRuntimeState(). Returns the number of
+// cycles after which the Actions the two have executed differ, or all of them if the state cannot be restored
+static unsigned long swapCheck(PlanScriptType *pScript, const unsigned int uiCycles)
+{
+	BenchSenses sensesSwap;
+	BenchSenses sensesRestore;
+	BenchActions actionsSwap;
+	BenchActions actionsRestore;
+	unsigned long ulFailed = 0;
+
+	sensesSwap.ulTick = 0;
+	actionsSwap.pSenses = &sensesSwap;
+	actionsSwap.ulCount = 0;
+	actionsSwap.ulTrace = 0;
+	CmdPlanner *pRunning = loadScript(pScript, &sensesSwap, &actionsSwap);
+	for (unsigned int i = 0; i < 500; i++, sensesSwap.ulTick++)
+	{
+		pRunning->processTimers(1);
+		pRunning->runPlan();
+	}
+
+	unsigned int uiStateSize = pRunning->runtimeStateSize();
+	unsigned char *pState = (unsigned char *)malloc(uiStateSize);
+	CmdPlanner *pStaging = loadScript(pScript, &sensesSwap, &actionsSwap);
+	CmdPlanner *pRestored = loadScript(pScript, &sensesRestore, &actionsRestore);
+	patchDrives(pStaging, pScript);
+	patchDrives(pRestored, pScript);
+	if (!pState || !pRunning->saveRuntimeState(pState, uiStateSize) || !pRunning->swapPlan(pStaging, true) ||
+		!pRestored->restoreRuntimeState(pState, uiStateSize))
+		ulFailed = uiCycles;
+
+	sensesRestore = sensesSwap;
+	actionsRestore = actionsSwap;
+	actionsRestore.pSenses = &sensesRestore;
+	for (unsigned int i = 0; (i < uiCycles) && !ulFailed; i++, sensesSwap.ulTick++, sensesRestore.ulTick++)
+	{
+		pRunning->processTimers(1);
+		pRunning->runPlan();
+		pRestored->processTimers(1);
+		pRestored->runPlan();
+		if (actionsSwap.ulTrace != actionsRestore.ulTrace)
+			ulFailed = uiCycles - i;
+	}
+
+	free((void *)pState);
+	delete pRestored;
+	delete pStaging;
+	delete pRunning;
+
+	return ulFailed;
+}
+
+// ** timing
+typedef std::chrono::steady_clock::time_point BenchTime;
+
+static BenchTime tStart;
+static unsigned long ulStartAllocs;
+static unsigned long ulStartBytes;
+
+static void startCase(void)
+{
+	ulStartAllocs = ulAllocs;
+	ulStartBytes = ulAllocBytes;
+	tStart = std::chrono::steady_clock::now();
+}
+
+static void endCase(const char *pCase, const PlanShapeType *pShape, const PlanScriptType *pScript, const unsigned long ulOps)
+{
+	BenchTime tEnd = std::chrono::steady_clock::now();
+	double dNs = std::chrono::duration<double, std::nano>(tEnd - tStart).count();
+
+	printf("%s,%u,%u,%u,%u,%lu,%.1f,%.3f,%.1f\n", pCase, pShape->uiDrives, pShape->uiDepth, pShape->uiWidth, pScript->uiLines, ulOps,
+		dNs / ulOps, (double)(ulAllocs - ulStartAllocs) / ulOps, (double)(ulAllocBytes - ulStartBytes) / ulOps);
+}
+
+static void runShape(const PlanShapeType *pShape)
+{
+	PlanScriptType sScript;
+	BenchSenses senses;
+	BenchActions actions;
+	char szBuff[120];
+	unsigned long ulCount = 0;
+
+	if (!buildScript(pShape, &sScript))
+		return;
+
+	senses.ulTick = 0;
+	actions.pSenses = &senses;
+	actions.ulCount = 0;
+	actions.ulTrace = 0;
+
+	// load
+	unsigned int uiLoads = 20000 / sScript.uiLines + 2;
+	startCase();
+	for (unsigned int i = 0; i < uiLoads; i++)
+		delete loadScript(&sScript, &senses, &actions);
+	endCase("load", pShape, &sScript, (unsigned long)uiLoads * sScript.uiLines);
+
+	// loadplan
+	char *pText = (char *)malloc(sScript.uiLines * BENCH_LINE_LENGTH + 8);
+	unsigned long ulLength = 0;
+	unsigned long ulFailed = 0;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	for (unsigned int i = 0; i < sScript.uiLines; i++)
+		ulLength += sprintf(pText + ulLength, "%s\n", sScript.pLines + i * BENCH_LINE_LENGTH);
+	ulLength += sprintf(pText + ulLength, "L P\n");
+	startCase();
+	for (unsigned int i = 0; i < uiLoads; i++)
+	{
+		CmdPlanner *pLoaded = new CmdPlanner(nNoPlan, &senses, &actions, 0);
+		if (!pLoaded->loadPlan(pText, ulLength))
+			ulFailed++;
+		delete pLoaded;
+	}
+	endCase("loadplan", pShape, &sScript, (unsigned long)uiLoads * sScript.uiLines);
+	if (ulFailed)
+		printf("# loadplan failed\n");
+	free((void *)pText);
+
+	// grow
+	char szRtn[20];
+	ulFailed = 0;
+	startCase();
+	for (unsigned int i = 0; i < uiLoads; i++)
+	{
+		CmdPlanner *pGrown = new CmdPlanner(nNoPlan, &senses, &actions, 0);
+		pGrown->enablePlanGrowth(true);
+		for (unsigned int j = 0; j < sScript.uiLines; j++)
+		{
+			if (!pGrown->executeCommand(sScript.pLines + j * BENCH_LINE_LENGTH, szRtn, sizeof(szRtn)))
+				ulFailed++;
+		}
+		pGrown->linkPlan();
+		delete pGrown;
+	}
+	endCase("grow", pShape, &sScript, (unsigned long)uiLoads * sScript.uiLines);
+	if (ulFailed)
+		printf("# grow failed\n");
+
+	CmdPlanner *pPlan = loadScript(&sScript, &senses, &actions);
+
+	// run
+	for (unsigned int i = 0; i < 1000; i++, senses.ulTick++)
+		pPlan->runPlan();
+	pPlan->clearWorkCounters();
+	startCase();
+	for (unsigned int i = 0; i < 20000; i++, senses.ulTick++)
+		pPlan->runPlan();
+	endCase("run", pShape, &sScript, 20000);
+
+	// the work behind the run case, which does not depend on the speed of the machine
+	WorkCountersType sWork;
+	pPlan->workCounters(&sWork);
+	printf("# work per cycle: drives %.2f ces %.2f apes %.2f lookups %.2f flags %.2f senses %.2f\n",
+		(double)sWork.ulDrivesScanned / sWork.ulCycles, (double)sWork.ulCEsScanned / sWork.ulCycles,
+		(double)sWork.ulAPEsScanned / sWork.ulCycles, (double)sWork.ulElementLookups / sWork.ulCycles,
+		(double)sWork.ulFlagsCleared / sWork.ulCycles, (double)sWork.ulSenseReads / sWork.ulCycles);
+
+	// timers
+	startCase();
+	for (unsigned int i = 0; i < 20000; i++)
+		pPlan->processTimers(1);
+	endCase("timers", pShape, &sScript, 20000);
+
+	// timers_tickless, with the timer heap built before timing starts
+	pPlan->enableTicklessTimers(true);
+	pPlan->nextTimerEvent();
+	startCase();
+	for (unsigned int i = 0; i < 20000; i++)
+		pPlan->processTimers(1);
+	endCase("timers_tickless", pShape, &sScript, 20000);
+	pPlan->enableTicklessTimers(false);
+
+	// swap, an even number of times so that pPlan ends with the plan it started with
+	ulFailed = swapCheck(&sScript, 2000);
+	if (ulFailed)
+		printf("# swap differs from restore in %lu of 2000 cycles\n", ulFailed);
+	CmdPlanner *pStaging = loadScript(&sScript, &senses, &actions);
+	startCase();
+	for (unsigned int i = 0; i < 2000; i++)
+		pPlan->swapPlan(pStaging, true);
+	endCase("swap", pShape, &sScript, 2000);
+	delete pStaging;
+
+	// display
+	unsigned int uiDisplays = 0;
+	startCase();
+	while (uiDisplays < 20000)
+	{
+		for (unsigned int id = 1; id <= sScript.nMaxID; id++)
+		{
+			pPlan->displayNode(szBuff, sizeof(szBuff), (instinctID)id);
+			uiDisplays++;
+		}
+	}
+	endCase("display", pShape, &sScript, uiDisplays);
+
+	// names, looked up for 500 elements spread across the plan
+	Names *pNames = new Names(sScript.nMaxID * 12 + 16);
+	for (unsigned int id = 1; id <= sScript.nMaxID; id++)
+	{
+		snprintf(szBuff, sizeof(szBuff), "Node%u", id);
+		pNames->addElementName((instinctID)id, szBuff);
+	}
+	startCase();
+	for (unsigned int i = 0; i < 500; i++)
+	{
+		instinctID id = (instinctID)(1 + (i * 7919u) % sScript.nMaxID);
+		char *pName = pNames->getElementName(id);
+		if (pName && pNames->getElementID(pName) == id)
+			ulCount++;
+	}
+	endCase("names", pShape, &sScript, 1000);
+	if (ulCount != 500)
+		printf("# names lookup failed\n");
+
+	delete pNames;
+	delete pPlan;
+	free((void *)sScript.pLines);
+}
+
+int main(int argc, char **argv)
+{
+	static const PlanShapeType sShapes[] = {
+		{ 1, 1, 1 },
+		{ 4, 2, 2 },
+		{ 16, 2, 4 },
+		{ 16, 4, 4 },
+		{ 64, 2, 8 },
+		{ 64, 4, 2 },
+		{ 256, 3, 4 },
+	};
+
+	printf("case,drives,depth,width,nodes,ops,ns_per_op,allocs_per_op,bytes_per_op\n");
+	if (argc > 3)
+	{
+		PlanShapeType sShape;
+		sShape.uiDrives = atoi(argv[1]);
+		sShape.uiDepth = atoi(argv[2]);
+		sShape.uiWidth = atoi(argv[3]);
+		runShape(&sShape);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < sizeof(sShapes) / sizeof(sShapes[0]); i++)
+			runShape(sShapes + i);
+	}
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+//  Instinct Reactive Planning Library
+//  Command line front end to the synthetic plan generator
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Writes a generated plan as a PLAN command script and/or a binary plan image, and can run it against
+// the scripted Senses and Actions to check that it behaves the same way each time.
+//
+// Build from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp PlanGen.cpp -o PlanGen
+//
+//    ./PlanGen [-d drives] [-c competence depth] [-g priority groups] [-w CE's per group] [-o OR percent]
+//              [-l APE's per pattern] [-s senses] [-a actions] [-r seed]
+//              [-p script file] [-i image file] [-x include the index in the image] [-n cycles to run]
+//
+// With neither -p nor -i the script is written to stdout.
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+// load each command into the planner, remembering the first that fails
+typedef struct {
+	CmdPlanner *pPlan;
+	FILE *pScript;
+	unsigned long ulLines;
+	unsigned long ulFailedLine;
+} PlanGenOutputType;
+
+static void outputLine(void *pContext, const char *pLine)
+{
+	PlanGenOutputType *pOutput = (PlanGenOutputType *)pContext;
+	char szRtn[20];
+
+	pOutput->ulLines++;
+	if (pOutput->pScript)
+		fprintf(pOutput->pScript, "%s\n", pLine);
+	if (pOutput->pPlan && !pOutput->pPlan->executeCommand(pLine, szRtn, sizeof(szRtn)) && !pOutput->ulFailedLine)
+		pOutput->ulFailedLine = pOutput->ulLines;
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	PlanGenOutputType sOutput;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	const char *pScriptFile = 0;
+	const char *pImageFile = 0;
+	unsigned char bIncludeIndex = false;
+	unsigned long ulCycles = 0;
+	ScriptedWorldType sWorld;
+	ScriptedSenses senses(&sWorld);
+	ScriptedActions actions(&sWorld);
+
+	planGenDefaults(&sParams);
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-x"))
+		{
+			bIncludeIndex = true;
+			continue;
+		}
+		if ((argv[i][0] != '-') || (i + 1 >= argc))
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+		char *pValue = argv[++i];
+		switch (argv[i - 1][1])
+		{
+		case 'd': sParams.uiDrives = atoi(pValue); break;
+		case 'c': sParams.uiDepth = atoi(pValue); break;
+		case 'g': sParams.uiGroups = atoi(pValue); break;
+		case 'w': sParams.uiGroupWidth = atoi(pValue); break;
+		case 'o': sParams.uiORPercent = atoi(pValue); break;
+		case 'l': sParams.uiPatternLength = atoi(pValue); break;
+		case 's': sParams.uiSenses = atoi(pValue); break;
+		case 'a': sParams.uiActions = atoi(pValue); break;
+		case 'r': sParams.ulSeed = strtoul(pValue, 0, 10); break;
+		case 'p': pScriptFile = pValue; break;
+		case 'i': pImageFile = pValue; break;
+		case 'n': ulCycles = strtoul(pValue, 0, 10); break;
+		default:
+			fprintf(stderr, "unknown option %s\n", argv[i - 1]);
+			return 1;
+		}
+	}
+
+	memset(&sOutput, 0, sizeof(sOutput));
+	if (pScriptFile)
+	{
+		sOutput.pScript = fopen(pScriptFile, "w");
+		if (!sOutput.pScript)
+		{
+			fprintf(stderr, "cannot write %s\n", pScriptFile);
+			return 1;
+		}
+	}
+	else if (!pImageFile)
+		sOutput.pScript = stdout;
+	if (pImageFile || ulCycles)
+		sOutput.pPlan = new CmdPlanner(nNoPlan, &senses, &actions, 0);
+
+	if (!planGenerate(&sParams, outputLine, &sOutput))
+	{
+		fprintf(stderr, "the plan needs %lu elements, but instinctID can only hold %lu\n", planGenSize(&sParams, 0),
+			(unsigned long)INSTINCT_MAX_INSTINCTID);
+		return 1;
+	}
+	if (pScriptFile)
+		fclose(sOutput.pScript);
+	if (sOutput.ulFailedLine)
+	{
+		fprintf(stderr, "line %lu of the plan was not accepted\n", sOutput.ulFailedLine);
+		return 1;
+	}
+
+	if (pImageFile)
+	{
+		unsigned long ulSize = sOutput.pPlan->planImageSize(bIncludeIndex);
+		unsigned char *pImage = (unsigned char *)malloc(ulSize);
+		FILE *pFile = fopen(pImageFile, "wb");
+		if (!pImage || !pFile || !sOutput.pPlan->writePlanImage(pImage, ulSize, bIncludeIndex) ||
+			(fwrite(pImage, 1, ulSize, pFile) != ulSize))
+		{
+			fprintf(stderr, "cannot write %s\n", pImageFile);
+			return 1;
+		}
+		fclose(pFile);
+		free((void *)pImage);
+	}
+
+	if (ulCycles)
+	{
+		sWorld.ulSeed = sParams.ulSeed;
+		sWorld.ulStep = 0;
+		sWorld.ulActions = 0;
+		sWorld.ulChecksum = 0;
+		for (unsigned long i = 0; i < ulCycles; i++)
+		{
+			sOutput.pPlan->processTimers(1);
+			sOutput.pPlan->runPlan();
+		}
+		fprintf(stderr, "%lu cycles, %lu elements, %lu actions, checksum %08lx\n", ulCycles, sOutput.ulLines - 2,
+			sWorld.ulActions, sWorld.ulChecksum);
+	}
+
+	if (sOutput.pPlan)
+		delete sOutput.pPlan;
+
+	return 0;
+}
@@ -0,0 +1,250 @@
+//  Instinct Reactive Planning Library
+//  Synthetic plan generator, with scripted Senses and Actions to run the plans it generates
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Generates valid plans of any size as PLAN command scripts - an "R I" command sizing the plan, an "A" command
+// for each element and a closing "L P". Each Drive runs a chain of uiDepth Competences. Each Competence has uiGroups
+// priority groups of uiGroupWidth CE's, which run Actions or the Drive's Action Pattern, and a default CE at the lowest
+// priority that runs the next Competence in the chain, or the Action Pattern at the end of it.
+// All choices come from a seeded random number generator of our own, so a seed gives the same plan on every host.
+//
+// ScriptedSenses and ScriptedActions stand in for the robot. Sense values change as Actions are executed, and Action
+// results follow from the seed, the Action and the number of times it has run, so a plan always runs the same way.
+
+#ifndef _INSTINCT_PLAN_GENERATOR_H_
+#define _INSTINCT_PLAN_GENERATOR_H_
+
+#include "Instinct.h"
+
+namespace Instinct {
+
+#define PLANGEN_LINE_LENGTH		80
+#define PLANGEN_SENSE_RANGE		10 // sense values are 0 to 9
+
+typedef struct {
+	unsigned int uiDrives;
+	unsigned int uiDepth; // Competences in the chain below each Drive, 0 to run the Action Pattern directly
+	unsigned int uiGroups; // priority groups in each Competence, not counting the default CE
+	unsigned int uiGroupWidth; // CE's in each priority group
+	unsigned int uiORPercent; // the percentage of Competences with bUseORWithinCEGroup set
+	unsigned int uiPatternLength; // APE's in each Action Pattern
+	unsigned int uiSenses; // senseID's used are 0 to uiSenses - 1
+	unsigned int uiActions; // actionID's used are 0 to uiActions - 1, each with its own Action element
+	unsigned long ulSeed;
+} PlanGenParamsType;
+
+// called with each command of the script in turn
+typedef void (*PlanGenLineFn)(void *pContext, const char *pLine);
+
+inline void planGenDefaults(PlanGenParamsType *pParams)
+{
+	pParams->uiDrives = 8;
+	pParams->uiDepth = 2;
+	pParams->uiGroups = 2;
+	pParams->uiGroupWidth = 2;
+	pParams->uiORPercent = 50;
+	pParams->uiPatternLength = 4;
+	pParams->uiSenses = 8;
+	pParams->uiActions = 16;
+	pParams->ulSeed = 1;
+}
+
+// a 32 bit xorshift generator, so that the plan does not depend on the host's rand()
+inline unsigned long planGenRandom(unsigned long *pState, const unsigned long ulRange)
+{
+	unsigned long x = *pState & 0xFFFFFFFFUL;
+	x ^= (x << 13) & 0xFFFFFFFFUL;
+	x ^= x >> 17;
+	x ^= (x << 5) & 0xFFFFFFFFUL;
+	*pState = x;
+	return ulRange ? x % ulRange : 0;
+}
+
+inline unsigned long planGenHash(const unsigned long a, const unsigned long b, const unsigned long c)
+{
+	unsigned long x = ((a * 2654435761UL) ^ (b * 40503UL + 0x9E3779B9UL) ^ (c * 2246822519UL)) & 0xFFFFFFFFUL;
+	x ^= x >> 15;
+	x = (x * 2246822519UL) & 0xFFFFFFFFUL;
+	x ^= x >> 13;
+	return x;
+}
+
+// the number of elements of each type in the plan, as needed by initialisePlan(). Returns the total, which
+// must be no more than INSTINCT_MAX_INSTINCTID, since the ElementID's used are 1 to the total
+inline unsigned long planGenSize(const PlanGenParamsType *pParams, instinctID *pPlanSize)
+{
+	unsigned long ulSize[INSTINCT_NODE_TYPES];
+	unsigned long ulTotal = 0;
+
+	ulSize[INSTINCT_ACTIONPATTERN] = pParams->uiDrives;
+	ulSize[INSTINCT_ACTIONPATTERNELEMENT] = (unsigned long)pParams->uiDrives * pParams->uiPatternLength;
+	ulSize[INSTINCT_COMPETENCE] = (unsigned long)pParams->uiDrives * pParams->uiDepth;
+	ulSize[INSTINCT_COMPETENCEELEMENT] = ulSize[INSTINCT_COMPETENCE] * (pParams->uiGroups * pParams->uiGroupWidth + 1);
+	ulSize[INSTINCT_DRIVE] = pParams->uiDrives;
+	ulSize[INSTINCT_ACTION] = pParams->uiActions;
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		if (pPlanSize)
+			pPlanSize[i] = (instinctID)ulSize[i];
+		ulTotal += ulSize[i];
+	}
+
+	return ulTotal;
+}
+
+// a releaser comparing a random sense, never TR or FL
+inline void planGenReleaser(unsigned long *pRandom, const PlanGenParamsType *pParams, char *pBuff, const int nBuffLen)
+{
+	unsigned int uiSense = (unsigned int)planGenRandom(pRandom, pParams->uiSenses);
+	unsigned int uiComparator = (unsigned int)planGenRandom(pRandom, 4); // EQ, NE, GT or LT
+	unsigned int uiValue = (unsigned int)planGenRandom(pRandom, PLANGEN_SENSE_RANGE);
+	unsigned int uiHysteresis = (unsigned int)planGenRandom(pRandom, 3);
+	unsigned int uiFlexHysteresis = (unsigned int)planGenRandom(pRandom, 3);
+
+	snprintf(pBuff, nBuffLen, "%u %u %u %u %u", uiSense, uiComparator, uiValue, uiHysteresis, uiFlexHysteresis);
+}
+
+// generate the plan, passing each command to pLineFn. Returns false if the plan needs more ElementID's than instinctID can hold
+inline unsigned char planGenerate(const PlanGenParamsType *pParams, PlanGenLineFn pLineFn, void *pContext)
+{
+	instinctID nPlanSize[INSTINCT_NODE_TYPES];
+	char szLine[PLANGEN_LINE_LENGTH];
+	char szReleaser[40];
+	unsigned long ulRandom = pParams->ulSeed ? pParams->ulSeed : 1;
+	unsigned int uiID = 1;
+
+	if (!pParams->uiActions || !pParams->uiSenses || !pParams->uiPatternLength ||
+		(planGenSize(pParams, nPlanSize) > (unsigned long)INSTINCT_MAX_INSTINCTID))
+		return false;
+
+	snprintf(szLine, sizeof(szLine), "R I %u %u %u %u %u %u", (unsigned int)nPlanSize[0], (unsigned int)nPlanSize[1],
+		(unsigned int)nPlanSize[2], (unsigned int)nPlanSize[3], (unsigned int)nPlanSize[4], (unsigned int)nPlanSize[5]);
+	pLineFn(pContext, szLine);
+
+	// one Action element for each actionID, with ElementID's 1 to uiActions
+	for (unsigned int i = 0; i < pParams->uiActions; i++)
+	{
+		snprintf(szLine, sizeof(szLine), "A A %u %u %u", uiID++, i, (unsigned int)planGenRandom(&ulRandom, 100));
+		pLineFn(pContext, szLine);
+	}
+
+	for (unsigned int d = 0; d < pParams->uiDrives; d++)
+	{
+		unsigned int uiPatternID = uiID++;
+		unsigned int uiChildID = uiPatternID;
+
+		snprintf(szLine, sizeof(szLine), "A P %u", uiPatternID);
+		pLineFn(pContext, szLine);
+		for (unsigned int i = 0; i < pParams->uiPatternLength; i++)
+		{
+			snprintf(szLine, sizeof(szLine), "A L %u %u %u %u", uiID++, uiPatternID,
+				1 + (unsigned int)planGenRandom(&ulRandom, pParams->uiActions), i + 1);
+			pLineFn(pContext, szLine);
+		}
+
+		// build the chain of Competences from the bottom up, so that each can run the one below by default
+		for (unsigned int k = 0; k < pParams->uiDepth; k++)
+		{
+			unsigned int uiCompetenceID = uiID++;
+			snprintf(szLine, sizeof(szLine), "A C %u %u", uiCompetenceID,
+				planGenRandom(&ulRandom, 100) < pParams->uiORPercent ? 1 : 0);
+			pLineFn(pContext, szLine);
+
+			for (unsigned int g = 0; g < pParams->uiGroups; g++)
+			{
+				for (unsigned int w = 0; w < pParams->uiGroupWidth; w++)
+				{
+					// mostly Actions, sometimes the Drive's Action Pattern
+					unsigned int uiCEChildID = planGenRandom(&ulRandom, 10) < 3 ? uiPatternID :
+						1 + (unsigned int)planGenRandom(&ulRandom, pParams->uiActions);
+					unsigned int uiRetry = (unsigned int)planGenRandom(&ulRandom, 3);
+					planGenReleaser(&ulRandom, pParams, szReleaser, sizeof(szReleaser));
+					snprintf(szLine, sizeof(szLine), "A E %u %u %u %u %u %s", uiID++, uiCompetenceID, uiCEChildID,
+						pParams->uiGroups + 1 - g, uiRetry, szReleaser);
+					pLineFn(pContext, szLine);
+				}
+			}
+			snprintf(szLine, sizeof(szLine), "A E %u %u %u 1 0 0 %u 0 0 0", uiID++, uiCompetenceID, uiChildID, INSTINCT_COMPARATOR_TR);
+			pLineFn(pContext, szLine);
+			uiChildID = uiCompetenceID;
+		}
+
+		// a quarter of the Drives are always released, and some ramp their priority
+		if (planGenRandom(&ulRandom, 4))
+			planGenReleaser(&ulRandom, pParams, szReleaser, sizeof(szReleaser));
+		else
+			snprintf(szReleaser, sizeof(szReleaser), "0 %u 0 0 0", INSTINCT_COMPARATOR_TR);
+		unsigned int uiPriority = 1 + (unsigned int)planGenRandom(&ulRandom, 20);
+		unsigned int uiInterval = planGenRandom(&ulRandom, 2) ? (unsigned int)planGenRandom(&ulRandom, 5) : 0;
+		unsigned int uiRampInterval = planGenRandom(&ulRandom, 10) < 3 ? 5 + (unsigned int)planGenRandom(&ulRandom, 16) : 0;
+		unsigned int uiRampIncrement = uiRampInterval ? 1 + (unsigned int)planGenRandom(&ulRandom, 3) : 0;
+		unsigned int uiUrgency = uiRampInterval ? (unsigned int)planGenRandom(&ulRandom, 9) : 0;
+		snprintf(szLine, sizeof(szLine), "A D %u %u %u %u %s %u %u %u", uiID++, uiChildID, uiPriority, uiInterval, szReleaser,
+			uiRampIncrement, uiUrgency, uiRampInterval);
+		pLineFn(pContext, szLine);
+	}
+
+	pLineFn(pContext, "L P");
+
+	return true;
+}
+
+// the robot's world as far as the plan can tell. Each executed Action moves it on by one step
+typedef struct {
+	unsigned long ulSeed;
+	unsigned long ulStep;
+	unsigned long ulActions; // Actions executed
+	unsigned long ulChecksum; // of every Action executed and its result
+} ScriptedWorldType;
+
+// each sense holds its value for a few steps of the world, then takes another
+class ScriptedSenses : public Senses {
+public:
+	ScriptedSenses(ScriptedWorldType *pWorld) { _pWorld = pWorld; }
+	int readSense(const senseID nSense)
+	{
+		unsigned long ulPeriod = 1 + nSense % 5;
+		return (int)(planGenHash(_pWorld->ulSeed, nSense, _pWorld->ulStep / ulPeriod) % PLANGEN_SENSE_RANGE);
+	}
+
+private:
+	ScriptedWorldType *_pWorld;
+};
+
+// six in ten Actions succeed, two are still in progress and two fail
+class ScriptedActions : public Actions {
+public:
+	ScriptedActions(ScriptedWorldType *pWorld) { _pWorld = pWorld; }
+	unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete)
+	{
+		unsigned long ulRoll = planGenHash(_pWorld->ulSeed + 1, nAction, _pWorld->ulActions) % 10;
+		unsigned char bRtn = ulRoll < 6 ? INSTINCT_SUCCESS : ulRoll < 8 ? INSTINCT_IN_PROGRESS : INSTINCT_FAIL;
+
+		_pWorld->ulActions++;
+		_pWorld->ulStep++;
+		_pWorld->ulChecksum = (_pWorld->ulChecksum * 31 + nAction * 4 + bRtn + nActionValue) & 0xFFFFFFFFUL;
+		return bRtn;
+	}
+
+private:
+	ScriptedWorldType *_pWorld;
+};
+
+} // /namespace Instinct
+
+#endif // _INSTINCT_PLAN_GENERATOR_H_
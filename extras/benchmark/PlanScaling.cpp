@@ -0,0 +1,114 @@
+//  Instinct Reactive Planning Library
+//  Benchmark of plan cycle time against plan size
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// The same small active plan - a Drive running an Action Pattern of 8 Actions - is padded out with
+// unused Actions, so that the work done in each plan cycle stays the same while the plan grows.
+// Element lookups that search the plan buffers show up as cycle time rising with plan size.
+//
+// Build and run from this directory with 16 bit ID's, so that plans of up to 60k nodes can be built:
+//    g++ -O2 -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp PlanScaling.cpp -o PlanScaling
+//    ./PlanScaling
+
+#include <chrono>
+
+#include "Arduino.h"
+#include "Instinct.h"
+
+using namespace Instinct;
+
+#define SCALING_PATTERN_LENGTH	8
+
+class ScalingSenses : public Senses {
+public:
+	int readSense(const senseID nSense) { return 0; }
+};
+
+class ScalingActions : public Actions {
+public:
+	unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete)
+	{
+		return INSTINCT_SUCCESS;
+	}
+};
+
+// build a plan of uiNodes elements, with the active elements added last so that they are the slowest to find by searching
+static CmdPlanner * buildPlan(const unsigned int uiNodes, ScalingSenses *pSenses, ScalingActions *pActions)
+{
+	instinctID nPlanSize[INSTINCT_NODE_TYPES];
+	unsigned int uiFiller = uiNodes - (3 + 2 * SCALING_PATTERN_LENGTH);
+	instinctID bID = 1;
+
+	nPlanSize[INSTINCT_ACTIONPATTERN] = 1;
+	nPlanSize[INSTINCT_ACTIONPATTERNELEMENT] = SCALING_PATTERN_LENGTH;
+	nPlanSize[INSTINCT_COMPETENCE] = 0;
+	nPlanSize[INSTINCT_COMPETENCEELEMENT] = 0;
+	nPlanSize[INSTINCT_DRIVE] = 1;
+	nPlanSize[INSTINCT_ACTION] = uiFiller + SCALING_PATTERN_LENGTH;
+
+	CmdPlanner *pPlan = new CmdPlanner(nPlanSize, pSenses, pActions, 0);
+
+	for (unsigned int i = 0; i < uiFiller; i++)
+		pPlan->addAction(bID++, 1, 0);
+
+	instinctID bDriveID = bID++;
+	instinctID bPatternID = bID++;
+	pPlan->addDrive(bDriveID, bPatternID, 10, 0, 0, INSTINCT_COMPARATOR_TR, 0, 0, 0, 0, 0, 0);
+	pPlan->addActionPattern(bPatternID);
+	for (instinctID i = 0; i < SCALING_PATTERN_LENGTH; i++)
+	{
+		pPlan->addAction(bID, 2, i);
+		pPlan->addActionPatternElement(bID + 1, bPatternID, bID, i + 1);
+		bID += 2;
+	}
+
+	return pPlan;
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned int uiSizes[] = { 50, 100, 500, 1000, 5000, 10000, 30000, 60000 };
+	ScalingSenses senses;
+	ScalingActions actions;
+
+	printf("nodes,ns_per_cycle\n");
+	for (unsigned int i = 0; i < sizeof(uiSizes) / sizeof(uiSizes[0]); i++)
+	{
+		if (uiSizes[i] > (unsigned int)INSTINCT_MAX_INSTINCTID)
+			break; // needs wider ID's
+
+		CmdPlanner *pPlan = buildPlan(uiSizes[i], &senses, &actions);
+		unsigned int uiCycles = 20000;
+
+		for (unsigned int j = 0; j < 1000; j++) // warm up
+			pPlan->runPlan();
+
+		std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+		for (unsigned int j = 0; j < uiCycles; j++)
+		{
+			pPlan->processTimers(1);
+			pPlan->runPlan();
+		}
+		std::chrono::steady_clock::time_point tEnd = std::chrono::steady_clock::now();
+
+		double dNs = std::chrono::duration<double, std::nano>(tEnd - tStart).count() / uiCycles;
+		printf("%u,%.1f\n", uiSizes[i], dNs);
+		delete pPlan;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+//  Instinct Reactive Planning Library
+//  Benchmark of PlannerPool throughput against the number of threads
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Many agents share one plan - two Drives, one running a Competence of three CE's, the other an Action Pattern -
+// and each has its own Senses, Actions and runtime values. The pool steps every agent once per tick with 1 to N threads,
+// and reports agents stepped per second. A checksum of the agents' Action counts is printed for each thread count,
+// and is the same for all of them, since each agent's steps do not depend on which thread runs them.
+//
+// Build and run from this directory:
+//    g++ -O2 -pthread -I. -I../../src ../../src/*.cpp PoolScaling.cpp -o PoolScaling
+//    ./PoolScaling [agents] [ticks] [max threads]
+
+#include <chrono>
+
+#include "Arduino.h"
+#include "Instinct.h"
+
+using namespace Instinct;
+
+// each agent's senses change with its own tick count, so that Drives and CE's are released and inhibited in turn
+class AgentSenses : public Senses {
+public:
+	unsigned int uiTick;
+	unsigned int uiSeed;
+	int readSense(const senseID nSense)
+	{
+		unsigned int x = (uiTick / 4 + uiSeed) * 2654435761u ^ (nSense * 40503u);
+		x ^= x >> 15;
+		return (int)(x % 10);
+	}
+};
+
+class AgentActions : public Actions {
+public:
+	AgentSenses *pSenses;
+	unsigned long ulCount;
+	unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete)
+	{
+		ulCount += nAction + nActionValue;
+		pSenses->uiTick++;
+		return (ulCount & 7) ? INSTINCT_SUCCESS : INSTINCT_IN_PROGRESS;
+	}
+};
+
+static unsigned char buildPlan(Planner *pPlan)
+{
+	pPlan->addAction(1, 1, 0);
+	pPlan->addAction(2, 2, 1);
+	pPlan->addAction(3, 3, 2);
+	pPlan->addAction(4, 4, 3);
+	pPlan->addCompetence(10, 0);
+	pPlan->addCompetenceElement(11, 10, 1, 3, 0, 1, INSTINCT_COMPARATOR_GT, 6, 0, 0);
+	pPlan->addCompetenceElement(12, 10, 2, 2, 0, 2, INSTINCT_COMPARATOR_LT, 5, 0, 0);
+	pPlan->addCompetenceElement(13, 10, 3, 1, 0, 0, INSTINCT_COMPARATOR_TR, 0, 0, 0);
+	pPlan->addActionPattern(20);
+	pPlan->addActionPatternElement(21, 20, 4, 1);
+	pPlan->addActionPatternElement(22, 20, 3, 2);
+	pPlan->addDrive(30, 10, 5, 0, 3, INSTINCT_COMPARATOR_GT, 2, 0, 0, 0, 0, 0);
+	pPlan->addDrive(31, 20, 1, 0, 0, INSTINCT_COMPARATOR_TR, 0, 0, 0, 0, 0, 0);
+
+	return pPlan->linkPlan();
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int uiAgents = argc > 1 ? atoi(argv[1]) : 50000;
+	unsigned int uiTicks = argc > 2 ? atoi(argv[2]) : 100;
+	unsigned int uiMaxThreads = argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency();
+	instinctID nPlanSize[INSTINCT_NODE_TYPES] = { 1, 2, 1, 3, 2, 4 };
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+
+	if (!uiMaxThreads)
+		uiMaxThreads = 1;
+
+	AgentSenses *pSenses = new AgentSenses[uiAgents];
+	AgentActions *pActions = new AgentActions[uiAgents];
+	Planner *pOwner = new Planner(nPlanSize, pSenses, pActions, 0);
+	Planner **pAgents = (Planner **)malloc(uiAgents * sizeof(Planner *));
+
+	if (!buildPlan(pOwner))
+	{
+		printf("plan did not link\n");
+		return 1;
+	}
+
+	printf("threads,agents_per_second,speedup,stolen_chunks,checksum\n");
+	double dBase = 0;
+	for (unsigned int uiThreads = 1; uiThreads <= uiMaxThreads; uiThreads++)
+	{
+		// start every agent afresh, so that each thread count does exactly the same work
+		for (unsigned int i = 0; i < uiAgents; i++)
+		{
+			pSenses[i].uiTick = 0;
+			pSenses[i].uiSeed = i;
+			pActions[i].pSenses = pSenses + i;
+			pActions[i].ulCount = 0;
+			pAgents[i] = new Planner(nNoPlan, pSenses + i, pActions + i, 0);
+			pAgents[i]->sharePlan(pOwner);
+		}
+
+		PlannerPool *pPool = new PlannerPool(uiAgents, uiThreads);
+		for (unsigned int i = 0; i < uiAgents; i++)
+			pPool->addPlanner(pAgents[i]);
+
+		pPool->step(1); // warm up
+
+		std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+		for (unsigned int j = 0; j < uiTicks; j++)
+			pPool->step(1);
+		std::chrono::steady_clock::time_point tEnd = std::chrono::steady_clock::now();
+
+		unsigned long ulChecksum = 0;
+		for (unsigned int i = 0; i < uiAgents; i++)
+			ulChecksum = ulChecksum * 31 + pActions[i].ulCount;
+
+		double dRate = (double)uiAgents * uiTicks / std::chrono::duration<double>(tEnd - tStart).count();
+		if (uiThreads == 1)
+			dBase = dRate;
+		printf("%u,%.0f,%.2f,%lu,%lx\n", uiThreads, dRate, dRate / dBase, pPool->stolenChunks(), ulChecksum);
+
+		delete pPool;
+		for (unsigned int i = 0; i < uiAgents; i++)
+			delete pAgents[i];
+	}
+
+	free((void *)pAgents);
+	delete pOwner;
+	delete[] pActions;
+	delete[] pSenses;
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+//  Instinct Reactive Planning Library
+//  Check that checkReleasers() releases each agent just as checkReleaser() would
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Planner::checkReleasers() is run on random releasers, with random sense values, Drive statuses and latches for
+// a random number of agents, starting at random byte offsets so that the vector loads are unaligned. Every agent's
+// latch, every bit of the release mask and the count of agents released must match the comparisons of checkReleaser(),
+// restated here one agent at a time. The comparators include TR, FL and an unknown value, and the agent counts
+// include those that leave agents over after the last full set of lanes.
+//
+// Build and run from this directory, once for each path that the compiler may pick:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp ReleaserCheck.cpp -o ReleaserCheck
+//    g++ -O2 -pthread -mavx2 -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp ReleaserCheck.cpp -o ReleaserCheck
+//    ./ReleaserCheck [cases]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+#define CHECK_MAX_AGENTS	64
+
+// the comparisons of Planner::testReleaser() for one agent, returning the new latch
+static unsigned char referenceReleaser(const ReleaserType *pReleaser, const int nSenseValue, const unsigned char bDriveStatus,
+	const unsigned char bReleased)
+{
+	unsigned char bLatch = bReleased;
+	int nTriggerValue = pReleaser->nSenseValue;
+
+	if (pReleaser->bComparator == INSTINCT_COMPARATOR_TR)
+		return true;
+	if (pReleaser->bComparator == INSTINCT_COMPARATOR_FL)
+		return false;
+
+	if (bDriveStatus == INSTINCT_STATUS_NOTRUNNING)
+		bLatch = false;
+	int nHysteresis = (bDriveStatus == INSTINCT_STATUS_INTERRUPTED) ? pReleaser->nSenseFlexLatchHysteresis : pReleaser->nSenseHysteresis;
+
+	switch (pReleaser->bComparator)
+	{
+	case INSTINCT_COMPARATOR_EQ:
+		return (nSenseValue == nTriggerValue) ? true : false;
+	case INSTINCT_COMPARATOR_NE:
+		return (nSenseValue != nTriggerValue) ? true : false;
+	case INSTINCT_COMPARATOR_GT:
+		if (bLatch)
+			nTriggerValue -= nHysteresis;
+		return (nSenseValue > nTriggerValue) ? true : false;
+	case INSTINCT_COMPARATOR_LT:
+		if (bLatch)
+			nTriggerValue += nHysteresis;
+		return (nSenseValue < nTriggerValue) ? true : false;
+	}
+	return false;
+}
+
+// a value around the trigger, so that the comparisons and the hysteresis both matter
+static int randomValue(unsigned long *pRandom, const int nRange)
+{
+	return (int)planGenRandom(pRandom, 2 * nRange + 1) - nRange;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long ulCases = argc > 1 ? strtoul(argv[1], 0, 10) : 200000;
+	unsigned long ulRandom = 2016;
+	unsigned long ulFailed = 0;
+	int nSenseBuffer[CHECK_MAX_AGENTS + 4];
+	unsigned char bStatusBuffer[CHECK_MAX_AGENTS + 16];
+	unsigned char bReleasedBuffer[CHECK_MAX_AGENTS + 16];
+	unsigned char bExpected[CHECK_MAX_AGENTS];
+	unsigned char bMask[CHECK_MAX_AGENTS / 8 + 1];
+
+	for (unsigned long c = 0; c < ulCases; c++)
+	{
+		ReleaserType sReleaser;
+		unsigned int uiCount = (unsigned int)planGenRandom(&ulRandom, CHECK_MAX_AGENTS + 1);
+		unsigned int uiExpected = 0;
+		int *pSenseValues = nSenseBuffer + planGenRandom(&ulRandom, 4);
+		unsigned char *pDriveStatus = bStatusBuffer + planGenRandom(&ulRandom, 16);
+		unsigned char *pReleased = bReleasedBuffer + planGenRandom(&ulRandom, 16);
+
+		memset(&sReleaser, 0, sizeof(sReleaser));
+		sReleaser.bComparator = (unsigned char)planGenRandom(&ulRandom, 7); // EQ to FL, and one that is not a comparator
+		sReleaser.nSenseValue = randomValue(&ulRandom, 5);
+		sReleaser.nSenseHysteresis = randomValue(&ulRandom, 3);
+		sReleaser.nSenseFlexLatchHysteresis = randomValue(&ulRandom, 3);
+		for (unsigned int i = 0; i < uiCount; i++)
+		{
+			pSenseValues[i] = sReleaser.nSenseValue + randomValue(&ulRandom, 4);
+			pDriveStatus[i] = (unsigned char)planGenRandom(&ulRandom, 3);
+			pReleased[i] = (unsigned char)planGenRandom(&ulRandom, 2);
+			bExpected[i] = referenceReleaser(&sReleaser, pSenseValues[i], pDriveStatus[i], pReleased[i]);
+			if (bExpected[i])
+				uiExpected++;
+		}
+		memset(bMask, 0xA5, sizeof(bMask)); // checkReleasers() must clear what it does not set
+
+		unsigned int uiReleased = Planner::checkReleasers(&sReleaser, pSenseValues, pDriveStatus, pReleased, bMask, uiCount);
+
+		unsigned char bSame = (uiReleased == uiExpected) ? true : false;
+		for (unsigned int i = 0; i < uiCount; i++)
+		{
+			if ((pReleased[i] != bExpected[i]) || (((bMask[i >> 3] >> (i & 0x07)) & 0x01) != bExpected[i]))
+				bSame = false;
+		}
+		if ((uiCount & 0x07) && (bMask[uiCount >> 3] >> (uiCount & 0x07)))
+			bSame = false; // stray bits beyond the last agent
+		if (!bSame)
+		{
+			if (ulFailed++ < 10)
+				printf("# case %lu differs: comparator %u, %u agents\n", c, sReleaser.bComparator, uiCount);
+		}
+	}
+
+	printf("lanes,cases,cases_differing\n");
+	printf("%u,%lu,%lu\n", Planner::releaserLanes(), ulCases, ulFailed);
+
+	return ulFailed ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+//  Instinct Reactive Planning Library
+//  Check that a plan runs the same way with the sense cache and sense prefetch as without them
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each generated plan is run by two Planners, each in its own world, with senses whose values only change from one
+// plan cycle to the next, as the cache assumes. One Planner has no sense cache. The other caches all but the last
+// two senses with the "C E" command, and marks two of those volatile with "C V". The trace of the Actions each
+// executes, the world's checksum after every cycle, must be the same. The cached Planner must read each volatile
+// and uncached sense exactly as often as the other, and the hit and miss counts returned by "C R" must match the
+// reads of cacheable senses - a miss for the first read of a sense in a cycle, and a hit for every other.
+// A third Planner has the same cache and also prefetches with "C P", through Senses::readSenses(), which is overridden
+// here. If any Drive or CE releaser tests a cacheable sense, it must make exactly one call to readSenses() in every
+// cycle, and none otherwise. It must never call readSense() for a cacheable sense, and must run just as the others do.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp SenseCacheCheck.cpp -o SenseCacheCheck
+//    ./SenseCacheCheck [plans] [cycles]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+#define CHECK_SENSES	8 // the senses used by the generated plans
+#define CHECK_CACHED	6 // senses 6 and 7 are not in the cache
+#define CHECK_VOLATILE(nSense)	(((nSense) == 1) || ((nSense) == 4))
+
+typedef struct {
+	unsigned long ulSeed;
+	unsigned long ulCycle;
+	unsigned long ulReads[CHECK_SENSES]; // calls to readSense() for each sense
+	unsigned long ulReadCycle[CHECK_SENSES]; // the cycle, plus one, in which each sense was last read
+	unsigned long ulFirstReads; // reads of cacheable senses that were the first of that sense in their cycle
+	unsigned long ulBatchCycle; // the cycle, plus one, of the last call to readSenses()
+	unsigned long ulBatchCycles; // cycles with a call to readSenses()
+	unsigned long ulExtraBatches; // calls to readSenses() after the first in a cycle
+} SenseWorldType;
+
+// senses that hold their value through a plan cycle, counting each read
+class CycleSenses : public Senses {
+public:
+	CycleSenses(SenseWorldType *pWorld) { _pWorld = pWorld; }
+	int readSense(const senseID nSense)
+	{
+		if (nSense < CHECK_SENSES)
+		{
+			_pWorld->ulReads[nSense]++;
+			if ((nSense < CHECK_CACHED) && !CHECK_VOLATILE(nSense) && (_pWorld->ulReadCycle[nSense] != _pWorld->ulCycle + 1))
+				_pWorld->ulFirstReads++;
+			_pWorld->ulReadCycle[nSense] = _pWorld->ulCycle + 1;
+		}
+		return senseValue(nSense);
+	}
+
+protected:
+	SenseWorldType *_pWorld;
+	int senseValue(const senseID nSense)
+	{
+		unsigned long ulPeriod = 1 + nSense % 5;
+		return (int)(planGenHash(_pWorld->ulSeed, nSense, _pWorld->ulCycle / ulPeriod) % PLANGEN_SENSE_RANGE);
+	}
+};
+
+// the same senses, also read all at once for prefetch
+class BatchSenses : public CycleSenses {
+public:
+	BatchSenses(SenseWorldType *pWorld) : CycleSenses(pWorld) {}
+	unsigned char readSenses(const senseID *pSenses, int *pSenseValues, const unsigned int uiCount)
+	{
+		if (_pWorld->ulBatchCycle == _pWorld->ulCycle + 1)
+			_pWorld->ulExtraBatches++;
+		else
+			_pWorld->ulBatchCycles++;
+		_pWorld->ulBatchCycle = _pWorld->ulCycle + 1;
+		for (unsigned int i = 0; i < uiCount; i++)
+			pSenseValues[i] = senseValue(pSenses[i]);
+		return true;
+	}
+};
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+static CmdPlanner * loadCommands(const CommandListType *pList, Senses *pSenses, Actions *pActions)
+{
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	char szRtn[20];
+
+	CmdPlanner *pPlan = new CmdPlanner(nNoPlan, pSenses, pActions, 0);
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+		pPlan->executeCommand(pList->pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+
+	return pPlan;
+}
+
+// true if a Drive or CE of the plan has a releaser that tests a cacheable sense, so that there is something to prefetch
+static unsigned char prefetchesSenses(const CommandListType *pList)
+{
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+	{
+		const char *pLine = pList->pLines + i * PLANGEN_LINE_LENGTH;
+		unsigned int uiParams[7];
+		unsigned int uiSense = CHECK_SENSES;
+		unsigned int uiComparator = INSTINCT_COMPARATOR_TR;
+
+		if (sscanf(pLine, "A D %u %u %u %u %u %u", uiParams, uiParams + 1, uiParams + 2, uiParams + 3, &uiSense, &uiComparator) != 6)
+			sscanf(pLine, "A E %u %u %u %u %u %u %u", uiParams, uiParams + 1, uiParams + 2, uiParams + 3, uiParams + 4, &uiSense, &uiComparator);
+		if ((uiSense < CHECK_CACHED) && !CHECK_VOLATILE(uiSense) && (uiComparator != INSTINCT_COMPARATOR_TR) &&
+			(uiComparator != INSTINCT_COMPARATOR_FL))
+			return true;
+	}
+
+	return false;
+}
+
+// set up the sense cache with the plan's own commands, and optionally prefetch. Returns false if any is refused
+static unsigned char enableCache(CmdPlanner *pPlan, const unsigned char bPrefetch)
+{
+	char szCmd[20];
+	char szRtn[20];
+
+	snprintf(szCmd, sizeof(szCmd), "C E %u", CHECK_CACHED);
+	if (!pPlan->executeCommand(szCmd, szRtn, sizeof(szRtn)))
+		return false;
+	for (unsigned int i = 0; i < CHECK_CACHED; i++)
+	{
+		if (!CHECK_VOLATILE(i))
+			continue;
+		snprintf(szCmd, sizeof(szCmd), "C V %u 0", i);
+		if (!pPlan->executeCommand(szCmd, szRtn, sizeof(szRtn)))
+			return false;
+	}
+
+	return bPrefetch ? pPlan->executeCommand("C P 1", szRtn, sizeof(szRtn)) : true;
+}
+
+// run a plan cycle, with a timer tick before it as a robot would, and return the trace so far
+static unsigned long runCycle(CmdPlanner *pPlan, SenseWorldType *pSenseWorld, ScriptedWorldType *pWorld, const unsigned long ulCycle)
+{
+	pSenseWorld->ulCycle = ulCycle;
+	pPlan->processTimers(1);
+	pPlan->runPlan();
+
+	return pWorld->ulChecksum ^ (pWorld->ulActions << 16);
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiPlans = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int uiCycles = argc > 2 ? atoi(argv[2]) : 1000;
+	unsigned long ulCycles = 0;
+	unsigned long ulFailed = 0;
+	unsigned long ulCountFailed = 0;
+	unsigned long ulPrefetchFailed = 0;
+	unsigned long ulHits = 0;
+	unsigned long ulMisses = 0;
+
+	for (unsigned int p = 1; p <= uiPlans; p++)
+	{
+		CommandListType sList;
+		ScriptedWorldType sWorld, sCachedWorld, sPrefetchWorld;
+		SenseWorldType sSenseWorld, sCachedSenseWorld, sPrefetchSenseWorld;
+		CycleSenses senses(&sSenseWorld), cachedSenses(&sCachedSenseWorld);
+		BatchSenses prefetchSenses(&sPrefetchSenseWorld);
+		ScriptedActions actions(&sWorld), cachedActions(&sCachedWorld), prefetchActions(&sPrefetchWorld);
+		char szRtn[30];
+
+		planGenDefaults(&sParams);
+		sParams.ulSeed = p;
+		sParams.uiDrives = 1 + p % 8;
+		sParams.uiDepth = p % 4;
+		sParams.uiSenses = CHECK_SENSES;
+		memset(&sList, 0, sizeof(sList));
+		if (!planGenerate(&sParams, addCommand, &sList))
+			continue;
+
+		memset(&sWorld, 0, sizeof(sWorld));
+		memset(&sSenseWorld, 0, sizeof(sSenseWorld));
+		sWorld.ulSeed = p;
+		sSenseWorld.ulSeed = p;
+		sCachedWorld = sWorld;
+		sCachedSenseWorld = sSenseWorld;
+		sPrefetchWorld = sWorld;
+		sPrefetchSenseWorld = sSenseWorld;
+		CmdPlanner *pPlan = loadCommands(&sList, &senses, &actions);
+		CmdPlanner *pCached = loadCommands(&sList, &cachedSenses, &cachedActions);
+		CmdPlanner *pPrefetch = loadCommands(&sList, &prefetchSenses, &prefetchActions);
+		if (!enableCache(pCached, false))
+			ulCountFailed++;
+		if (!enableCache(pPrefetch, true))
+			ulPrefetchFailed++;
+
+		for (unsigned int i = 0; i < uiCycles; i++)
+		{
+			ulCycles++;
+			unsigned long ulTrace = runCycle(pPlan, &sSenseWorld, &sWorld, i);
+			if ((runCycle(pCached, &sCachedSenseWorld, &sCachedWorld, i) != ulTrace) ||
+				(runCycle(pPrefetch, &sPrefetchSenseWorld, &sPrefetchWorld, i) != ulTrace))
+			{
+				if (ulFailed++ < 10)
+					printf("# plan %u differs at cycle %u\n", p, i);
+			}
+		}
+
+		// every read of a cacheable sense is a hit or a miss, and only the misses call readSense()
+		unsigned long ulPlanHits = 0;
+		unsigned long ulPlanMisses = 0;
+		unsigned long ulCacheableReads = 0;
+		unsigned long ulCachedReads = 0;
+		unsigned char bSame = pCached->executeCommand("C R", szRtn, sizeof(szRtn)) && (sscanf(szRtn, "%lu %lu", &ulPlanHits, &ulPlanMisses) == 2);
+		for (unsigned int s = 0; s < CHECK_SENSES; s++)
+		{
+			if ((s < CHECK_CACHED) && !CHECK_VOLATILE(s))
+			{
+				ulCacheableReads += sSenseWorld.ulReads[s];
+				ulCachedReads += sCachedSenseWorld.ulReads[s];
+			}
+			else if (sSenseWorld.ulReads[s] != sCachedSenseWorld.ulReads[s])
+				bSame = false;
+		}
+		if ((ulPlanHits + ulPlanMisses != ulCacheableReads) || (ulPlanMisses != ulCachedReads) || (ulPlanMisses != sSenseWorld.ulFirstReads))
+			bSame = false;
+		if (!bSame)
+		{
+			if (ulCountFailed++ < 10)
+				printf("# plan %u counts %lu hits %lu misses for %lu reads, %lu first in their cycle\n", p, ulPlanHits, ulPlanMisses,
+					ulCacheableReads, sSenseWorld.ulFirstReads);
+		}
+		ulHits += ulPlanHits;
+		ulMisses += ulPlanMisses;
+
+		// prefetch reads every cacheable releaser sense once at the start of each cycle
+		bSame = (sPrefetchSenseWorld.ulBatchCycles == (prefetchesSenses(&sList) ? uiCycles : 0)) && !sPrefetchSenseWorld.ulExtraBatches;
+		for (unsigned int s = 0; s < CHECK_CACHED; s++)
+		{
+			if (!CHECK_VOLATILE(s) && sPrefetchSenseWorld.ulReads[s])
+				bSame = false;
+		}
+		if (!bSame)
+		{
+			if (ulPrefetchFailed++ < 10)
+				printf("# plan %u prefetches in %lu of %u cycles, with %lu extra calls\n", p, sPrefetchSenseWorld.ulBatchCycles, uiCycles,
+					sPrefetchSenseWorld.ulExtraBatches);
+		}
+
+		delete pPrefetch;
+		delete pCached;
+		delete pPlan;
+		free((void *)sList.pLines);
+	}
+
+	printf("plans,cycles,cycles_differing,counts_differing,prefetch_differing,hits,misses\n");
+	printf("%u,%lu,%lu,%lu,%lu,%lu,%lu\n", uiPlans, ulCycles, ulFailed, ulCountFailed, ulPrefetchFailed, ulHits, ulMisses);
+
+	return (ulFailed || ulCountFailed || ulPrefetchFailed) ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+//  Instinct Reactive Planning Library
+//  Check that saved runtime state puts a plan back into the state it was saved in
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each generated plan is run by one Planner, which saves its runtime state with saveRuntimeState() part way through
+// and then runs on. A second Planner loads the same plan, takes the saved state with restoreRuntimeState() and the
+// scripted world as it was at the save, and runs over the same cycles. The trace of the Actions each executes, the
+// world's checksum after every cycle, must be the same, and so must their runtime state at the end.
+// Every third plan uses tickless timers, so that the Drive timers are rebuilt from the restored values.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp StateCheck.cpp -o StateCheck
+//    ./StateCheck [plans] [cycles]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+static CmdPlanner * loadCommands(const CommandListType *pList, Senses *pSenses, Actions *pActions, const unsigned char bTickless)
+{
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	char szRtn[20];
+
+	CmdPlanner *pPlan = new CmdPlanner(nNoPlan, pSenses, pActions, 0);
+	pPlan->enableTicklessTimers(bTickless);
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+		pPlan->executeCommand(pList->pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+
+	return pPlan;
+}
+
+// run a plan cycle, with a timer tick before it as a robot would, and return the trace so far
+static unsigned long runCycle(CmdPlanner *pPlan, ScriptedWorldType *pWorld)
+{
+	pPlan->processTimers(1);
+	pPlan->runPlan();
+
+	return pWorld->ulChecksum ^ (pWorld->ulActions << 16);
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiPlans = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int uiCycles = argc > 2 ? atoi(argv[2]) : 1000;
+	unsigned long ulCycles = 0;
+	unsigned long ulFailed = 0;
+	unsigned long ulStateFailed = 0;
+
+	unsigned long *pTrace = (unsigned long *)malloc(uiCycles * sizeof(unsigned long));
+	if (!pTrace)
+		return 1;
+
+	for (unsigned int p = 1; p <= uiPlans; p++)
+	{
+		CommandListType sList;
+		ScriptedWorldType sWorld;
+		ScriptedWorldType sSavedWorld;
+		ScriptedSenses senses(&sWorld);
+		ScriptedActions actions(&sWorld);
+		unsigned char bTickless = (p % 3 == 0) ? true : false;
+
+		planGenDefaults(&sParams);
+		sParams.ulSeed = p;
+		sParams.uiDrives = 1 + p % 8;
+		sParams.uiDepth = p % 4;
+		memset(&sList, 0, sizeof(sList));
+		if (!planGenerate(&sParams, addCommand, &sList))
+			continue;
+
+		// run the plan, saving its state half way
+		memset(&sWorld, 0, sizeof(sWorld));
+		sWorld.ulSeed = p;
+		CmdPlanner *pPlan = loadCommands(&sList, &senses, &actions, bTickless);
+		unsigned int uiSaveCycle = uiCycles / 2;
+		unsigned char *pState = 0;
+		unsigned int uiStateSize = 0;
+		for (unsigned int i = 0; i < uiCycles; i++)
+		{
+			if (i == uiSaveCycle)
+			{
+				uiStateSize = pPlan->runtimeStateSize();
+				pState = (unsigned char *)malloc(uiStateSize);
+				if (!pState || !pPlan->saveRuntimeState(pState, uiStateSize))
+					ulStateFailed++;
+				sSavedWorld = sWorld;
+			}
+			pTrace[i] = runCycle(pPlan, &sWorld);
+		}
+
+		// the same plan, restored to the saved state, must run the same way from there on
+		CmdPlanner *pRestored = loadCommands(&sList, &senses, &actions, bTickless);
+		if (!pState || !pRestored->restoreRuntimeState(pState, uiStateSize))
+			ulStateFailed++;
+		sWorld = sSavedWorld;
+		for (unsigned int i = uiSaveCycle; i < uiCycles; i++)
+		{
+			ulCycles++;
+			if (runCycle(pRestored, &sWorld) != pTrace[i])
+			{
+				if (ulFailed++ < 10)
+					printf("# plan %u differs at cycle %u\n", p, i);
+			}
+		}
+
+		// and end in the same state
+		unsigned char *pEndState = (unsigned char *)malloc(uiStateSize);
+		unsigned char *pRestoredState = (unsigned char *)malloc(uiStateSize);
+		if (!pEndState || !pRestoredState || !pPlan->saveRuntimeState(pEndState, uiStateSize) ||
+			!pRestored->saveRuntimeState(pRestoredState, uiStateSize) || memcmp(pEndState, pRestoredState, uiStateSize))
+		{
+			if (ulStateFailed++ < 10)
+				printf("# plan %u ends in a different state\n", p);
+		}
+
+		free((void *)pRestoredState);
+		free((void *)pEndState);
+		free((void *)pState);
+		delete pRestored;
+		delete pPlan;
+		free((void *)sList.pLines);
+	}
+	free((void *)pTrace);
+
+	printf("plans,cycles,cycles_differing,states_differing\n");
+	printf("%u,%lu,%lu,%lu\n", uiPlans, ulCycles, ulFailed, ulStateFailed);
+
+	return (ulFailed || ulStateFailed) ? 1 : 0;
+}
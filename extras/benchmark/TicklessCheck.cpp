@@ -0,0 +1,189 @@
+//  Instinct Reactive Planning Library
+//  Check that a plan runs the same way with tickless timers as with a timer tick
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// Each generated plan is run by two Planners, one with enableTicklessTimers() and one without, each in its own
+// scripted world. Before every cycle both are given the same random time step by processTimers(), and then
+// nextTimerEvent() must give the same answer for both. The trace of the Actions each executes, the world's checksum
+// after every cycle, must be the same. Half way through both save their runtime state, which must be the same. Two
+// more Planners then share the plan of a fifth with sharePlan(), each taking the state saved in the other mode with
+// restoreRuntimeState(), and these must run on just as the first two do.
+//
+// Build and run from this directory with 16 bit ID's, so that large plans can be generated:
+//    g++ -O2 -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp TicklessCheck.cpp -o TicklessCheck
+//    ./TicklessCheck [plans] [cycles]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+#define CHECK_TICKED	0
+#define CHECK_TICKLESS	1
+#define CHECK_PLANNERS	2
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+static CmdPlanner * loadCommands(const CommandListType *pList, Senses *pSenses, Actions *pActions, const unsigned char bTickless)
+{
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	char szRtn[20];
+
+	CmdPlanner *pPlan = new CmdPlanner(nNoPlan, pSenses, pActions, 0);
+	pPlan->enableTicklessTimers(bTickless);
+	for (unsigned int i = 0; i < pList->uiLines; i++)
+		pPlan->executeCommand(pList->pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+
+	return pPlan;
+}
+
+// Move both Planners on by the same time and run a plan cycle. Returns false if they differ in their next timer
+// event or in the trace so far
+static unsigned char runCycles(CmdPlanner **pPlans, ScriptedWorldType *pWorlds, const unsigned int uiTime)
+{
+	unsigned long ulTrace[CHECK_PLANNERS];
+	unsigned int uiNext[CHECK_PLANNERS];
+
+	for (unsigned int i = 0; i < CHECK_PLANNERS; i++)
+	{
+		pPlans[i]->processTimers(uiTime);
+		uiNext[i] = pPlans[i]->nextTimerEvent();
+		pPlans[i]->runPlan();
+		ulTrace[i] = pWorlds[i].ulChecksum ^ (pWorlds[i].ulActions << 16);
+	}
+
+	return ((uiNext[CHECK_TICKED] == uiNext[CHECK_TICKLESS]) && (ulTrace[CHECK_TICKED] == ulTrace[CHECK_TICKLESS])) ? true : false;
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiPlans = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int uiCycles = argc > 2 ? atoi(argv[2]) : 1000;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	unsigned long ulRandom = 2016;
+	unsigned long ulCycles = 0;
+	unsigned long ulFailed = 0;
+	unsigned long ulStateFailed = 0;
+
+	for (unsigned int p = 1; p <= uiPlans; p++)
+	{
+		CommandListType sList;
+		ScriptedWorldType sWorlds[CHECK_PLANNERS];
+		ScriptedWorldType sSharedWorlds[CHECK_PLANNERS];
+		ScriptedSenses senses0(sWorlds), senses1(sWorlds + 1), senses2(sSharedWorlds), senses3(sSharedWorlds + 1);
+		ScriptedActions actions0(sWorlds), actions1(sWorlds + 1), actions2(sSharedWorlds), actions3(sSharedWorlds + 1);
+		CmdPlanner *pPlans[CHECK_PLANNERS];
+		CmdPlanner *pShared[CHECK_PLANNERS];
+		unsigned char *pStates[CHECK_PLANNERS];
+		unsigned int uiStateSize = 0;
+		unsigned int uiSaveCycle = uiCycles / 2;
+
+		planGenDefaults(&sParams);
+		sParams.ulSeed = p;
+		sParams.uiDrives = 1 + p % 8;
+		sParams.uiDepth = p % 4;
+		memset(&sList, 0, sizeof(sList));
+		if (!planGenerate(&sParams, addCommand, &sList))
+			continue;
+
+		memset(sWorlds, 0, sizeof(sWorlds));
+		for (unsigned int w = 0; w < CHECK_PLANNERS; w++)
+			sWorlds[w].ulSeed = p;
+		pPlans[CHECK_TICKED] = loadCommands(&sList, &senses0, &actions0, false);
+		pPlans[CHECK_TICKLESS] = loadCommands(&sList, &senses1, &actions1, true);
+		CmdPlanner *pOwner = loadCommands(&sList, &senses0, &actions0, false);
+		memset(pStates, 0, sizeof(pStates));
+		memset(pShared, 0, sizeof(pShared));
+
+		for (unsigned int i = 0; i < uiCycles; i++)
+		{
+			if (i == uiSaveCycle)
+			{
+				// the state saved in each mode must be the same, and each is restored into a Planner of the other mode
+				uiStateSize = pPlans[CHECK_TICKED]->runtimeStateSize();
+				for (unsigned int j = 0; j < CHECK_PLANNERS; j++)
+				{
+					pStates[j] = (unsigned char *)malloc(uiStateSize);
+					if (!pStates[j] || !pPlans[j]->saveRuntimeState(pStates[j], uiStateSize))
+						ulStateFailed++;
+				}
+				if (pStates[CHECK_TICKED] && pStates[CHECK_TICKLESS] && memcmp(pStates[CHECK_TICKED], pStates[CHECK_TICKLESS], uiStateSize))
+				{
+					if (ulStateFailed++ < 10)
+						printf("# plan %u saves a different state when tickless\n", p);
+				}
+				pShared[CHECK_TICKED] = new CmdPlanner(nNoPlan, &senses2, &actions2, 0);
+				pShared[CHECK_TICKLESS] = new CmdPlanner(nNoPlan, &senses3, &actions3, 0);
+				for (unsigned int j = 0; j < CHECK_PLANNERS; j++)
+				{
+					pShared[j]->enableTicklessTimers(j == CHECK_TICKLESS);
+					if (!pShared[j]->sharePlan(pOwner) || !pStates[1 - j] || !pShared[j]->restoreRuntimeState(pStates[1 - j], uiStateSize))
+						ulStateFailed++;
+				}
+				memcpy(sSharedWorlds, sWorlds, sizeof(sWorlds));
+			}
+
+			unsigned int uiTime = 1 + (unsigned int)planGenRandom(&ulRandom, 4);
+			ulCycles++;
+			unsigned char bSame = runCycles(pPlans, sWorlds, uiTime);
+			if (pShared[CHECK_TICKED])
+			{
+				bSame = runCycles(pShared, sSharedWorlds, uiTime) && bSame;
+				if (sSharedWorlds[CHECK_TICKED].ulChecksum != sWorlds[CHECK_TICKED].ulChecksum)
+					bSame = false;
+			}
+			if (!bSame)
+			{
+				if (ulFailed++ < 10)
+					printf("# plan %u differs at cycle %u\n", p, i);
+			}
+		}
+
+		for (unsigned int j = 0; j < CHECK_PLANNERS; j++)
+		{
+			delete pShared[j];
+			delete pPlans[j];
+			free((void *)pStates[j]);
+		}
+		delete pOwner;
+		free((void *)sList.pLines);
+	}
+
+	printf("plans,cycles,cycles_differing,states_differing\n");
+	printf("%u,%lu,%lu,%lu\n", uiPlans, ulCycles, ulFailed, ulStateFailed);
+
+	return (ulFailed || ulStateFailed) ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+//  Instinct Reactive Planning Library
+//  Check the TraceMonitor ring buffer with the planner and the reader on separate threads
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+// A generated plan runs on one thread with every notification going to a TraceMonitor, which counts the events it is
+// given before writing them. A second thread drains the ring as the plan runs, reading droppedRecords() as it goes,
+// and then drains what is left once the planner has stopped. The records read plus the records dropped must equal the
+// events generated, and the records must come out in plan cycle order. The ring is kept small, so that some
+// records are dropped.
+//
+// Build and run from this directory, under ThreadSanitizer so that any race on the ring is reported:
+//    g++ -O1 -g -fsanitize=thread -pthread -DINSTINCT_16BIT_IDS -I. -I../../src ../../src/*.cpp TraceDrain.cpp -o TraceDrain
+//    ./TraceDrain [cycles] [ring size]
+
+#include "Arduino.h"
+#include "Instinct.h"
+#include "PlanGenerator.h"
+
+using namespace Instinct;
+
+// a TraceMonitor that also counts the events it is given
+class CountingTrace : public TraceMonitor {
+public:
+	unsigned long ulEvents;
+	CountingTrace(TraceRecordType *pBuffer, const unsigned int uiBufferSize) : TraceMonitor(pBuffer, uiBufferSize) { ulEvents = 0; }
+	unsigned char nodeExecuted(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive)
+	{
+		ulEvents++;
+		return TraceMonitor::nodeExecuted(pElement, pRuntime, bNodeType, pDrive);
+	}
+	unsigned char nodeSuccess(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive)
+	{
+		ulEvents++;
+		return TraceMonitor::nodeSuccess(pElement, pRuntime, bNodeType, pDrive);
+	}
+	unsigned char nodeInProgress(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive)
+	{
+		ulEvents++;
+		return TraceMonitor::nodeInProgress(pElement, pRuntime, bNodeType, pDrive);
+	}
+	unsigned char nodeFail(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive)
+	{
+		ulEvents++;
+		return TraceMonitor::nodeFail(pElement, pRuntime, bNodeType, pDrive);
+	}
+	unsigned char nodeError(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive)
+	{
+		ulEvents++;
+		return TraceMonitor::nodeError(pElement, pRuntime, bNodeType, pDrive);
+	}
+	unsigned char nodeSense(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const ReleaserType *pReleaser,
+		const int nSenseValue, const PlanElement *pDrive)
+	{
+		ulEvents++;
+		return TraceMonitor::nodeSense(pElement, pRuntime, bNodeType, pReleaser, nSenseValue, pDrive);
+	}
+};
+
+typedef struct {
+	char *pLines;
+	unsigned int uiLines;
+	unsigned int uiMaxLines;
+} CommandListType;
+
+static void addCommand(void *pContext, const char *pLine)
+{
+	CommandListType *pList = (CommandListType *)pContext;
+
+	if (pList->uiLines >= pList->uiMaxLines)
+	{
+		pList->uiMaxLines = pList->uiMaxLines ? pList->uiMaxLines * 2 : 1024;
+		pList->pLines = (char *)realloc((void *)pList->pLines, pList->uiMaxLines * PLANGEN_LINE_LENGTH);
+	}
+	snprintf(pList->pLines + pList->uiLines * PLANGEN_LINE_LENGTH, PLANGEN_LINE_LENGTH, "%s", pLine);
+	pList->uiLines++;
+}
+
+typedef struct {
+	CountingTrace *pTrace;
+	std::atomic<bool> bDone;
+	unsigned long ulRead;
+	unsigned long ulOutOfOrder;
+	unsigned long ulDroppedSeen;
+} DrainType;
+
+// check that each record is from the same plan cycle as the last one read, or a later one, and is a known event
+static void checkRecord(DrainType *pDrain, const TraceRecordType *pRecord, unsigned long *pLastCycle)
+{
+	if ((pRecord->ulCycle < *pLastCycle) || (pRecord->bEvent > INSTINCT_TRACE_SENSE) || (pRecord->bNodeType >= INSTINCT_NODE_TYPES))
+		pDrain->ulOutOfOrder++;
+	*pLastCycle = pRecord->ulCycle;
+	pDrain->ulRead++;
+}
+
+static void drain(DrainType *pDrain)
+{
+	TraceRecordType sRecords[16];
+	unsigned long ulLastCycle = 0;
+
+	while (!pDrain->bDone.load())
+	{
+		unsigned int uiCount = pDrain->pTrace->readRecords(sRecords, 16);
+		for (unsigned int i = 0; i < uiCount; i++)
+			checkRecord(pDrain, sRecords + i, &ulLastCycle);
+		pDrain->ulDroppedSeen = pDrain->pTrace->droppedRecords(); // it may be read while the planner runs
+		if (!uiCount)
+			std::this_thread::yield();
+	}
+
+	// the planner has stopped, so whatever is left can be read
+	while (pDrain->pTrace->readRecord(sRecords))
+		checkRecord(pDrain, sRecords, &ulLastCycle);
+}
+
+int main(int argc, char **argv)
+{
+	PlanGenParamsType sParams;
+	unsigned int uiCycles = argc > 1 ? atoi(argv[1]) : 20000;
+	unsigned int uiRingSize = argc > 2 ? atoi(argv[2]) : 64;
+	instinctID nNoPlan[INSTINCT_NODE_TYPES] = { 0, 0, 0, 0, 0, 0 };
+	ScriptedWorldType sWorld;
+	ScriptedSenses senses(&sWorld);
+	ScriptedActions actions(&sWorld);
+	CommandListType sList;
+	DrainType sDrain;
+	char szRtn[20];
+
+	TraceRecordType *pBuffer = (TraceRecordType *)malloc(uiRingSize * sizeof(TraceRecordType));
+	if (!pBuffer)
+		return 1;
+
+	planGenDefaults(&sParams);
+	memset(&sList, 0, sizeof(sList));
+	planGenerate(&sParams, addCommand, &sList);
+	CmdPlanner *pPlan = new CmdPlanner(nNoPlan, &senses, &actions, 0);
+	for (unsigned int i = 0; i < sList.uiLines; i++)
+		pPlan->executeCommand(sList.pLines + i * PLANGEN_LINE_LENGTH, szRtn, sizeof(szRtn));
+
+	CountingTrace sTrace(pBuffer, uiRingSize);
+	pPlan->setMonitor(&sTrace);
+	pPlan->setGlobalMonitorFlags(true, true, true, true, true, true);
+
+	memset(&sWorld, 0, sizeof(sWorld));
+	sWorld.ulSeed = 1;
+	sDrain.pTrace = &sTrace;
+	sDrain.bDone.store(false);
+	sDrain.ulRead = 0;
+	sDrain.ulOutOfOrder = 0;
+	sDrain.ulDroppedSeen = 0;
+	std::thread tDrain(drain, &sDrain);
+	for (unsigned int i = 0; i < uiCycles; i++)
+	{
+		pPlan->processTimers(1);
+		pPlan->runPlan();
+	}
+	sDrain.bDone.store(true);
+	tDrain.join();
+
+	unsigned long ulDropped = sTrace.droppedRecords();
+	printf("events,read,dropped,out_of_order\n");
+	printf("%lu,%lu,%lu,%lu\n", sTrace.ulEvents, sDrain.ulRead, ulDropped, sDrain.ulOutOfOrder);
+
+	delete pPlan;
+	free((void *)sList.pLines);
+	free((void *)pBuffer);
+
+	return ((sDrain.ulRead + ulDropped != sTrace.ulEvents) || sDrain.ulOutOfOrder || (sDrain.ulDroppedSeen > ulDropped)) ? 1 : 0;
+}
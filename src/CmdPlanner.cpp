@@ -29,6 +29,8 @@ namespace Instinct {
 CmdPlanner::CmdPlanner(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Monitor *pMonitor)
 		: Planner(pPlanSize, pSenses, pActions, pMonitor)
 {
+	_ulLoadErrorLine = 0;
+	_ulLoadErrorCount = 0;
 }
 
 // return multiple lines of help text explaining all commands. Note lines separated by "!"
@@ -59,11 +61,22 @@ static const char PROGMEM szHelp[] = { "PLAN Commands:!"
 "        A L Runtime_ElementID Runtime_ParentID Runtime_ChildID Order!"
 "D - display a given node, or the highest element ID!"
 "  D [N{display plan settings for a node}|C{display counters for a node}|!"
-"     H{Highest node ID}]!"
-"      The D N and D C commands have 1 parameter as below:!"
-"          D {N|C} Runtime_ElementID!"
+"     L{display latency histograms for a node}|H{Highest node ID}|!"
+"     W{display work counters}]!"
+"      The D N, D C and D L commands have 1 parameter as below:!"
+"          D {N|C|L} Runtime_ElementID!"
+"      D L returns ID E bucket:count ... R bucket:count ... for the!"
+"          non zero buckets of the execution and releaser histograms!"
 "      The D H command takes no parameters.!"
-"U - command not yet supported. Will allow update of individual nodes!"
+"      The D W command has 1 optional parameter, 1 to clear the counters:!"
+"          D W [Clear]!"
+"      D W returns Cycles DrivesScanned CEsScanned APEsScanned!"
+"          ElementLookups FlagsCleared SenseReads MonitorCalls!"
+"U - change an element already in the plan, keeping its runtime values!"
+"  U [D{Drive}|C{Competence}|A{Action}|E{Competence Element}|!"
+"     L{ActionPattern Element}] [parameters]!"
+"    The parameters are the same as for the matching A command. The element!"
+"    with the Runtime_ElementID must be of that type. Fails on a shared plan!"
 "M - Update the monitor flags for a specific node, or the global flags!"
 "  M [N{Node ID}|G{Global flags}]!"
 "      The M N command has 7 parameters!"
@@ -82,6 +95,20 @@ static const char PROGMEM szHelp[] = { "PLAN Commands:!"
 "S - return the size of the plan into a string buffer!"
 "  S [C{return node counts}|S{return total plan size}]!"
 "      The S C and S S commands take no parameters!"
+"L - Link the plan once loaded, resolving the child of every element!"
+"  L [P{link plan}]!"
+"      The L P command takes no parameters. It returns OK, or the ID of the!"
+"      first element whose child cannot be found!"
+"C - Configure the sense cache, or return its hit and miss counts!"
+"  C [E{enable cache}|V{set whether a sense is cacheable}|P{prefetch senses}|!"
+"     R{return counts}]!"
+"      The C E command has 1 parameter, 0 to disable the cache!"
+"          C E SenseCount!"
+"      The C V command has 2 parameters, Cacheable 0 for volatile senses!"
+"          C V SenseID Cacheable!"
+"      The C P command has 1 parameter, 1 to read all releaser senses at once!"
+"          C P Prefetch!"
+"      The C R command takes no parameters. It returns Hits Misses!"
 "I - Set/return the ID of the plan!"
 "  I [S{set the plan ID}|R{return the plan ID}]!"
 "      The I S command takes 1 parameter!"
@@ -96,12 +123,10 @@ unsigned char CmdPlanner::executeCommand(const char * pCmd, char *pRtnBuff, cons
 {
 	unsigned char bSuccess = false;
 	char cCmd[2];
-	int nIntArray[12];
-	static const char PROGMEM szFmt[] = { "%c %c %i %i %i %i %i %i %i %i %i %i %i %i" };
+	int nIntArray[INSTINCT_MAX_COMMAND_PARAMS];
 
 	memset(nIntArray, 0, sizeof(nIntArray)); // set all the parameters to zero before reading
-	int nRtn = sscanf_P(pCmd, szFmt, &cCmd[0], &cCmd[1], &nIntArray[0], &nIntArray[1], &nIntArray[2], &nIntArray[3],
-		&nIntArray[4], &nIntArray[5], &nIntArray[6], &nIntArray[7], &nIntArray[8], &nIntArray[9], &nIntArray[10], &nIntArray[11]);
+	int nRtn = parseCommand(pCmd, cCmd, nIntArray);
 
 	if (pRtnBuff) // clear the return message buffer
 		*pRtnBuff = 0;
@@ -147,8 +172,64 @@ unsigned char CmdPlanner::executeCommand(const char * pCmd, char *pRtnBuff, cons
 			break;
 		}
 		break;
-	case 'U':
-		// TODO
+	case 'U': // change an element already in the plan, keeping its runtime values. The parameters are the same as for A
+		PlanNode sNode;
+		if ((nRtn < 3) || !getNode(&sNode, (instinctID)nIntArray[0]))
+			break;
+		switch (cCmd[1])
+		{
+		case 'D':
+			if ((nRtn != 14) || (sNode.bNodeType != INSTINCT_DRIVE))
+				break;
+			sNode.sElement.sDrive.bRuntime_ChildID = (instinctID)nIntArray[1];
+			sNode.sElement.sDrive.sDrivePriority.bPriority = (instinctID)nIntArray[2];
+			sNode.sElement.sDrive.sFrequency.uiInterval = nIntArray[3];
+			sNode.sElement.sDrive.sReleaser.bSenseID = (senseID)nIntArray[4];
+			sNode.sElement.sDrive.sReleaser.bComparator = (unsigned char)nIntArray[5];
+			sNode.sElement.sDrive.sReleaser.nSenseValue = nIntArray[6];
+			sNode.sElement.sDrive.sReleaser.nSenseHysteresis = nIntArray[7];
+			sNode.sElement.sDrive.sReleaser.nSenseFlexLatchHysteresis = nIntArray[8];
+			sNode.sElement.sDrive.sDrivePriority.bRampIncrement = (instinctID)nIntArray[9];
+			sNode.sElement.sDrive.sDrivePriority.bUrgencyMultiplier = (instinctID)nIntArray[10];
+			sNode.sElement.sDrive.sDrivePriority.uiRampInterval = (instinctID)nIntArray[11];
+			bSuccess = patchNode(&sNode);
+			break;
+		case 'C':
+			if ((nRtn != 4) || (sNode.bNodeType != INSTINCT_COMPETENCE))
+				break;
+			sNode.sElement.sCompetence.bUseORWithinCEGroup = (unsigned char)nIntArray[1];
+			bSuccess = patchNode(&sNode);
+			break;
+		case 'A':
+			if ((nRtn != 5) || (sNode.bNodeType != INSTINCT_ACTION))
+				break;
+			sNode.sElement.sAction.bActionID = (actionID)nIntArray[1];
+			sNode.sElement.sAction.nActionValue = nIntArray[2];
+			bSuccess = patchNode(&sNode);
+			break;
+		case 'E':
+			if ((nRtn != 12) || (sNode.bNodeType != INSTINCT_COMPETENCEELEMENT))
+				break;
+			sNode.sElement.sCompetenceElement.sParentChild.bRuntime_ParentID = (instinctID)nIntArray[1];
+			sNode.sElement.sCompetenceElement.sParentChild.bRuntime_ChildID = (instinctID)nIntArray[2];
+			sNode.sElement.sCompetenceElement.sPriority.bPriority = (instinctID)nIntArray[3];
+			sNode.sElement.sCompetenceElement.sRetry.bRetryLimit = (unsigned char)nIntArray[4];
+			sNode.sElement.sCompetenceElement.sReleaser.bSenseID = (senseID)nIntArray[5];
+			sNode.sElement.sCompetenceElement.sReleaser.bComparator = (unsigned char)nIntArray[6];
+			sNode.sElement.sCompetenceElement.sReleaser.nSenseValue = nIntArray[7];
+			sNode.sElement.sCompetenceElement.sReleaser.nSenseHysteresis = (instinctID)nIntArray[8];
+			sNode.sElement.sCompetenceElement.sReleaser.nSenseFlexLatchHysteresis = (instinctID)nIntArray[9];
+			bSuccess = patchNode(&sNode);
+			break;
+		case 'L':
+			if ((nRtn != 6) || (sNode.bNodeType != INSTINCT_ACTIONPATTERNELEMENT))
+				break;
+			sNode.sElement.sActionPatternElement.sParentChild.bRuntime_ParentID = (instinctID)nIntArray[1];
+			sNode.sElement.sActionPatternElement.sParentChild.bRuntime_ChildID = (instinctID)nIntArray[2];
+			sNode.sElement.sActionPatternElement.bOrder = (instinctID)nIntArray[3];
+			bSuccess = patchNode(&sNode);
+			break;
+		}
 		break;
 	case 'M': // configure the node monitoring
 		switch (cCmd[1])
@@ -227,6 +308,17 @@ unsigned char CmdPlanner::executeCommand(const char * pCmd, char *pRtnBuff, cons
 					bSuccess = displayNodeCounters(pRtnBuff, nRtnBuffLen, (instinctID)nIntArray[0]);
 				}
 				break;
+			case 'L': // display the latency histograms for the given node ID
+				if (nRtn == 3) // we need the node ID
+				{
+					bSuccess = displayNodeLatency(pRtnBuff, nRtnBuffLen, (instinctID)nIntArray[0]);
+				}
+				break;
+			case 'W': // display the work counters, and clear them if asked
+				bSuccess = displayWorkCounters(pRtnBuff, nRtnBuffLen);
+				if ((nRtn == 3) && nIntArray[0])
+					clearWorkCounters();
+				break;
 			case 'H': // return highest node count
 				static const char PROGMEM szFmt[] = {"%u"};
 				snprintf_P(pRtnBuff, nRtnBuffLen, szFmt, (unsigned int)maxElementID());
@@ -235,6 +327,44 @@ unsigned char CmdPlanner::executeCommand(const char * pCmd, char *pRtnBuff, cons
 			}
 		}
 		break;
+	case 'L': // link the plan, and report the first broken reference
+		switch (cCmd[1])
+		{
+		case 'P':
+			bSuccess = linkPlan();
+			if (!bSuccess && pRtnBuff && (nRtnBuffLen > 6))
+			{
+				static const char PROGMEM szFmt[] = {"%u"};
+				snprintf_P(pRtnBuff, nRtnBuffLen, szFmt, (unsigned int)brokenLinkID());
+			}
+			break;
+		}
+		break;
+	case 'C': // configure the sense cache
+		switch (cCmd[1])
+		{
+		case 'E':
+			if (nRtn == 3) // we need the number of senses to cache
+				bSuccess = enableSenseCache((unsigned int)nIntArray[0]);
+			break;
+		case 'V':
+			if (nRtn == 4) // we need the sense ID and whether it is cacheable
+				bSuccess = setSenseCacheable((senseID)nIntArray[0], (unsigned char)nIntArray[1]);
+			break;
+		case 'P':
+			if (nRtn == 3) // we need to know whether to prefetch
+				bSuccess = enableSensePrefetch((unsigned char)nIntArray[0]);
+			break;
+		case 'R': // return the hit and miss counts
+			if (pRtnBuff && (nRtnBuffLen > 22))
+			{
+				static const char PROGMEM szFmt[] = {"%lu %lu"};
+				snprintf_P(pRtnBuff, nRtnBuffLen, szFmt, senseCacheHits(), senseCacheMisses());
+				bSuccess = true;
+			}
+			break;
+		}
+		break;
 	case 'I': // set or return the plan ID
 		if (pRtnBuff && (nRtnBuffLen > 6))
 		{
@@ -263,6 +393,326 @@ unsigned char CmdPlanner::executeCommand(const char * pCmd, char *pRtnBuff, cons
 	return bSuccess;
 }
 
+// the number of parameters each command uses. Commands that check how many they were given reject any more than that
+static unsigned char commandParamCount(const char cCmd0, const char cCmd1)
+{
+	switch (cCmd0)
+	{
+	case 'A':
+		switch (cCmd1)
+		{
+		case 'D': return 12;
+		case 'C': return 2;
+		case 'A': return 3;
+		case 'P': return 1;
+		case 'E': return 10;
+		case 'L': return 4;
+		}
+		break;
+	case 'U':
+		switch (cCmd1)
+		{
+		case 'D': return 12;
+		case 'C': return 2;
+		case 'A': return 3;
+		case 'E': return 10;
+		case 'L': return 4;
+		}
+		break;
+	case 'M':
+		switch (cCmd1)
+		{
+		case 'N': return 7;
+		case 'G': return 6;
+		}
+		break;
+	case 'R':
+		if (cCmd1 == 'I')
+			return 6;
+		break;
+	case 'D':
+		switch (cCmd1)
+		{
+		case 'N':
+		case 'C':
+		case 'L':
+		case 'W':
+			return 1;
+		}
+		break;
+	case 'C':
+		switch (cCmd1)
+		{
+		case 'E':
+		case 'P':
+			return 1;
+		case 'V':
+			return 2;
+		}
+		break;
+	case 'I':
+		if (cCmd1 == 'S')
+			return 1;
+		break;
+	}
+	return 0;
+}
+
+static unsigned char isCommandSpace(const char c)
+{
+	return ((c == ' ') || ((c >= '\t') && (c <= '\r'))) ? true : false;
+}
+
+// read one parameter just as the %i conversion of sscanf() does: white space, an optional sign, then a hexadecimal number
+// after 0x, an octal number after 0, or a decimal number. Values beyond the range of a long are clamped to it, as by strtol().
+// Returns false, leaving *ppCmd unchanged, if there is no number
+static unsigned char readCommandParam(const char **ppCmd, int *pValue)
+{
+	const char *pCmd = *ppCmd;
+	unsigned long ulValue = 0;
+	unsigned long ulLimit = ((unsigned long)-1) >> 1;
+	unsigned char bNegative = false;
+	unsigned char bOverflow = false;
+	unsigned char bBase = 10;
+	unsigned char bDigits = false;
+	unsigned char bDigit;
+
+	while (isCommandSpace(*pCmd))
+		pCmd++;
+	if ((*pCmd == '-') || (*pCmd == '+'))
+		bNegative = (*pCmd++ == '-') ? true : false;
+	if (*pCmd == '0')
+	{
+		// sscanf() takes the x of 0x even when no hexadecimal digit follows it
+		pCmd++;
+		bDigits = true;
+		bBase = 8;
+		if ((*pCmd == 'x') || (*pCmd == 'X'))
+		{
+			pCmd++;
+			bBase = 16;
+		}
+	}
+	for (;; pCmd++)
+	{
+		if ((*pCmd >= '0') && (*pCmd <= '9'))
+			bDigit = *pCmd - '0';
+		else if ((*pCmd >= 'a') && (*pCmd <= 'f'))
+			bDigit = *pCmd - 'a' + 10;
+		else if ((*pCmd >= 'A') && (*pCmd <= 'F'))
+			bDigit = *pCmd - 'A' + 10;
+		else
+			break;
+		if (bDigit >= bBase)
+			break;
+		if (ulValue > ((unsigned long)-1 - bDigit) / bBase)
+			bOverflow = true;
+		else
+			ulValue = ulValue * bBase + bDigit;
+		bDigits = true;
+	}
+	if (!bDigits)
+		return false;
+
+	if (bNegative)
+		ulLimit++;
+	if (bOverflow || (ulValue > ulLimit))
+		ulValue = ulLimit;
+	*pValue = (int)(bNegative ? -(long)(ulValue - 1) - 1 : (long)ulValue);
+	*ppCmd = pCmd;
+
+	return true;
+}
+
+// Split a command into its two command characters and its parameters, in a single pass and without the cost of sscanf_P().
+// Returns the number of fields read, just as sscanf() would with the format "%c %c %i %i ...", except that only the parameters
+// the command uses are read, plus one more to tell whether it has been given too many. pParams must have room for
+// INSTINCT_MAX_COMMAND_PARAMS values, and parameters that are not read are left as they are
+int CmdPlanner::parseCommand(const char *pCmd, char *pCmdChars, int *pParams)
+{
+	int nRtn = 2;
+	int nExtra;
+
+	if (!*pCmd)
+		return -1; // EOF, as for sscanf()
+	pCmdChars[0] = *pCmd++;
+	while (isCommandSpace(*pCmd))
+		pCmd++;
+	if (!*pCmd)
+		return 1;
+	pCmdChars[1] = *pCmd++;
+
+	unsigned char bParams = commandParamCount(pCmdChars[0], pCmdChars[1]);
+	for (unsigned char i = 0; i < bParams; i++)
+	{
+		if (!readCommandParam(&pCmd, pParams + i))
+			return nRtn;
+		nRtn++;
+	}
+	if ((bParams < INSTINCT_MAX_COMMAND_PARAMS) && readCommandParam(&pCmd, &nExtra))
+		nRtn++;
+
+	return nRtn;
+}
+
+// copy the next line of a script into pLine, without its line ending. The script ends at pEnd or at a zero byte.
+// Returns the length of the line, nLineLen if it is too long for pLine, or -1 at the end of the script
+static int readPlanLine(const char **ppText, const char *pEnd, char *pLine, const int nLineLen)
+{
+	const char *pText = *ppText;
+	int nLen = 0;
+
+	if ((pText >= pEnd) || !*pText)
+		return -1;
+
+	for (; (pText < pEnd) && *pText && (*pText != '\n') && (*pText != '\r'); pText++)
+	{
+		if (nLen < nLineLen)
+			pLine[nLen++] = *pText;
+	}
+	if ((pText < pEnd) && (*pText == '\r'))
+		pText++;
+	if ((pText < pEnd) && (*pText == '\n'))
+		pText++;
+	*ppText = pText;
+
+	if (nLen >= nLineLen)
+		return nLineLen;
+	pLine[nLen] = 0;
+
+	return nLen;
+}
+
+// skip the white space and the PLAN prefix that may start a line of a script
+static const char * planCommand(const char *pLine)
+{
+	while (isCommandSpace(*pLine))
+		pLine++;
+	if ((pLine[0] == 'P') && (pLine[1] == 'L') && (pLine[2] == 'A') && (pLine[3] == 'N') && isCommandSpace(pLine[4]))
+	{
+		for (pLine += 4; isCommandSpace(*pLine); pLine++)
+			;
+	}
+
+	return pLine;
+}
+
+// Load a script of plan commands, one to a line, in place of the current plan. Lines may start with PLAN, as they do
+// when sent to the robot, and blank lines are skipped. The script is read twice. The first pass counts the elements
+// of each type and finds the highest ElementID, so that the plan buffers and index are allocated just once,
+// at the right size. R commands are therefore skipped. The second pass executes each command in turn.
+// Returns false if any line fails - see loadErrorLine() and loadErrorCount(). The lines that succeeded stay in the plan
+unsigned char CmdPlanner::loadPlan(const char *pText, const unsigned long ulLength)
+{
+	unsigned long ulCount[INSTINCT_NODE_TYPES];
+	instinctID nPlanSize[INSTINCT_NODE_TYPES];
+	unsigned long ulMaxID = 0;
+	unsigned long ulLine;
+	const char *pEnd = pText + ulLength;
+	const char *pNext;
+	const char *pCmd;
+	char szLine[INSTINCT_MAX_COMMAND_LENGTH + 1];
+	char szRtn[INSTINCT_MAX_COMMAND_LENGTH];
+	char cCmd[2];
+	int nParams[INSTINCT_MAX_COMMAND_PARAMS];
+	int nLen;
+
+	_ulLoadErrorLine = 0;
+	_ulLoadErrorCount = 0;
+	memset(ulCount, 0, sizeof(ulCount));
+
+	// first pass - count the add commands that have the right number of parameters
+	for (pNext = pText; (nLen = readPlanLine(&pNext, pEnd, szLine, sizeof(szLine))) >= 0; )
+	{
+		if (nLen >= (int)sizeof(szLine))
+			continue;
+		pCmd = planCommand(szLine);
+		int nRtn = parseCommand(pCmd, cCmd, nParams);
+		if ((nRtn < 2) || (cCmd[0] != 'A') || (nRtn != commandParamCount(cCmd[0], cCmd[1]) + 2))
+			continue;
+
+		unsigned char nNodeType = INSTINCT_NODE_TYPES;
+		switch (cCmd[1])
+		{
+		case 'D': nNodeType = INSTINCT_DRIVE; break;
+		case 'C': nNodeType = INSTINCT_COMPETENCE; break;
+		case 'A': nNodeType = INSTINCT_ACTION; break;
+		case 'P': nNodeType = INSTINCT_ACTIONPATTERN; break;
+		case 'E': nNodeType = INSTINCT_COMPETENCEELEMENT; break;
+		case 'L': nNodeType = INSTINCT_ACTIONPATTERNELEMENT; break;
+		}
+		if (nNodeType < INSTINCT_NODE_TYPES)
+		{
+			ulCount[nNodeType]++;
+			if ((instinctID)nParams[0] > ulMaxID)
+				ulMaxID = (instinctID)nParams[0];
+		}
+	}
+
+	// any elements beyond the largest plan we can hold fail in the second pass
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		nPlanSize[i] = (instinctID)((ulCount[i] > (unsigned long)INSTINCT_MAX_INSTINCTID) ? INSTINCT_MAX_INSTINCTID : ulCount[i]);
+	if (!initialisePlan(nPlanSize) || !growIndex((unsigned int)((ulMaxID < INSTINCT_MAX_INDEX_SIZE) ? ulMaxID + 1 : INSTINCT_MAX_INDEX_SIZE)))
+		return false;
+
+	// second pass - execute each command
+	for (pNext = pText, ulLine = 1; (nLen = readPlanLine(&pNext, pEnd, szLine, sizeof(szLine))) >= 0; ulLine++)
+	{
+		pCmd = planCommand(szLine);
+		if (nLen < (int)sizeof(szLine))
+		{
+			if (!*pCmd || (*pCmd == 'R'))
+				continue;
+			if (executeCommand(pCmd, szRtn, sizeof(szRtn)))
+				continue;
+		}
+		if (!_ulLoadErrorCount++)
+			_ulLoadErrorLine = ulLine;
+	}
+
+	return _ulLoadErrorCount ? false : true;
+}
+
+#ifndef ARDUINO
+// read a script of plan commands from a file, and load it with loadPlan()
+unsigned char CmdPlanner::loadPlanFromFile(const char *pFileName)
+{
+	FILE *pFile = fopen(pFileName, "rb");
+	long lLength;
+	char *pText;
+	unsigned char bSuccess = false;
+
+	_ulLoadErrorLine = 0;
+	_ulLoadErrorCount = 0;
+	if (!pFile)
+		return false;
+
+	if (!fseek(pFile, 0, SEEK_END) && ((lLength = ftell(pFile)) >= 0) && !fseek(pFile, 0, SEEK_SET))
+	{
+		pText = (char *)malloc(lLength ? lLength : 1);
+		if (pText)
+		{
+			if (fread(pText, 1, lLength, pFile) == (size_t)lLength)
+				bSuccess = loadPlan(pText, (unsigned long)lLength);
+			free((void *)pText);
+		}
+	}
+	fclose(pFile);
+
+	return bSuccess;
+}
+#endif
+
+unsigned long CmdPlanner::loadErrorLine(void)
+{
+	return _ulLoadErrorLine;
+}
+
+unsigned long CmdPlanner::loadErrorCount(void)
+{
+	return _ulLoadErrorCount;
+}
+
 // Display the node as a single line of text suitable for reading back into the plan via executeCommand()
 unsigned char CmdPlanner::displayNode(char *pStrBuff, const int nBuffLen, const instinctID nElementID)
 {
@@ -427,4 +877,54 @@ unsigned char CmdPlanner::displayReleaser(char *pStrBuff, const int nBuffLen, co
 	return true;
 }
 
+// Display the non zero buckets of the latency histograms for the given node as a single line of text.
+// Returns false if latency histograms are not enabled, or the line does not fit in the buffer
+unsigned char CmdPlanner::displayNodeLatency(char *pStrBuff, const int nBuffLen, const instinctID nElementID)
+{
+	static const char PROGMEM szFmtID[] = { "%u" };
+	static const char PROGMEM szFmtHistogram[] = { " %c" };
+	static const char PROGMEM szFmtBucket[] = { " %u:%u" };
+	const LatencyHistogramType *pHistogram;
+	int nLen;
+
+	if (!pStrBuff || (nBuffLen < 8) || !nElementID || !latencyHistogram(nElementID, false))
+		return false;
+
+	nLen = snprintf_P(pStrBuff, nBuffLen, szFmtID, (unsigned int)nElementID);
+	for (unsigned char bReleaser = 0; bReleaser < 2; bReleaser++)
+	{
+		pHistogram = latencyHistogram(nElementID, bReleaser);
+		nLen += snprintf_P(pStrBuff + nLen, nBuffLen - nLen, szFmtHistogram, bReleaser ? 'R' : 'E');
+		if (nLen >= nBuffLen)
+			return false;
+		for (unsigned char i = 0; i < INSTINCT_LATENCY_BUCKETS; i++)
+		{
+			if (!pHistogram->uiCount[i])
+				continue;
+			nLen += snprintf_P(pStrBuff + nLen, nBuffLen - nLen, szFmtBucket, (unsigned int)i, pHistogram->uiCount[i]);
+			if (nLen >= nBuffLen)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Display the work counters as a single line of text
+// Returns false if the line does not fit in the buffer
+unsigned char CmdPlanner::displayWorkCounters(char *pStrBuff, const int nBuffLen)
+{
+	static const char PROGMEM szFmt[] = { "%lu %lu %lu %lu %lu %lu %lu %lu" };
+	WorkCountersType sWork;
+
+	if (!pStrBuff || (nBuffLen < 16))
+		return false;
+
+	workCounters(&sWork);
+	int nLen = snprintf_P(pStrBuff, nBuffLen, szFmt, sWork.ulCycles, sWork.ulDrivesScanned, sWork.ulCEsScanned,
+		sWork.ulAPEsScanned, sWork.ulElementLookups, sWork.ulFlagsCleared, sWork.ulSenseReads, sWork.ulMonitorCalls);
+
+	return (nLen < nBuffLen) ? true : false;
+}
+
 } // /namespace Instinct
\ No newline at end of file
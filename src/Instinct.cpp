@@ -25,9 +25,54 @@
 
 namespace Instinct {
 
+// the default reads each sense in turn
+unsigned char Senses::readSenses(const senseID *pSenses, int *pSenseValues, const unsigned int uiCount)
+{
+	for (unsigned int i = 0; i < uiCount; i++)
+		pSenseValues[i] = readSense(pSenses[i]);
+
+	return true;
+}
+
+#ifdef INSTINCT_SYSTEM_CLOCK
+unsigned long SystemClock::readClock(void)
+{
+#ifdef ARDUINO
+	return micros();
+#else
+	return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+#endif
+
 Planner::Planner(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Monitor *pMonitor)
 	: PlanManager(pPlanSize, pSenses, pActions, pMonitor)
 {
+	_pSenseCache = 0;
+	_uiSenseCacheSize = 0;
+	_uiSenseCacheCycle = 0;
+	_ulSenseCacheHits = 0;
+	_ulSenseCacheMisses = 0;
+	_pPrefetchSenses = 0;
+	_pPrefetchValues = 0;
+	_uiPrefetchSize = 0;
+	_ulPlanCycles = 0;
+	_bTicklessTimers = false;
+	_pClock = 0;
+	_pLatency = 0;
+	_uiLatencySize = 0;
+}
+
+Planner::~Planner()
+{
+	if (_pSenseCache)
+		free((void *)_pSenseCache);
+	if (_pPrefetchSenses)
+		free((void *)_pPrefetchSenses);
+	if (_pPrefetchValues)
+		free((void *)_pPrefetchValues);
+	if (_pLatency)
+		free((void *)_pLatency);
 }
 
 // Called by the robot using the Planner to decrement timers by the given amount.
@@ -42,64 +87,163 @@ Planner::Planner(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Moni
 unsigned char Planner::processTimers(const unsigned int uiTime)
 {
 	PlanElement *pPlanElement;
+	RuntimeElement *pRuntime;
+	unsigned char bReorder = false;
 	int nSize;
+	int nRuntimeSize;
 
 	nSize = sizeFromNodeType(INSTINCT_DRIVE);
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_DRIVE);
 	pPlanElement = _pPlan[INSTINCT_DRIVE];
+	pRuntime = _pRuntime[INSTINCT_DRIVE];
 
 	if (!nSize || !pPlanElement) // should never happen
 		return INSTINCT_ERROR;
 
+	// a tickless Planner moves the timer clock on, and only touches the Drives whose timers have expired
+	if (_bTicklessTimers && (_bTimersValid || buildTimers()))
+	{
+		_ulTimerClock += uiTime;
+		while (_uiTimerCount && ((long)(_pTimerHeap[0].ulDeadline - _ulTimerClock) <= 0))
+		{
+			instinctID nDrive = _pTimerHeap[0].nDrive;
+			DriveTimerType *pTimer = _pDriveTimers + nDrive;
+
+			if (!_pTimerHeap[0].bRamp)
+			{
+				// the Drive may run again once checkDriveFrequency() sees this
+				pTimer->bIntervalPending = false;
+				popTimer();
+				continue;
+			}
+
+			popTimer();
+			pPlanElement = (PlanElement *)((unsigned char *)_pPlan[INSTINCT_DRIVE] + nDrive * nSize);
+			pRuntime = (RuntimeElement *)((unsigned char *)_pRuntime[INSTINCT_DRIVE] + nDrive * nRuntimeSize);
+			pTimer->ulRampDeadline = _ulTimerClock + pPlanElement->sDrive.sDrivePriority.uiRampInterval;
+			pushTimer(nDrive, true, pTimer->ulRampDeadline);
+			rampDrivePriority(&pPlanElement->sDrive, &pRuntime->sDrive);
+			bReorder = true;
+		}
+
+		if (bReorder && _bLinked)
+			sortDriveOrder();
+		return INSTINCT_SUCCESS;
+	}
+
 	for (instinctID i = 0; i < _nNodeCount[INSTINCT_DRIVE]; i++)
 	{
 		// Frequency determines how often a Drive is processed
 		// 0 implies Drive is processed on every cycle
 		if (pPlanElement->sDrive.sFrequency.uiInterval) // only bother with this if Frequency Interval is set up
 		{
-			if (pPlanElement->sDrive.sFrequency.uiRuntime_IntervalCounter > uiTime)
-				pPlanElement->sDrive.sFrequency.uiRuntime_IntervalCounter -= uiTime;
+			if (pRuntime->sDrive.uiRuntime_IntervalCounter > uiTime)
+				pRuntime->sDrive.uiRuntime_IntervalCounter -= uiTime;
 			else
-				pPlanElement->sDrive.sFrequency.uiRuntime_IntervalCounter = 0;
+				pRuntime->sDrive.uiRuntime_IntervalCounter = 0;
 		}
 
 		// Ramp Interval determines how often the RAMP logic is run to alter Drive priority
 		// 0 implies no Ramping of Drive priority
 		if (pPlanElement->sDrive.sDrivePriority.uiRampInterval) // only bother with this if Ramp Interval is set up
 		{
-			if (pPlanElement->sDrive.sDrivePriority.uiRuntime_RampIntervalCounter > uiTime)
-				pPlanElement->sDrive.sDrivePriority.uiRuntime_RampIntervalCounter -= uiTime;
+			if (pRuntime->sDrive.uiRuntime_RampIntervalCounter > uiTime)
+				pRuntime->sDrive.uiRuntime_RampIntervalCounter -= uiTime;
 			else
-				pPlanElement->sDrive.sDrivePriority.uiRuntime_RampIntervalCounter = 0;
+				pRuntime->sDrive.uiRuntime_RampIntervalCounter = 0;
 
 			// can can do the RAMP processing here to modify the Drive priority
-			if (!pPlanElement->sDrive.sDrivePriority.uiRuntime_RampIntervalCounter)
+			if (!pRuntime->sDrive.uiRuntime_RampIntervalCounter)
 			{
-				pPlanElement->sDrive.sDrivePriority.uiRuntime_RampIntervalCounter = pPlanElement->sDrive.sDrivePriority.uiRampInterval;
-
-				// avoid rollover
-				if ((instinctID)-1 - pPlanElement->sDrive.sDrivePriority.bRuntime_Priority > pPlanElement->sDrive.sDrivePriority.bRampIncrement)
-					pPlanElement->sDrive.sDrivePriority.bRuntime_Priority += pPlanElement->sDrive.sDrivePriority.bRampIncrement;
-				else
-					pPlanElement->sDrive.sDrivePriority.bRuntime_Priority = (instinctID)-1; // 0xff or 0xffff
-
-				if (pPlanElement->sDrive.sReleaser.bRuntime_Released && pPlanElement->sDrive.sDrivePriority.bUrgencyMultiplier)
-				{
-					unsigned long lPriority = (unsigned long)pPlanElement->sDrive.sDrivePriority.bRuntime_Priority *
-						(unsigned long)pPlanElement->sDrive.sDrivePriority.bUrgencyMultiplier;
-					lPriority = lPriority / 32;
-					if ((instinctID)-1 - pPlanElement->sDrive.sDrivePriority.bRuntime_Priority > lPriority)
-						pPlanElement->sDrive.sDrivePriority.bRuntime_Priority += lPriority;
-					else
-						pPlanElement->sDrive.sDrivePriority.bRuntime_Priority = (instinctID)-1; // 0xff or 0xffff
-				}
+				pRuntime->sDrive.uiRuntime_RampIntervalCounter = pPlanElement->sDrive.sDrivePriority.uiRampInterval;
+				rampDrivePriority(&pPlanElement->sDrive, &pRuntime->sDrive);
+				bReorder = true;
 			}
 		}
 		pPlanElement = (PlanElement *)((unsigned char *)pPlanElement + nSize);
+		pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + nRuntimeSize);
 	}
 
+	// keep the Drives in priority order for runPlan()
+	if (bReorder && _bLinked)
+		sortDriveOrder();
+
 	return INSTINCT_SUCCESS;
 }
 
+// increase the Runtime_Priority of a Drive whose ramp interval has expired
+void Planner::rampDrivePriority(DriveType *pDrive, DriveRuntimeType *pDriveRuntime)
+{
+	// avoid rollover
+	if ((instinctID)-1 - pDriveRuntime->bRuntime_Priority > pDrive->sDrivePriority.bRampIncrement)
+		pDriveRuntime->bRuntime_Priority += pDrive->sDrivePriority.bRampIncrement;
+	else
+		pDriveRuntime->bRuntime_Priority = (instinctID)-1; // 0xff or 0xffff
+
+	if (pDriveRuntime->bRuntime_Released && pDrive->sDrivePriority.bUrgencyMultiplier)
+	{
+		unsigned long lPriority = (unsigned long)pDriveRuntime->bRuntime_Priority *
+			(unsigned long)pDrive->sDrivePriority.bUrgencyMultiplier;
+		lPriority = lPriority / 32;
+		if ((instinctID)-1 - pDriveRuntime->bRuntime_Priority > lPriority)
+			pDriveRuntime->bRuntime_Priority += lPriority;
+		else
+			pDriveRuntime->bRuntime_Priority = (instinctID)-1; // 0xff or 0xffff
+	}
+}
+
+// In tickless mode processTimers() keeps the Drive timers in a heap ordered by deadline, so it only touches
+// the Drives whose timers expire, and nextTimerEvent() can tell the robot how long it may sleep.
+// The Drive runtime counters are kept up to date whenever they are read, so nothing else changes
+unsigned char Planner::enableTicklessTimers(const unsigned char bTickless)
+{
+	if (!bTickless)
+		syncTimers(true); // hand the timers back to the runtime counters
+
+	_bTicklessTimers = bTickless ? true : false;
+	return true;
+}
+
+// the time until the next Drive timer expires - either a Drive's frequency interval, after which it may run again,
+// or a ramp interval, at which its priority rises. Returns 0 if a ramp is due on the next call to processTimers(),
+// or INSTINCT_NO_TIMER_EVENT if no timer is running
+unsigned int Planner::nextTimerEvent(void)
+{
+	PlanElement *pPlanElement = _pPlan[INSTINCT_DRIVE];
+	RuntimeElement *pRuntime = _pRuntime[INSTINCT_DRIVE];
+	unsigned int uiNext = INSTINCT_NO_TIMER_EVENT;
+
+	if (!pPlanElement)
+		return INSTINCT_NO_TIMER_EVENT;
+
+	if (_bTicklessTimers && (_bTimersValid || buildTimers()))
+	{
+		if (!_uiTimerCount)
+			return INSTINCT_NO_TIMER_EVENT;
+		if ((long)(_pTimerHeap[0].ulDeadline - _ulTimerClock) <= 0)
+			return 0;
+		return (unsigned int)(_pTimerHeap[0].ulDeadline - _ulTimerClock);
+	}
+
+	for (instinctID i = 0; i < _nNodeCount[INSTINCT_DRIVE]; i++)
+	{
+		if (pPlanElement->sDrive.sFrequency.uiInterval && pRuntime->sDrive.uiRuntime_IntervalCounter &&
+			(pRuntime->sDrive.uiRuntime_IntervalCounter < uiNext))
+			uiNext = pRuntime->sDrive.uiRuntime_IntervalCounter;
+		if (pPlanElement->sDrive.sDrivePriority.uiRampInterval && (pRuntime->sDrive.uiRuntime_RampIntervalCounter < uiNext))
+			uiNext = pRuntime->sDrive.uiRuntime_RampIntervalCounter;
+		pPlanElement = (PlanElement *)((unsigned char *)pPlanElement + sizeFromNodeType(INSTINCT_DRIVE));
+		pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + runtimeSizeFromNodeType(INSTINCT_DRIVE));
+	}
+
+	return uiNext;
+}
+
+unsigned long Planner::planCycles(void)
+{
+	return _ulPlanCycles;
+}
+
 // read the sense via the Senses callback - primarily for testing
 int Planner::readSense(const senseID nSense)
 {
@@ -112,6 +256,220 @@ unsigned char Planner::executeAction(const actionID nAction, const int nActionVa
 	return _pActions->executeAction(nAction, nActionValue, bCheckForComplete);
 }
 
+// The sense cache holds the value of each sense read during a plan cycle, so that releasers testing the same sense
+// do not read it again within that cycle. It covers senseID's 0 to uiSenseCount-1, which all start off cacheable.
+// Senses outside that range are always read. An uiSenseCount of zero disables the cache.
+// The hit and miss counters are reset. Returns false if there is not enough memory for the cache
+unsigned char Planner::enableSenseCache(const unsigned int uiSenseCount)
+{
+	if (_pSenseCache)
+	{
+		free((void *)_pSenseCache);
+		_pSenseCache = 0;
+		_uiSenseCacheSize = 0;
+	}
+	_uiSenseCacheCycle = 0;
+	_ulSenseCacheHits = 0;
+	_ulSenseCacheMisses = 0;
+
+	if (!uiSenseCount)
+		return true;
+
+	_pSenseCache = (SenseCacheType *)malloc(uiSenseCount * sizeof(SenseCacheType));
+	if (!_pSenseCache)
+		return false;
+
+	for (unsigned int i = 0; i < uiSenseCount; i++)
+	{
+		_pSenseCache[i].nValue = 0;
+		_pSenseCache[i].uiRuntime_Cycle = 0;
+		_pSenseCache[i].bCacheable = true;
+	}
+	_uiSenseCacheSize = uiSenseCount;
+
+	return true;
+}
+
+// clear bCacheable for a sense whose value may change within a plan cycle, so that it is read every time it is tested
+unsigned char Planner::setSenseCacheable(const senseID nSense, const unsigned char bCacheable)
+{
+	if (nSense >= _uiSenseCacheSize)
+		return false;
+
+	_pSenseCache[nSense].bCacheable = bCacheable ? true : false;
+
+	return true;
+}
+
+// the number of releaser sense reads that used a value already read in the same plan cycle
+unsigned long Planner::senseCacheHits(void)
+{
+	return _ulSenseCacheHits;
+}
+
+// the number of releaser sense reads of cacheable senses that needed a call to readSense()
+unsigned long Planner::senseCacheMisses(void)
+{
+	return _ulSenseCacheMisses;
+}
+
+// With prefetch enabled, every cacheable sense that is tested by a Drive or CE releaser is read into the sense cache
+// with a single call to Senses::readSenses() at the start of each plan cycle, rather than as each releaser is tested.
+// The senses are found when the plan is linked. This needs the sense cache, see enableSenseCache()
+unsigned char Planner::enableSensePrefetch(const unsigned char bPrefetch)
+{
+	_bListReleaserSenses = bPrefetch ? true : false;
+	_bLinked = false; // relink to find the senses
+
+	if (!_bListReleaserSenses && _pReleaserSenses)
+	{
+		free((void *)_pReleaserSenses);
+		_pReleaserSenses = 0;
+		_uiReleaserSenseCount = 0;
+	}
+
+	return true;
+}
+
+// With latency histograms enabled, the time taken by each call to executeDrive(), to the Actions callback and to checkReleaser()
+// is read from pClock and counted into a histogram for the element concerned. Times include those of any children.
+// The histograms are held by ElementID, and are cleared. A pClock of zero disables them.
+// Returns false if there is not enough memory for the histograms
+unsigned char Planner::enableLatencyHistograms(Clock *pClock)
+{
+	if (_pLatency)
+	{
+		free((void *)_pLatency);
+		_pLatency = 0;
+		_uiLatencySize = 0;
+	}
+	_pClock = 0;
+
+	if (!pClock)
+		return true;
+
+	_uiLatencySize = (unsigned int)maxElementID() + 1;
+	_pLatency = (NodeLatencyType *)calloc(_uiLatencySize, sizeof(NodeLatencyType));
+	if (!_pLatency)
+	{
+		_uiLatencySize = 0;
+		return false;
+	}
+	_pClock = pClock;
+
+	return true;
+}
+
+// set every latency histogram count back to zero
+void Planner::clearLatencyHistograms(void)
+{
+	if (_pLatency)
+		memset(_pLatency, 0, _uiLatencySize * sizeof(NodeLatencyType));
+}
+
+// the execution or releaser histogram for the given element, or zero if none has been recorded
+const LatencyHistogramType * Planner::latencyHistogram(const instinctID nElementID, const unsigned char bReleaser)
+{
+	if (!_pLatency || (nElementID >= _uiLatencySize))
+		return 0;
+
+	return bReleaser ? &_pLatency[nElementID].sReleaser : &_pLatency[nElementID].sExecute;
+}
+
+// count the time since ulStart into the histogram of the given element
+void Planner::recordLatency(const PlanElement *pPlanElement, const unsigned char bReleaser, const unsigned long ulStart)
+{
+	unsigned long ulTicks = _pClock->readClock() - ulStart;
+	instinctID nElementID = pPlanElement->sReferences.bRuntime_ElementID;
+
+	// make room for elements added since the histograms were allocated
+	if (nElementID >= _uiLatencySize)
+	{
+		unsigned int uiSize = (unsigned int)maxElementID() + 1;
+		NodeLatencyType *pLatency = (NodeLatencyType *)realloc((void *)_pLatency, uiSize * sizeof(NodeLatencyType));
+		if (!pLatency)
+			return;
+		memset(pLatency + _uiLatencySize, 0, (uiSize - _uiLatencySize) * sizeof(NodeLatencyType));
+		_pLatency = pLatency;
+		_uiLatencySize = uiSize;
+	}
+
+	LatencyHistogramType *pHistogram = bReleaser ? &_pLatency[nElementID].sReleaser : &_pLatency[nElementID].sExecute;
+	unsigned char bBucket = 0;
+	while (ulTicks && (bBucket < INSTINCT_LATENCY_BUCKETS - 1))
+	{
+		ulTicks >>= 1;
+		bBucket++;
+	}
+	if (pHistogram->uiCount[bBucket] != (unsigned int)-1)
+		pHistogram->uiCount[bBucket]++;
+}
+
+// read the cacheable releaser senses into the sense cache for this plan cycle
+void Planner::prefetchSenses(void)
+{
+	unsigned int uiCount = 0;
+
+	if (_uiPrefetchSize < _uiReleaserSenseCount)
+	{
+		senseID *pSenses = (senseID *)realloc((void *)_pPrefetchSenses, _uiReleaserSenseCount * sizeof(senseID));
+		if (pSenses)
+			_pPrefetchSenses = pSenses;
+		int *pValues = (int *)realloc((void *)_pPrefetchValues, _uiReleaserSenseCount * sizeof(int));
+		if (pValues)
+			_pPrefetchValues = pValues;
+		if (!pSenses || !pValues)
+			return; // senses will just be read as they are needed
+		_uiPrefetchSize = _uiReleaserSenseCount;
+	}
+
+	// volatile senses are still read each time they are tested
+	for (unsigned int i = 0; i < _uiReleaserSenseCount; i++)
+	{
+		senseID nSense = _pReleaserSenses[i];
+		if ((nSense < _uiSenseCacheSize) && _pSenseCache[nSense].bCacheable)
+			_pPrefetchSenses[uiCount++] = nSense;
+	}
+
+	if (!uiCount || !_pSenses->readSenses(_pPrefetchSenses, _pPrefetchValues, uiCount))
+		return;
+
+	for (unsigned int i = 0; i < uiCount; i++)
+	{
+		_pSenseCache[_pPrefetchSenses[i]].nValue = _pPrefetchValues[i];
+		_pSenseCache[_pPrefetchSenses[i]].uiRuntime_Cycle = _uiSenseCacheCycle;
+	}
+	_ulSenseCacheMisses += uiCount;
+	_sWork.ulSenseReads += uiCount;
+}
+
+// read a sense for a releaser, using the value already read in this plan cycle if the sense is cached
+int Planner::readReleaserSense(const senseID nSense)
+{
+	SenseCacheType *pEntry;
+
+	if ((nSense >= _uiSenseCacheSize) || !_pSenseCache[nSense].bCacheable)
+	{
+		_sWork.ulSenseReads++;
+		return _pSenses->readSense(nSense);
+	}
+
+	pEntry = _pSenseCache + nSense;
+	if (pEntry->uiRuntime_Cycle == _uiSenseCacheCycle)
+	{
+		_ulSenseCacheHits++;
+	}
+	else
+	{
+		pEntry->nValue = _pSenses->readSense(nSense);
+		pEntry->uiRuntime_Cycle = _uiSenseCacheCycle;
+		_ulSenseCacheMisses++;
+		_sWork.ulSenseReads++;
+	}
+
+	return pEntry->nValue;
+}
+
 
 /*	High level overview for Execution of a plan cycle. At each level the functionality involves searching for the correct child element to execute
 	until we reach the lowest level (Action)
@@ -169,126 +527,153 @@ unsigned char Planner::executeAction(const actionID nAction, const int nActionVa
 // this is the entry point for a plan cycle
 unsigned char Planner::runPlan(void)
 {
-	PlanElement * pDriveNode;
 	PlanElement * pDrive;
-	instinctID nPriority;
+	RuntimeElement * pDriveRuntime;
+	RuntimeElement * pDriveNodeRuntime;
 	instinctID nDriveCount;
 	int nSize;
+	int nRuntimeSize;
 
-	pDriveNode = _pPlan[INSTINCT_DRIVE];
 	nDriveCount = _nNodeCount[INSTINCT_DRIVE];
 
-	if (!pDriveNode || !nDriveCount)
+	if (!_pPlan[INSTINCT_DRIVE] || !nDriveCount)
 		return false;
 
+	// resolve all the child references if the plan has changed since the last cycle
+	if (!_bLinked)
+		linkPlan();
+
+	_ulPlanCycles++;
+	_sWork.ulCycles++;
+	if (_pMonitor)
+	{
+		_sWork.ulMonitorCalls++;
+		_pMonitor->planCycle(_ulPlanCycles);
+	}
+
+	// start a new cycle for the sense cache, so that every cached sense is read again
+	if (_pSenseCache)
+	{
+		if (!++_uiSenseCacheCycle)
+		{
+			// the cycle count has rolled over, so forget every cycle in which a sense was read
+			for (unsigned int i = 0; i < _uiSenseCacheSize; i++)
+				_pSenseCache[i].uiRuntime_Cycle = 0;
+			_uiSenseCacheCycle = 1;
+		}
+		if (_uiReleaserSenseCount)
+			prefetchSenses();
+	}
+
 	nSize = sizeFromNodeType(INSTINCT_DRIVE);
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_DRIVE);
 
-	// first run over all the drives and clear the flag used to mark drives as tested in this cycle
+	// linkPlan() holds the drives in priority order, so run over them in turn, looking for the first one that can be executed.
+	// note that multiple drives may have same priority. In this case the first one added is tested first.
+	// Drives with zero priority are never run
 	for (instinctID i = 0; i < nDriveCount; i++)
 	{
-		pDriveNode->sDrive.sDrivePriority.bRuntime_Checked = false;
-		pDriveNode = (PlanElement *)((unsigned char *)pDriveNode + nSize);
-	}
+		instinctID bDrive = _pDriveOrder[i];
+		pDrive = (PlanElement *)((unsigned char *)_pPlan[INSTINCT_DRIVE] + bDrive * nSize);
+		pDriveRuntime = (RuntimeElement *)((unsigned char *)_pRuntime[INSTINCT_DRIVE] + bDrive * nRuntimeSize);
 
+		if (!pDriveRuntime->sDrive.bRuntime_Priority)
+			break;
+		_sWork.ulDrivesScanned++;
 
-	// now keep running over drives, looking for the highest priority one that can be executed
-	// note that multiple drives may have same priority. In this case the first one we come across is tested first
-	do {
-		pDriveNode = _pPlan[INSTINCT_DRIVE];
-		pDrive = 0;
-		nPriority = 0;
+		// bring the counters of a tickless Drive up to date, and start its frequency timer again if checkDriveFrequency() resets it
+		if (_bTimersValid)
+			syncDriveTimers(bDrive);
+		unsigned char bFrequency = checkDriveFrequency(&pDrive->sDrive, &pDriveRuntime->sDrive);
+		if (_bTimersValid)
+			restartDriveTimer(bDrive);
 
-		for (instinctID i = 0; i < nDriveCount; i++)
+		// we have found the highest priority Drive, so check if it can be released
+		if (bFrequency && (checkReleaser(pDrive, pDriveRuntime, &pDrive->sDrive.sReleaser, pDrive) == INSTINCT_SUCCESS))
 		{
-			if (!pDriveNode->sDrive.sDrivePriority.bRuntime_Checked)
+			// if we can run this Drive, then other currently running drives become suspended
+			// so record that fact in the drives. Only the Drive last executed can be running, unless the plan has changed
+			if (_bRunningDrive >= nDriveCount)
 			{
-				// found an untested drive, so read and store it and its priority
-				if (pDriveNode->sDrive.sDrivePriority.bRuntime_Priority > nPriority)
+				pDriveNodeRuntime = _pRuntime[INSTINCT_DRIVE];
+				for (instinctID j = 0; j < nDriveCount; j++)
 				{
-					nPriority = pDriveNode->sDrive.sDrivePriority.bRuntime_Priority;
-					pDrive = pDriveNode;
+					if ((j != bDrive) && (pDriveNodeRuntime->sDrive.bRuntime_Status == INSTINCT_STATUS_RUNNING))
+						pDriveNodeRuntime->sDrive.bRuntime_Status = INSTINCT_STATUS_INTERRUPTED;
+					pDriveNodeRuntime = (RuntimeElement *)((unsigned char *)pDriveNodeRuntime + nRuntimeSize);
 				}
 			}
-
-			pDriveNode = (PlanElement *)((unsigned char *)pDriveNode + nSize);
-		}
-
-		if (pDrive) // valid Drive node found
-		{
-			// we have found the highest priority Drive, so check if it can be released
-			if (checkDriveFrequency(&pDrive->sDrive) &&
-				(checkReleaser(pDrive, &pDrive->sDrive.sReleaser, &pDrive->sDrive) == INSTINCT_SUCCESS))
+			else if (_bRunningDrive != bDrive)
 			{
-				// if we can run this Drive, then other currently running drives become suspended
-				// so record that fact in the drives
-				pDriveNode = _pPlan[INSTINCT_DRIVE];
-				for (instinctID i = 0; i < nDriveCount; i++)
-				{
-					if ((pDriveNode != pDrive) && (pDriveNode->sDrive.bRuntime_Status == INSTINCT_STATUS_RUNNING))
-						pDriveNode->sDrive.bRuntime_Status = INSTINCT_STATUS_INTERRUPTED;
-					pDriveNode = (PlanElement *)((unsigned char *)pDriveNode + nSize);
-				}
-
-				unsigned char bRtn = executeDrive(pDrive); // execute the Drive
-				if (INSTINCT_RTN(bRtn) == INSTINCT_IN_PROGRESS)
-					pDrive->sDrive.bRuntime_Status = INSTINCT_STATUS_RUNNING;
-				else
-				{
-					pDrive->sDrive.bRuntime_Status = INSTINCT_STATUS_NOTRUNNING;
-					// if the Drive is not running then its releaser must be assumed not to be released
-					pDrive->sDrive.sReleaser.bRuntime_Released = false;
-					// Reset the Runtime_Priority when the Drive completes if Ramping is enabled
-					if (pDrive->sDrive.sDrivePriority.uiRampInterval && (INSTINCT_RTN(bRtn) == INSTINCT_SUCCESS))
-					{
-						pDrive->sDrive.sDrivePriority.bRuntime_Priority = pDrive->sDrive.sDrivePriority.bPriority;
-					}
-				}
-
-				return bRtn;
+				pDriveNodeRuntime = (RuntimeElement *)((unsigned char *)_pRuntime[INSTINCT_DRIVE] + _bRunningDrive * nRuntimeSize);
+				if (pDriveNodeRuntime->sDrive.bRuntime_Status == INSTINCT_STATUS_RUNNING)
+					pDriveNodeRuntime->sDrive.bRuntime_Status = INSTINCT_STATUS_INTERRUPTED;
 			}
+			_bRunningDrive = bDrive;
+
+			unsigned long ulStart = _pClock ? _pClock->readClock() : 0;
+			unsigned char bRtn = executeDrive(pDrive, pDriveRuntime); // execute the Drive
+			if (_pClock)
+				recordLatency(pDrive, false, ulStart);
+			if (INSTINCT_RTN(bRtn) == INSTINCT_IN_PROGRESS)
+				pDriveRuntime->sDrive.bRuntime_Status = INSTINCT_STATUS_RUNNING;
 			else
 			{
-				// this drive is no longer released and so is not running
-				pDrive->sDrive.bRuntime_Status = INSTINCT_STATUS_NOTRUNNING;
-				pDrive->sDrive.sReleaser.bRuntime_Released = false;
-				// mark this node as tested and move on
-				pDrive->sDrive.sDrivePriority.bRuntime_Checked = true;
+				pDriveRuntime->sDrive.bRuntime_Status = INSTINCT_STATUS_NOTRUNNING;
+				// if the Drive is not running then its releaser must be assumed not to be released
+				pDriveRuntime->sDrive.bRuntime_Released = false;
+				// Reset the Runtime_Priority when the Drive completes if Ramping is enabled
+				if (pDrive->sDrive.sDrivePriority.uiRampInterval && (INSTINCT_RTN(bRtn) == INSTINCT_SUCCESS) &&
+					(pDriveRuntime->sDrive.bRuntime_Priority != pDrive->sDrive.sDrivePriority.bPriority))
+				{
+					pDriveRuntime->sDrive.bRuntime_Priority = pDrive->sDrive.sDrivePriority.bPriority;
+					sortDriveOrder();
+				}
 			}
+
+			return bRtn;
+		}
+		else
+		{
+			// this drive is no longer released and so is not running. Move on to the next one
+			pDriveRuntime->sDrive.bRuntime_Status = INSTINCT_STATUS_NOTRUNNING;
+			pDriveRuntime->sDrive.bRuntime_Released = false;
 		}
-	} while (pDrive);
+	}
 
 	return false;
 }
 
 // Execute a specific drive. A drive contains a single child element that may be an Action, ActionPattern or a Competence.
-unsigned char Planner::executeDrive(PlanElement * pDrive)
+unsigned char Planner::executeDrive(PlanElement * pDrive, RuntimeElement *pDriveRuntime)
 {
 	PlanElement *pElement;
+	RuntimeElement *pElementRuntime;
 	unsigned char bRtn;
-	unsigned char bNodeType;
 
 	// update the runtime counter for the drive
-	countExecution(pDrive, INSTINCT_DRIVE);
+	countExecution(pDrive, pDriveRuntime, INSTINCT_DRIVE, pDrive);
 
-	// get a pointer to the child element, and fill nNodeType with its type
-	pElement = findChildAorAPorC(pDrive->sDrive.bRuntime_ChildID, &bNodeType);
+	// get a pointer to the child element, linked by linkPlan()
+	pElement = elementFromIndex(&pDrive->sDrive.sChildLink);
+	pElementRuntime = runtimeFromIndex(&pDrive->sDrive.sChildLink);
 
 	if (!pElement)
 	{
-		countError(pDrive, INSTINCT_DRIVE);
+		countError(pDrive, pDriveRuntime, INSTINCT_DRIVE, pDrive);
 		return INSTINCT_ERROR; // only happens if plan structure is malformed
 	}
 
-	switch (bNodeType)
+	switch (pDrive->sDrive.sChildLink.bNodeType)
 	{
 	case INSTINCT_ACTION:
-		bRtn = executeAction(pElement, pDrive);
+		bRtn = executeAction(pElement, pElementRuntime, pDrive);
 		break;
 	case INSTINCT_ACTIONPATTERN:
-		bRtn = executeActionPattern(pElement, pDrive);
+		bRtn = executeActionPattern(pElement, pElementRuntime, pDrive);
 		break;
 	case INSTINCT_COMPETENCE:
-		bRtn = executeCompetence(pElement, pDrive);
+		bRtn = executeCompetence(pElement, pElementRuntime, pDrive);
 		break;
 	default:
 		bRtn = INSTINCT_FAIL;
@@ -299,19 +684,19 @@ unsigned char Planner::executeDrive(PlanElement * pDrive)
 	switch (INSTINCT_RTN(bRtn))
 	{
 	case INSTINCT_SUCCESS:
-		countSuccess(pDrive, INSTINCT_DRIVE);
+		countSuccess(pDrive, pDriveRuntime, INSTINCT_DRIVE, pDrive);
 		break;
 
 	case INSTINCT_IN_PROGRESS:
-		countInProgress(pDrive, INSTINCT_DRIVE);
+		countInProgress(pDrive, pDriveRuntime, INSTINCT_DRIVE, pDrive);
 		break;
 
 	case INSTINCT_FAIL:
-		countFail(pDrive, INSTINCT_DRIVE);
+		countFail(pDrive, pDriveRuntime, INSTINCT_DRIVE, pDrive);
 		break;
 
 	case INSTINCT_ERROR:
-		countError(pDrive, INSTINCT_DRIVE);
+		countError(pDrive, pDriveRuntime, INSTINCT_DRIVE, pDrive);
 		break;
 	}
 
@@ -320,34 +705,35 @@ unsigned char Planner::executeDrive(PlanElement * pDrive)
 
 // Execute a specific Competence Element. May be from a Competence or a Drive
 // A Competence Element (CE) may contain an Action (A), an Action Pattern (AP), or a Competence (C)
-unsigned char Planner::executeCE(PlanElement *pCE, PlanElement *pDrive)
+unsigned char Planner::executeCE(PlanElement *pCE, RuntimeElement *pCERuntime, PlanElement *pDrive)
 {
 	unsigned char bRtn;
 	PlanElement *pElement;
-	unsigned char bNodeType;
+	RuntimeElement *pElementRuntime;
 
 	// update the runtime counter for this CE
-	countExecution(pCE, INSTINCT_COMPETENCEELEMENT);
+	countExecution(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
 
-	// get a pointer to the child element, and fill nNodeType with its type
-	pElement = findChildAorAPorC(pCE->sCompetenceElement.sParentChild.bRuntime_ChildID, &bNodeType);
+	// get a pointer to the child element, linked by linkPlan()
+	pElement = elementFromIndex(&pCE->sCompetenceElement.sParentChild.sChildLink);
+	pElementRuntime = runtimeFromIndex(&pCE->sCompetenceElement.sParentChild.sChildLink);
 
 	if (!pElement)
 	{
-		countError(pCE, INSTINCT_COMPETENCEELEMENT);
+		countError(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
 		return INSTINCT_ERROR; // only happens if plan structure is malformed
 	}
 
-	switch (bNodeType)
+	switch (pCE->sCompetenceElement.sParentChild.sChildLink.bNodeType)
 	{
 	case INSTINCT_ACTION:
-		bRtn = executeAction(pElement, pDrive);
+		bRtn = executeAction(pElement, pElementRuntime, pDrive);
 		break;
 	case INSTINCT_ACTIONPATTERN:
-		bRtn = executeActionPattern(pElement, pDrive);
+		bRtn = executeActionPattern(pElement, pElementRuntime, pDrive);
 		break;
 	case INSTINCT_COMPETENCE:
-		bRtn = executeCompetence(pElement, pDrive);
+		bRtn = executeCompetence(pElement, pElementRuntime, pDrive);
 		break;
 	default:
 		bRtn = INSTINCT_FAIL;
@@ -358,33 +744,33 @@ unsigned char Planner::executeCE(PlanElement *pCE, PlanElement *pDrive)
 	switch (INSTINCT_RTN(bRtn))
 	{
 	case INSTINCT_SUCCESS:
-		countSuccess(pCE, INSTINCT_COMPETENCEELEMENT);
+		countSuccess(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
 		// reset the retry count
-		pCE->sCompetenceElement.sRetry.bRuntime_RetryCount = 0;
+		pCERuntime->sCompetenceElement.bRuntime_RetryCount = 0;
 		break;
 
 	case INSTINCT_IN_PROGRESS:
-		countInProgress(pCE, INSTINCT_COMPETENCEELEMENT);
+		countInProgress(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
 		break;
 
 	case INSTINCT_FAIL:
 		// deal with CE retries by turning failures into INSTINCT_IN_PROGRESS
 		if ((pCE->sCompetenceElement.sRetry.bRetryLimit > 0) &&
-				(pCE->sCompetenceElement.sRetry.bRuntime_RetryCount < pCE->sCompetenceElement.sRetry.bRetryLimit))
+				(pCERuntime->sCompetenceElement.bRuntime_RetryCount < pCE->sCompetenceElement.sRetry.bRetryLimit))
 		{
-			pCE->sCompetenceElement.sRetry.bRuntime_RetryCount++;
-			countInProgress(pCE, INSTINCT_COMPETENCEELEMENT);
+			pCERuntime->sCompetenceElement.bRuntime_RetryCount++;
+			countInProgress(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
 			bRtn = INSTINCT_RTN_COMBINE(INSTINCT_IN_PROGRESS, INSTINCT_RTN_DATA(bRtn));
 		}
 		else
 		{
 			// we have reached the limit, so reset the retry counter and fail
-			countFail(pCE, INSTINCT_COMPETENCEELEMENT);
-			pCE->sCompetenceElement.sRetry.bRuntime_RetryCount = 0;
+			countFail(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
+			pCERuntime->sCompetenceElement.bRuntime_RetryCount = 0;
 		}
 		break;
 	case INSTINCT_ERROR:
-		countError(pCE, INSTINCT_COMPETENCEELEMENT);
+		countError(pCE, pCERuntime, INSTINCT_COMPETENCEELEMENT, pDrive);
 		break;
 	}
 
@@ -392,31 +778,34 @@ unsigned char Planner::executeCE(PlanElement *pCE, PlanElement *pDrive)
 }
 
 // Execute a specific Action. May be from a Drive (D), Competence Element (CE) or an Action Pattern Element (APE)
-unsigned char Planner::executeAction(PlanElement *pAction, PlanElement *pDrive)
+unsigned char Planner::executeAction(PlanElement *pAction, RuntimeElement *pActionRuntime, PlanElement *pDrive)
 {
 	unsigned char bRtn = 0;
 
 	// update the runtime execution counter for the Action
-	countExecution(pAction, INSTINCT_ACTION);
-	bRtn = _pActions->executeAction(pAction->sAction.bActionID, pAction->sAction.nActionValue, pAction->sAction.bRuntime_CheckForComplete);
+	countExecution(pAction, pActionRuntime, INSTINCT_ACTION, pDrive);
+	unsigned long ulStart = _pClock ? _pClock->readClock() : 0;
+	bRtn = _pActions->executeAction(pAction->sAction.bActionID, pAction->sAction.nActionValue, pActionRuntime->sAction.bRuntime_CheckForComplete);
+	if (_pClock)
+		recordLatency(pAction, false, ulStart);
 
 	switch(INSTINCT_RTN(bRtn))
 	{
 	case INSTINCT_SUCCESS:
-		countSuccess(pAction, INSTINCT_ACTION);
-		pAction->sAction.bRuntime_CheckForComplete = false;
+		countSuccess(pAction, pActionRuntime, INSTINCT_ACTION, pDrive);
+		pActionRuntime->sAction.bRuntime_CheckForComplete = false;
 		break;
 	case INSTINCT_IN_PROGRESS:
-		countInProgress(pAction, INSTINCT_ACTION);
-		pAction->sAction.bRuntime_CheckForComplete = true;
+		countInProgress(pAction, pActionRuntime, INSTINCT_ACTION, pDrive);
+		pActionRuntime->sAction.bRuntime_CheckForComplete = true;
 		break;
 	case INSTINCT_FAIL:
-		countFail(pAction, INSTINCT_ACTION);
-		pAction->sAction.bRuntime_CheckForComplete = false;
+		countFail(pAction, pActionRuntime, INSTINCT_ACTION, pDrive);
+		pActionRuntime->sAction.bRuntime_CheckForComplete = false;
 		break;
 	case INSTINCT_ERROR:
-		countError(pAction, INSTINCT_ACTION);
-		pAction->sAction.bRuntime_CheckForComplete = false;
+		countError(pAction, pActionRuntime, INSTINCT_ACTION, pDrive);
+		pActionRuntime->sAction.bRuntime_CheckForComplete = false;
 		break;
 	}
 
@@ -424,80 +813,82 @@ unsigned char Planner::executeAction(PlanElement *pAction, PlanElement *pDrive)
 }
 
 // Execute a specific Action Pattern. May be from a Drive (D), Competence Element (CE) or an Action Pattern Element (APE)
-unsigned char Planner::executeActionPattern(PlanElement *pActionPattern, PlanElement *pDrive)
+unsigned char Planner::executeActionPattern(PlanElement *pActionPattern, RuntimeElement *pAPRuntime, PlanElement *pDrive)
 {
 	PlanElement * pAPE;
+	RuntimeElement * pAPERuntime;
 	unsigned char bRtn;
 
 	// update the runtime counter for the Action pattern
-	countExecution(pActionPattern, INSTINCT_ACTIONPATTERN);
+	countExecution(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
 
-	if (pActionPattern->sActionPattern.bRuntime_CurrentElementID > 0)
+	if (pAPRuntime->sActionPattern.bRuntime_CurrentElementID > 0)
 	{
 		// The Action Pattern has already determined an APE to execute in a previous cycle.
 		// If it can't be executed then fail and set the bRuntime_CurrentElementID to zero.
-		pAPE = findElement(pActionPattern->sActionPattern.bRuntime_CurrentElementID, INSTINCT_ACTIONPATTERNELEMENT);
+		pAPE = findElement(pAPRuntime->sActionPattern.bRuntime_CurrentElementID, INSTINCT_ACTIONPATTERNELEMENT);
 	}
 	else // find the LOWEST Order APE and execute it
 	{
 		// RHW 28-01-16 We are starting the AP from the start, so clear down the state in all APE's
-		clearAPECompletedFlags(pActionPattern->sReferences.bRuntime_ElementID);
-		pAPE = findNextAPE(pActionPattern->sReferences.bRuntime_ElementID, 0);
+		clearAPECompletedFlags(pActionPattern, pAPRuntime);
+		pAPE = findNextAPE(pActionPattern, pAPRuntime, 0);
 	}
 
 	if (!pAPE) // this should never happen
 	{
-		countError(pActionPattern, INSTINCT_ACTIONPATTERN);
-		pActionPattern->sActionPattern.bRuntime_CurrentElementID = 0;
-		clearAPECompletedFlags(pActionPattern->sReferences.bRuntime_ElementID);
+		countError(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
+		pAPRuntime->sActionPattern.bRuntime_CurrentElementID = 0;
+		clearAPECompletedFlags(pActionPattern, pAPRuntime);
 		return INSTINCT_ERROR;
 	}
 
 	// we have found the APE to execute, so execute it
-	bRtn = executeAPE(pAPE, pDrive);
+	pAPERuntime = runtime(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+	bRtn = executeAPE(pAPE, pAPERuntime, pDrive);
 
 	switch (INSTINCT_RTN(bRtn))
 	{
 	case INSTINCT_SUCCESS:// if we were successful then move on to next
 		// remember that we've completed this APE
-		pAPE->sActionPatternElement.bRuntime_Status = INSTINCT_RUNTIME_SUCCESS;
+		pAPERuntime->sActionPatternElement.bRuntime_Status = INSTINCT_RUNTIME_SUCCESS;
 
 		// find next APE in this AP to execute and store its ID
-		pAPE = findNextAPE(pActionPattern->sReferences.bRuntime_ElementID, pAPE->sActionPatternElement.bOrder);
+		pAPE = findNextAPE(pActionPattern, pAPRuntime, pAPE);
 		if (!pAPE) // nothing left to do, so we are done!
 		{
 			// this AP has succeeded! nothing more to be done except clear the Runtime_CurrentElementID,
 			// clear all the bRuntime_Status flags and update the success counter
-			countSuccess(pActionPattern, INSTINCT_ACTIONPATTERN);
-			pActionPattern->sActionPattern.bRuntime_CurrentElementID = 0;
-			clearAPECompletedFlags(pActionPattern->sReferences.bRuntime_ElementID);
+			countSuccess(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
+			pAPRuntime->sActionPattern.bRuntime_CurrentElementID = 0;
+			clearAPECompletedFlags(pActionPattern, pAPRuntime);
 		}
 		else
 		{
 			// store the CE node to execute on the next cycle
-			countInProgress(pActionPattern, INSTINCT_ACTIONPATTERN);
-			pActionPattern->sActionPattern.bRuntime_CurrentElementID = pAPE->sReferences.bRuntime_ElementID;
+			countInProgress(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
+			pAPRuntime->sActionPattern.bRuntime_CurrentElementID = pAPE->sReferences.bRuntime_ElementID;
 			bRtn = INSTINCT_RTN_COMBINE(INSTINCT_IN_PROGRESS, INSTINCT_RTN_DATA(bRtn));
 		}
 		break;
 
 	case INSTINCT_IN_PROGRESS: // call the same competence step next time
-		countInProgress(pActionPattern, INSTINCT_ACTIONPATTERN);
-		pActionPattern->sActionPattern.bRuntime_CurrentElementID = pAPE->sReferences.bRuntime_ElementID;
+		countInProgress(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
+		pAPRuntime->sActionPattern.bRuntime_CurrentElementID = pAPE->sReferences.bRuntime_ElementID;
 		break;
 
 	case INSTINCT_FAIL:
 		// clear the Runtime_CurrentElementID and clear all the bRuntime_Status flags
-		countFail(pActionPattern, INSTINCT_ACTIONPATTERN);
-		pActionPattern->sActionPattern.bRuntime_CurrentElementID = 0;
-		clearAPECompletedFlags(pActionPattern->sReferences.bRuntime_ElementID);
+		countFail(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
+		pAPRuntime->sActionPattern.bRuntime_CurrentElementID = 0;
+		clearAPECompletedFlags(pActionPattern, pAPRuntime);
 		break;
 
 	case INSTINCT_ERROR:
 		// clear the Runtime_CurrentElementID and clear all the bRuntime_Status flags
-		countError(pActionPattern, INSTINCT_ACTIONPATTERN);
-		pActionPattern->sActionPattern.bRuntime_CurrentElementID = 0;
-		clearAPECompletedFlags(pActionPattern->sReferences.bRuntime_ElementID);
+		countError(pActionPattern, pAPRuntime, INSTINCT_ACTIONPATTERN, pDrive);
+		pAPRuntime->sActionPattern.bRuntime_CurrentElementID = 0;
+		clearAPECompletedFlags(pActionPattern, pAPRuntime);
 		break;
 	}
 
@@ -505,7 +896,7 @@ unsigned char Planner::executeActionPattern(PlanElement *pActionPattern, PlanEle
 }
 
 // Execute a specific Competence. May be from a Drive (D), Competence Element (CE) or an Action Pattern Element (APE)
-unsigned char Planner::executeCompetence(PlanElement *pCompetence, PlanElement *pDrive)
+unsigned char Planner::executeCompetence(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, PlanElement *pDrive)
 {
 	PlanElement * pCE;
 	instinctID nCECount;
@@ -518,40 +909,40 @@ unsigned char Planner::executeCompetence(PlanElement *pCompetence, PlanElement *
 		return INSTINCT_ERROR;
 
 	// update the runtime counter for the Competence
-	countExecution(pCompetence, INSTINCT_COMPETENCE);
+	countExecution(pCompetence, pCompetenceRuntime, INSTINCT_COMPETENCE, pDrive);
 
-	if (pCompetence->sCompetence.bRuntime_CurrentElementID > 0)
-		bRtn = executeCompetenceSubsequent(pCompetence, pDrive);
+	if (pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID > 0)
+		bRtn = executeCompetenceSubsequent(pCompetence, pCompetenceRuntime, pDrive);
 	else
 	{
 		// RHW 28-01-16 we are starting the Competence from the start, so clear the state in the CE's
-		clearCECompletedFlags(pCompetence->sReferences.bRuntime_ElementID);
-		bRtn = executeCompetenceInitial(pCompetence, pDrive);
+		clearCECompletedFlags(pCompetence, pCompetenceRuntime);
+		bRtn = executeCompetenceInitial(pCompetence, pCompetenceRuntime, pDrive);
 	}
 	// check outcome of this cycle
 	switch (INSTINCT_RTN(bRtn))
 	{
 	case INSTINCT_SUCCESS:
 		// call success before we clear down all the state in the C and CE's
-		countSuccess(pCompetence, INSTINCT_COMPETENCE);
-		pCompetence->sCompetence.bRuntime_CurrentElementID = 0;
-		clearCECompletedFlags(pCompetence->sReferences.bRuntime_ElementID);
+		countSuccess(pCompetence, pCompetenceRuntime, INSTINCT_COMPETENCE, pDrive);
+		pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = 0;
+		clearCECompletedFlags(pCompetence, pCompetenceRuntime);
 		break;
 
 	case INSTINCT_IN_PROGRESS:
-		countInProgress(pCompetence, INSTINCT_COMPETENCE);
+		countInProgress(pCompetence, pCompetenceRuntime, INSTINCT_COMPETENCE, pDrive);
 		break;
 
 	case INSTINCT_ERROR:
-		countError(pCompetence, INSTINCT_COMPETENCE);
-		pCompetence->sCompetence.bRuntime_CurrentElementID = 0;
-		clearCECompletedFlags(pCompetence->sReferences.bRuntime_ElementID);
+		countError(pCompetence, pCompetenceRuntime, INSTINCT_COMPETENCE, pDrive);
+		pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = 0;
+		clearCECompletedFlags(pCompetence, pCompetenceRuntime);
 		break;
 
 	case INSTINCT_FAIL:
-		countFail(pCompetence, INSTINCT_COMPETENCE);
-		pCompetence->sCompetence.bRuntime_CurrentElementID = 0;
-		clearCECompletedFlags(pCompetence->sReferences.bRuntime_ElementID);
+		countFail(pCompetence, pCompetenceRuntime, INSTINCT_COMPETENCE, pDrive);
+		pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = 0;
+		clearCECompletedFlags(pCompetence, pCompetenceRuntime);
 		break;
 	}
 
@@ -561,30 +952,32 @@ unsigned char Planner::executeCompetence(PlanElement *pCompetence, PlanElement *
 
 // called by executeCompetence and handles the situation where the bRuntime_CurrentElementID is zero
 // i.e. the first time through the Competence plan execution
-unsigned char Planner::executeCompetenceInitial(PlanElement *pCompetence, PlanElement *pDrive)
+unsigned char Planner::executeCompetenceInitial(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, PlanElement *pDrive)
 {
 	PlanElement *pCE;
+	RuntimeElement *pCERuntime;
 	instinctID nLastCEPriority = 0;
 	instinctID nCEPriority;
 	unsigned char bRtn = INSTINCT_FAIL;
 
 	// find the highest level CE that is releasable and execute it
-	while (pCE = findCEForReleaserCheck(pCompetence->sReferences.bRuntime_ElementID, nLastCEPriority))
+	while (pCE = findCEForReleaserCheck(pCompetence, pCompetenceRuntime, nLastCEPriority))
 	{
 		nCEPriority = pCE->sCompetenceElement.sPriority.bPriority;
+		pCERuntime = runtime(pCE, INSTINCT_COMPETENCEELEMENT);
 
 		// we have found the highest priority CE, so check if it can be released
-		if (checkReleaser(pCE, &pCE->sCompetenceElement.sReleaser, &pDrive->sDrive) == INSTINCT_SUCCESS)
+		if (checkReleaser(pCE, pCERuntime, &pCE->sCompetenceElement.sReleaser, pDrive) == INSTINCT_SUCCESS)
 		{
 			// we can run this CE
-			bRtn = executeCE(pCE, pDrive); // execute the CE
-			bRtn = processExecutedCE(pCE, pCompetence, pDrive, bRtn);
+			bRtn = executeCE(pCE, pCERuntime, pDrive); // execute the CE
+			bRtn = processExecutedCE(pCE, pCERuntime, pCompetence, pCompetenceRuntime, pDrive, bRtn);
 			break;
 		}
 		else
 		{
 			// this CE is not released, cycle round for next highest
-			pCE->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_RELEASED;
+			pCERuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_RELEASED;
 			nLastCEPriority = nCEPriority;
 		}
 	};
@@ -594,16 +987,17 @@ unsigned char Planner::executeCompetenceInitial(PlanElement *pCompetence, PlanEl
 
 // called by executeCompetence and handles the situation where the bRuntime_CurrentElementID is set
 // i.e. we have already started competence execution
-unsigned char Planner::executeCompetenceSubsequent(PlanElement *pCompetence, PlanElement *pDrive)
+unsigned char Planner::executeCompetenceSubsequent(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, PlanElement *pDrive)
 {
 	PlanElement *pCE;
+	RuntimeElement *pCERuntime;
 	instinctID nCEPriority;
 	unsigned char bRtn = INSTINCT_FAIL;
 
 	// The Competence has already determined a CE to execute in a previous cycle.
 	// we need to check the CE can still be released, then execute it. If it can't be executed then
 	// fail and set the bRuntime_CurrentElementID to zero.
-	pCE = findElement(pCompetence->sCompetence.bRuntime_CurrentElementID, INSTINCT_COMPETENCEELEMENT);
+	pCE = findElement(pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID, INSTINCT_COMPETENCEELEMENT);
 
 	if (!pCE) // this should never happen
 	{
@@ -613,23 +1007,25 @@ unsigned char Planner::executeCompetenceSubsequent(PlanElement *pCompetence, Pla
 
 	// clear the status flags for all CE's with same priority, if they were previously not released
 	// as we are going to check them all again now in this cycle
-	clearCENotReleasedStatus(pCompetence->sReferences.bRuntime_ElementID, nCEPriority);
+	clearCENotReleasedStatus(pCompetence, pCompetenceRuntime, nCEPriority);
 
 	while (pCE)
 	{
+		pCERuntime = runtime(pCE, INSTINCT_COMPETENCEELEMENT);
+
 		// we have found the CE to execute, so check if it can be released or if it contains a running AP
 		if (testCEForRunningAP(pCE) ||
-			(checkReleaser(pCE, &pCE->sCompetenceElement.sReleaser, &pDrive->sDrive) == INSTINCT_SUCCESS))
+			(checkReleaser(pCE, pCERuntime, &pCE->sCompetenceElement.sReleaser, pDrive) == INSTINCT_SUCCESS))
 		{
 			// we can run this CE
-			bRtn = executeCE(pCE, pDrive); // execute the CE
-			bRtn = processExecutedCE(pCE, pCompetence, pDrive, bRtn);
+			bRtn = executeCE(pCE, pCERuntime, pDrive); // execute the CE
+			bRtn = processExecutedCE(pCE, pCERuntime, pCompetence, pCompetenceRuntime, pDrive, bRtn);
 			break;
 		}
 		else // the Releaser check has failed
 		{
 			instinctID bNextElementID = 0;
-			pCE->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_RELEASED;
+			pCERuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_RELEASED;
 
 			bRtn = INSTINCT_FAIL;
 			pCE = 0; // we are done with this CE for now
@@ -642,11 +1038,11 @@ unsigned char Planner::executeCompetenceSubsequent(PlanElement *pCompetence, Pla
 			{
 				// bUseORWithinCEGroup so we need to consider elements in the same priority group,
 				// we need to get one of them to be released this cycle or we fail the Competence.
-				if (pCE = findNextCE(pCompetence->sReferences.bRuntime_ElementID, nCEPriority, false, false))
+				if (pCE = findNextCE(pCompetence, pCompetenceRuntime, nCEPriority, false, false))
 				{
 					if (pCE->sCompetenceElement.sPriority.bPriority == nCEPriority) // must be of the same priority or we have failed
 					{
-						pCompetence->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
+						pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
 					}
 					else
 					{
@@ -661,7 +1057,8 @@ unsigned char Planner::executeCompetenceSubsequent(PlanElement *pCompetence, Pla
 }
 
 // once a CE has ben executed, this function processes its return value and takes the appropriate next action
-unsigned char Planner::processExecutedCE(PlanElement *pCE, PlanElement *pCompetence, PlanElement *pDrive, const unsigned char bRetVal)
+unsigned char Planner::processExecutedCE(PlanElement *pCE, RuntimeElement *pCERuntime, PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime,
+	PlanElement *pDrive, const unsigned char bRetVal)
 {
 	unsigned char bRtn = bRetVal;
 	instinctID nCEPriority = pCE->sCompetenceElement.sPriority.bPriority;
@@ -670,44 +1067,44 @@ unsigned char Planner::processExecutedCE(PlanElement *pCE, PlanElement *pCompete
 	{
 	case INSTINCT_SUCCESS: // if we were successful then move on
 		// remember that we've completed this CE
-		pCE->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_SUCCESS;
+		pCERuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_SUCCESS;
 
 		// find next CE in this Competence to execute and store its ID
 		// if bUseORWithinCEGroup then we move up to the next Priority, otherwise we search for same Priority upwards
 		// include CE's that have previously failed the releaser test
-		pCE = findNextCE(pCompetence->sReferences.bRuntime_ElementID, pCE->sCompetenceElement.sPriority.bPriority,
+		pCE = findNextCE(pCompetence, pCompetenceRuntime, pCE->sCompetenceElement.sPriority.bPriority,
 			pCompetence->sCompetence.bUseORWithinCEGroup, true);
 
 		if (pCE) // there is more to do
 		{
 			// next cycle we need to attempt to execute this CE
-			pCompetence->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
+			pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
 			bRtn = INSTINCT_RTN_COMBINE(INSTINCT_IN_PROGRESS, INSTINCT_RTN_DATA(bRtn));
 		}
 		break;
 
 	case INSTINCT_IN_PROGRESS:
-		pCE->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_IN_PROGRESS;
+		pCERuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_IN_PROGRESS;
 
-		pCompetence->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
+		pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
 		break;
 
 	case INSTINCT_FAIL:
 	case INSTINCT_ERROR:
-		pCE->sCompetenceElement.bRuntime_Status = (INSTINCT_RTN(bRtn) == INSTINCT_FAIL) ? INSTINCT_RUNTIME_FAILED : INSTINCT_RUNTIME_ERROR;
+		pCERuntime->sCompetenceElement.bRuntime_Status = (INSTINCT_RTN(bRtn) == INSTINCT_FAIL) ? INSTINCT_RUNTIME_FAILED : INSTINCT_RUNTIME_ERROR;
 
 		// For the OR functionality within a CE group, we should try another element at the same Priority if one exists, else fail the Competence
 		if (pCompetence->sCompetence.bUseORWithinCEGroup)
 		{
 			// although the CE has failed, there may be another one at this priority level that we need to try
 			// include CE's that may previously have failed the releaser check, because they may pass now
-			if (pCE = findNextCE(pCompetence->sReferences.bRuntime_ElementID, pCE->sCompetenceElement.sPriority.bPriority,
+			if (pCE = findNextCE(pCompetence, pCompetenceRuntime, pCE->sCompetenceElement.sPriority.bPriority,
 				false, true))
 			{
 				if (pCE->sCompetenceElement.sPriority.bPriority == nCEPriority)
 				{
 					// there are more options with this priority group, so try the next one
-					pCompetence->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
+					pCompetenceRuntime->sCompetence.bRuntime_CurrentElementID = pCE->sReferences.bRuntime_ElementID;
 					bRtn = INSTINCT_IN_PROGRESS;
 				}
 			}
@@ -716,44 +1113,62 @@ unsigned char Planner::processExecutedCE(PlanElement *pCE, PlanElement *pCompete
 	return bRtn;
 }
 
-// clear the status of all CE's with bParentCompetenceID and nCEPriority level, where status is set to INSTINCT_RUNTIME_NOT_RELEASED
-unsigned char Planner::clearCENotReleasedStatus(const instinctID bParentCompetenceID, const instinctID nCEPriority)
+// clear the status of all CE's of the Competence with nCEPriority level, where status is set to INSTINCT_RUNTIME_NOT_RELEASED
+unsigned char Planner::clearCENotReleasedStatus(PlanElement *pCompetence, RuntimeElement *, const instinctID nCEPriority)
 {
 	PlanElement *pCENode;
-	PlanElement *pCE = 0;
-	instinctID nCECount;
+	RuntimeElement *pCERuntime;
 	int nSize;
+	int nRuntimeSize;
 
-	pCENode = _pPlan[INSTINCT_COMPETENCEELEMENT];
-	nCECount = _nNodeCount[INSTINCT_COMPETENCEELEMENT];
-
-	if (!pCENode || !nCECount) // should never happen
+	if (!_pPlan[INSTINCT_COMPETENCEELEMENT] || !_nNodeCount[INSTINCT_COMPETENCEELEMENT]) // should never happen
 		return INSTINCT_ERROR;
 
 	nSize = sizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
-	for (instinctID i = 0; i < nCECount; i++)
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
+	pCENode = firstChild(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	pCERuntime = firstChildRuntime(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	for (instinctID i = 0; i < pCompetence->sCompetence.sChildren.bElementCount; i++)
 	{
-		// if CE has our Competence as its parent
-		if (pCENode->sCompetenceElement.sParentChild.bRuntime_ParentID == bParentCompetenceID)
+		// the CE's are in priority order, so we are done once we are past this priority
+		if (pCENode->sCompetenceElement.sPriority.bPriority > nCEPriority)
+			break;
+		_sWork.ulFlagsCleared++;
+		if ((pCERuntime->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_RELEASED) &&
+			(pCENode->sCompetenceElement.sPriority.bPriority == nCEPriority) )
 		{
-			// found a candidate CE, Check status and Priority
-			if ((pCENode->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_RELEASED) &&
-				(pCENode->sCompetenceElement.sPriority.bPriority == nCEPriority) )
-			{
-				pCENode->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
-			}
+			pCERuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
 		}
 		pCENode = (PlanElement *)((unsigned char *)pCENode + nSize);
+		pCERuntime = (RuntimeElement *)((unsigned char *)pCERuntime + nRuntimeSize);
 	}
 	return INSTINCT_SUCCESS;
 
 }
 
 
-// check if a specific releaser can be released.
+// check if a specific releaser can be released, timing the check if latency histograms are enabled
+unsigned char Planner::checkReleaser(PlanElement *pPlanElement, RuntimeElement *pRuntime, ReleaserType * pReleaser, PlanElement *pDrive)
+{
+	if (!_pClock)
+		return testReleaser(pPlanElement, pRuntime, pReleaser, pDrive);
+
+	unsigned long ulStart = _pClock->readClock();
+	unsigned char bRtn = testReleaser(pPlanElement, pRuntime, pReleaser, pDrive);
+	if (_pClock)
+		recordLatency(pPlanElement, true, ulStart);
+
+	return bRtn;
+}
+
+// test a releaser, updating the latch in the Drive or CE.
 // pDrive points to the [parent] Drive, to check if it was interrupted, to determine if Flexible Latching should be applied
-unsigned char Planner::checkReleaser(PlanElement *pPlanElement, ReleaserType * pReleaser, DriveType *pDrive)
+// pRuntime holds the runtime values of the Drive or CE that the releaser belongs to
+unsigned char Planner::testReleaser(PlanElement *pPlanElement, RuntimeElement *pRuntime, ReleaserType * pReleaser, PlanElement *pDrive)
 {
+	unsigned char nNodeType = (pPlanElement == pDrive) ? INSTINCT_DRIVE : INSTINCT_COMPETENCEELEMENT;
+	RuntimeElement *pDriveRuntime = (nNodeType == INSTINCT_DRIVE) ? pRuntime : runtime(pDrive, INSTINCT_DRIVE);
+	unsigned char *pReleased = (nNodeType == INSTINCT_DRIVE) ? &pRuntime->sDrive.bRuntime_Released : &pRuntime->sCompetenceElement.bRuntime_Released;
 	int nSenseValue;
 	int nTriggerValue;
 	int nHysteresis;
@@ -762,27 +1177,27 @@ unsigned char Planner::checkReleaser(PlanElement *pPlanElement, ReleaserType * p
 	// for INSTINCT_COMPARATOR_TR we don't need to read the sense. Just return SUCCESS or FAIL
 	if (pReleaser->bComparator == INSTINCT_COMPARATOR_TR)
 	{
-		pReleaser->bRuntime_Released = true;
-		countSense(pPlanElement, pReleaser, 0);
+		*pReleased = true;
+		countSense(pPlanElement, pRuntime, nNodeType, pReleaser, 0, pDrive);
 		return INSTINCT_SUCCESS;
 	}
 	else if (pReleaser->bComparator == INSTINCT_COMPARATOR_FL)
 	{
-		pReleaser->bRuntime_Released = false;
-		countSense(pPlanElement, pReleaser, 0);
+		*pReleased = false;
+		countSense(pPlanElement, pRuntime, nNodeType, pReleaser, 0, pDrive);
 		return INSTINCT_FAIL;
 	}
 
 	// if the Drive has not been running, then the Releaser must be assumed to be not released
-	if (pDrive->bRuntime_Status == INSTINCT_STATUS_NOTRUNNING)
+	if (pDriveRuntime->sDrive.bRuntime_Status == INSTINCT_STATUS_NOTRUNNING)
 	{
-		pReleaser->bRuntime_Released = false;
+		*pReleased = false;
 	}
 
-	nSenseValue = _pSenses->readSense(pReleaser->bSenseID);
+	nSenseValue = readReleaserSense(pReleaser->bSenseID);
 	nTriggerValue = pReleaser->nSenseValue;
 	// determine the correct Hysteresis value to use, dependent on whether the Drive has been interrupted
-	nHysteresis = (pDrive->bRuntime_Status == INSTINCT_STATUS_INTERRUPTED) ?
+	nHysteresis = (pDriveRuntime->sDrive.bRuntime_Status == INSTINCT_STATUS_INTERRUPTED) ?
 		pReleaser->nSenseFlexLatchHysteresis :
 		pReleaser->nSenseHysteresis;
 
@@ -798,14 +1213,14 @@ unsigned char Planner::checkReleaser(PlanElement *pPlanElement, ReleaserType * p
 		break;
 	case INSTINCT_COMPARATOR_GT:
 		// if sense was triggered on last cycle then use hysteresis
-		if (pReleaser->bRuntime_Released)
+		if (*pReleased)
 			nTriggerValue -= nHysteresis;
 		if (nSenseValue > nTriggerValue)
 			bReleased = INSTINCT_SUCCESS;
 		break;
 	case INSTINCT_COMPARATOR_LT:
 		// if sense was triggered on last cycle then use hysteresis
-		if (pReleaser->bRuntime_Released)
+		if (*pReleased)
 			nTriggerValue += nHysteresis;
 		if (nSenseValue < nTriggerValue)
 			bReleased = INSTINCT_SUCCESS;
@@ -813,9 +1228,9 @@ unsigned char Planner::checkReleaser(PlanElement *pPlanElement, ReleaserType * p
 	default: // some incorrect comparator value
 		bReleased = INSTINCT_ERROR;
 	}
-	pReleaser->bRuntime_Released = (bReleased == INSTINCT_SUCCESS) ? true : false;
+	*pReleased = (bReleased == INSTINCT_SUCCESS) ? true : false;
 
-	countSense(pPlanElement, pReleaser, nSenseValue);
+	countSense(pPlanElement, pRuntime, nNodeType, pReleaser, nSenseValue, pDrive);
 	return bReleased;
 }
 
@@ -823,33 +1238,51 @@ unsigned char Planner::checkReleaser(PlanElement *pPlanElement, ReleaserType * p
 // Returns true if the timer has timed out. If the timer has timed out then reset it for next time!
 // The timer is decremented via the processTimers() call, so the actual timing
 // depends on how frequently processTimers() is called - might be plan cycles or real time
-unsigned char Planner::checkDriveFrequency(DriveType *pDrive)
+unsigned char Planner::checkDriveFrequency(DriveType *pDrive, DriveRuntimeType *pDriveRuntime)
 {
-	if (pDrive->bRuntime_Status == INSTINCT_STATUS_RUNNING)
+	if (pDriveRuntime->bRuntime_Status == INSTINCT_STATUS_RUNNING)
 	{
 		// I am already running
 		return true;
 	}
-	else if (!pDrive->sFrequency.uiRuntime_IntervalCounter)
+	else if (!pDriveRuntime->uiRuntime_IntervalCounter)
 	{
 		// start running and reset my interval counter for next time
-		pDrive->sFrequency.uiRuntime_IntervalCounter = pDrive->sFrequency.uiInterval;
+		pDriveRuntime->uiRuntime_IntervalCounter = pDrive->sFrequency.uiInterval;
 		return true;
 	}
 	return false;
 }
 
+// a tickless Drive's frequency timer starts again once checkDriveFrequency() has reset its expired counter
+void Planner::restartDriveTimer(const instinctID nDrive)
+{
+	PlanElement *pElement = (PlanElement *)((unsigned char *)_pPlan[INSTINCT_DRIVE] + nDrive * sizeFromNodeType(INSTINCT_DRIVE));
+	RuntimeElement *pRuntime = (RuntimeElement *)((unsigned char *)_pRuntime[INSTINCT_DRIVE] + nDrive * runtimeSizeFromNodeType(INSTINCT_DRIVE));
+	DriveTimerType *pTimer = _pDriveTimers + nDrive;
+
+	if (pElement->sDrive.sFrequency.uiInterval && !pTimer->bIntervalPending && pRuntime->sDrive.uiRuntime_IntervalCounter)
+	{
+		pTimer->bIntervalPending = true;
+		pTimer->ulIntervalDeadline = _ulTimerClock + pRuntime->sDrive.uiRuntime_IntervalCounter;
+		pushTimer(nDrive, false, pTimer->ulIntervalDeadline);
+	}
+}
+
 // Tests whether this CE contains an AP, and if so whether the AP is running.
 // It is used to inhibit reading the Releaser for the CE to allow the AP to complete.
 unsigned char Planner::testCEForRunningAP(PlanElement *pCE)
 {
-	PlanElement *pAP;
+	RuntimeElement *pAPRuntime;
+
+	// the child of this CE may not be an AP
+	if (pCE->sCompetenceElement.sParentChild.sChildLink.bNodeType != INSTINCT_ACTIONPATTERN)
+		return false;
 
-	// look for a pointer to an AP element with this CE as parent, may not be an AP
-	pAP = findElement(pCE->sCompetenceElement.sParentChild.bRuntime_ChildID, INSTINCT_ACTIONPATTERN);
-	if (pAP)
+	pAPRuntime = runtimeFromIndex(&pCE->sCompetenceElement.sParentChild.sChildLink);
+	if (pAPRuntime)
 	{
-		if (pAP->sActionPattern.bRuntime_CurrentElementID)
+		if (pAPRuntime->sActionPattern.bRuntime_CurrentElementID)
 		{
 			return true;
 		}
@@ -860,214 +1293,214 @@ unsigned char Planner::testCEForRunningAP(PlanElement *pCE)
 
 // This is a helper function encapsulating some complex search logic. It is used by execututeDrive and executeCompetence and it correctly finds
 // the next CE element to attempt, based on the ID of the last attempted element and two flags. The flags must be correctly set to get the right result.
-// It searches over Competence Elements and returns the lowest ordered item for a particular Parent CompetenceID that has not been attempted yet,
+// It searches over the Competence Elements of the Competence and returns the lowest ordered item that has not been attempted yet,
 // but with the same or higher priority than the last element than was completed.
 // However, If bNextLevel is set, then we cannot find a CE at the same priority level as the last one attempted.
 // If bIncludeNotReleased is set, then we can also return items that have previously failed the releaser check.
 // if no match then a null pointer is returned.
-PlanElement * Planner::findNextCE(const instinctID bParentCompetenceID, const instinctID bLastElementPriority,
+// The CE's of a Competence are held in priority order by linkPlan(), so the first one matching the criteria is the one we want
+PlanElement * Planner::findNextCE(PlanElement *pCompetence, RuntimeElement *, const instinctID bLastElementPriority,
 		const unsigned char bNextLevel, const unsigned char bIncludeNotReleased)
 {
 	PlanElement *pCENode;
-	PlanElement *pCE = 0;
-	instinctID nCEPriority;
-	instinctID nCECount;
+	RuntimeElement *pCERuntime;
 	int nSize;
+	int nRuntimeSize;
 
-	pCENode = _pPlan[INSTINCT_COMPETENCEELEMENT];
-	nCECount = _nNodeCount[INSTINCT_COMPETENCEELEMENT];
-
-	if (!pCENode || !nCECount) // should never happen
+	if (!_pPlan[INSTINCT_COMPETENCEELEMENT] || !_nNodeCount[INSTINCT_COMPETENCEELEMENT]) // should never happen
 		return 0;
 
 	nSize = sizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
-	nCEPriority = (instinctID)-1; // highest unsigned value 0xff or 0xffff
-	for (instinctID i = 0; i < nCECount; i++)
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
+	pCENode = firstChild(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	pCERuntime = firstChildRuntime(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	for (instinctID i = 0; i < pCompetence->sCompetence.sChildren.bElementCount; i++)
 	{
-		// if CE has our Competence as its parent
-		if (pCENode->sCompetenceElement.sParentChild.bRuntime_ParentID == bParentCompetenceID)
+		// the highest priority value (0xff or 0xffff) is never returned
+		if (pCENode->sCompetenceElement.sPriority.bPriority == (instinctID)-1)
+			break;
+		_sWork.ulCEsScanned++;
+
+		if (((pCERuntime->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_TESTED) || // must be untested or previously unreleased
+			 (bIncludeNotReleased && (pCERuntime->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_RELEASED))) &&
+			((bNextLevel && (pCENode->sCompetenceElement.sPriority.bPriority > bLastElementPriority)) || // must be higher priority if OR
+			(!bNextLevel && (pCENode->sCompetenceElement.sPriority.bPriority >= bLastElementPriority)))) // must do all at same priority if AND
 		{
-			// found a candidate CE, so read and store its Order
-			if (((pCENode->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_TESTED) || // must be untested or previously unreleased
-				 (bIncludeNotReleased && (pCENode->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_RELEASED))) &&
-				(pCENode->sCompetenceElement.sPriority.bPriority < nCEPriority) && // return the first one we find matching the criteria
-				((bNextLevel && (pCENode->sCompetenceElement.sPriority.bPriority > bLastElementPriority)) || // must be higher priority if OR
-				(!bNextLevel && (pCENode->sCompetenceElement.sPriority.bPriority >= bLastElementPriority)))) // must do all at same priority if AND
-			{
-				nCEPriority = pCENode->sCompetenceElement.sPriority.bPriority;
-				pCE = pCENode;
-			}
+			return pCENode;
 		}
 		pCENode = (PlanElement *)((unsigned char *)pCENode + nSize);
+		pCERuntime = (RuntimeElement *)((unsigned char *)pCERuntime + nRuntimeSize);
 	}
-	return pCE;
+	return 0;
 }
 
 // This is called only when first entering a Competence or Drive and determining which level to start execution.
 // Start from bLastElementPriority and work down till we find an untested CE. If bLastElementPriority is 0 then start at the top.
-PlanElement * Planner::findCEForReleaserCheck(const instinctID bParentCompetenceID, const instinctID bLastElementPriority)
+// The CE's of a Competence are held in priority order by linkPlan(), so work back from the highest priority CE.
+PlanElement * Planner::findCEForReleaserCheck(PlanElement *pCompetence, RuntimeElement *, const instinctID bLastElementPriority)
 {
 	PlanElement *pCENode;
 	PlanElement *pCE = 0;
-	instinctID nCEPriority;
-	instinctID nCECount;
+	RuntimeElement *pCERuntime;
 	int nSize;
+	int nRuntimeSize;
 
-	pCENode = _pPlan[INSTINCT_COMPETENCEELEMENT];
-	nCECount = _nNodeCount[INSTINCT_COMPETENCEELEMENT];
-
-	if (!pCENode || !nCECount) // should never happen
+	if (!_pPlan[INSTINCT_COMPETENCEELEMENT] || !_nNodeCount[INSTINCT_COMPETENCEELEMENT]) // should never happen
 		return 0;
 
 	nSize = sizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
-
-	nCEPriority = 0;
-	for (instinctID i = 0; i < nCECount; i++)
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
+	pCENode = firstChild(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	pCENode = (PlanElement *)((unsigned char *)pCENode + pCompetence->sCompetence.sChildren.bElementCount * nSize);
+	pCERuntime = firstChildRuntime(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	pCERuntime = (RuntimeElement *)((unsigned char *)pCERuntime + pCompetence->sCompetence.sChildren.bElementCount * nRuntimeSize);
+	for (instinctID i = 0; i < pCompetence->sCompetence.sChildren.bElementCount; i++)
 	{
-		if (pCENode->sCompetenceElement.sParentChild.bRuntime_ParentID == bParentCompetenceID)
+		pCENode = (PlanElement *)((unsigned char *)pCENode - nSize);
+		pCERuntime = (RuntimeElement *)((unsigned char *)pCERuntime - nRuntimeSize);
+
+		// once we have a CE, we only need to look for one added earlier at the same priority level
+		// CE's with zero priority are never returned
+		if ((pCE && (pCENode->sCompetenceElement.sPriority.bPriority < pCE->sCompetenceElement.sPriority.bPriority)) ||
+			!pCENode->sCompetenceElement.sPriority.bPriority)
+			break;
+		_sWork.ulCEsScanned++;
+
+		// we are only looking for NOT_TESTED nodes. If the Releaser check has failed then we will see NOTRELEASED on tested nodes
+		// need to also consider untested nodes at same priority as the last one, as there may be more than one
+		// at this stage we always find any node that is releasable within a group, and execute it.
+		if ((pCERuntime->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_TESTED) &&
+			(!bLastElementPriority || (pCENode->sCompetenceElement.sPriority.bPriority <= bLastElementPriority)))
 		{
-			// we are only looking for NOT_TESTED nodes. If the Releaser check has failed then we will see NOTRELEASED on tested nodes
-			// need to also consider untested nodes at same priority as the last one, as there may be more than one
-			// at this stage we always find any node that is releasable within a group, and execute it.
-			if ((pCENode->sCompetenceElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_TESTED) &&
-				(!bLastElementPriority || (pCENode->sCompetenceElement.sPriority.bPriority <= bLastElementPriority)))
-			{
-				// found an untested CE, so read and store its priority - use the first one we find at a given priority level
-				if (pCENode->sCompetenceElement.sPriority.bPriority > nCEPriority)
-				{
-					nCEPriority = pCENode->sCompetenceElement.sPriority.bPriority;
-					pCE = pCENode;
-				}
-			}
+			// found an untested CE - use the first one added at a given priority level
+			pCE = pCENode;
 		}
-		pCENode = (PlanElement *)((unsigned char *)pCENode + nSize);
 	}
 	return pCE;
 }
 
-// this is a helper function that will search over Action Pattern Elements and return the lowest ordered item for
-// a particular Parent ActionPatternID that has not been completed in an order group and is greater than bLastElementOrder
-PlanElement * Planner::findNextAPE(const instinctID bParentActionPatternID, const instinctID bLastElementOrder)
+// this is a helper function that will search over the Action Pattern Elements of an Action Pattern and return the lowest
+// ordered item that has not been completed in an order group and is greater than or equal to the order of pLastAPE.
+// linkPlan() holds the APE's of an Action Pattern together in order, so we only need to step on from pLastAPE, after
+// stepping back over any APE's with the same order. If pLastAPE is null then start from the first APE
+PlanElement * Planner::findNextAPE(PlanElement *pActionPattern, RuntimeElement *, PlanElement *pLastAPE)
 {
 	PlanElement *pAPENode;
-	PlanElement *pAPE = 0;
-	instinctID nAPEOrder;
-	instinctID nAPECount;
+	PlanElement *pFirstAPE;
+	PlanElement *pEndAPE;
+	RuntimeElement *pAPERuntime;
 	int nSize;
+	int nRuntimeSize;
 
-	pAPENode = _pPlan[INSTINCT_ACTIONPATTERNELEMENT];
-	nAPECount = _nNodeCount[INSTINCT_ACTIONPATTERNELEMENT];
-
-	if (!pAPENode || !nAPECount) // should never happen
+	if (!_pPlan[INSTINCT_ACTIONPATTERNELEMENT] || !_nNodeCount[INSTINCT_ACTIONPATTERNELEMENT]) // should never happen
 		return 0;
 
 	nSize = sizeFromNodeType(INSTINCT_ACTIONPATTERNELEMENT);
-	nAPEOrder = (instinctID)-1; // highest unsigned value 0xff or 0xffff
-	for (instinctID i = 0; i < nAPECount; i++)
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_ACTIONPATTERNELEMENT);
+	pFirstAPE = firstChild(pActionPattern, INSTINCT_ACTIONPATTERN, INSTINCT_ACTIONPATTERNELEMENT);
+	pEndAPE = (PlanElement *)((unsigned char *)pFirstAPE + pActionPattern->sActionPattern.sChildren.bElementCount * nSize);
+
+	pAPENode = pFirstAPE;
+	if (pLastAPE)
 	{
-		// if APE has our AP as its parent
-		if (pAPENode->sActionPatternElement.sParentChild.bRuntime_ParentID == bParentActionPatternID)
+		pAPENode = pLastAPE;
+		while ((pAPENode > pFirstAPE) && (((PlanElement *)((unsigned char *)pAPENode - nSize))->sActionPatternElement.bOrder ==
+			pLastAPE->sActionPatternElement.bOrder))
 		{
-			// found a candidate APE, so read and store its Order
-			if ((pAPENode->sActionPatternElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_TESTED) &&
-				(pAPENode->sActionPatternElement.bOrder < nAPEOrder) && // use the first one we find
-				(pAPENode->sActionPatternElement.bOrder >= bLastElementOrder))
-			{
-				nAPEOrder = pAPENode->sActionPatternElement.bOrder;
-				pAPE = pAPENode;
-			}
+			pAPENode = (PlanElement *)((unsigned char *)pAPENode - nSize);
 		}
-		pAPENode = (PlanElement *)((unsigned char *)pAPENode + nSize);
 	}
-	return pAPE;
+	pAPERuntime = (RuntimeElement *)((unsigned char *)firstChildRuntime(pActionPattern, INSTINCT_ACTIONPATTERN, INSTINCT_ACTIONPATTERNELEMENT) +
+		((unsigned char *)pAPENode - (unsigned char *)pFirstAPE) / nSize * nRuntimeSize);
+
+	for (; pAPENode < pEndAPE; pAPENode = (PlanElement *)((unsigned char *)pAPENode + nSize))
+	{
+		// the highest order value 0xff or 0xffff is never used
+		if (pAPENode->sActionPatternElement.bOrder == (instinctID)-1)
+			break;
+		_sWork.ulAPEsScanned++;
+
+		// use the first one we find
+		if (pAPERuntime->sActionPatternElement.bRuntime_Status == INSTINCT_RUNTIME_NOT_TESTED)
+			return pAPENode;
+		pAPERuntime = (RuntimeElement *)((unsigned char *)pAPERuntime + nRuntimeSize);
+	}
+	return 0;
 }
 
 // this is a helper function just to clear the bRuntime_Status flags
-// of all CE's associated with a given ParentID
-unsigned char Planner::clearCECompletedFlags(instinctID bParentID)
+// of all CE's of a given Competence
+unsigned char Planner::clearCECompletedFlags(PlanElement *pCompetence, RuntimeElement *)
 {
-	PlanElement *pCENode;
-	instinctID nCECount;
-	int nSize;
-
-	pCENode = _pPlan[INSTINCT_COMPETENCEELEMENT];
-	nCECount = _nNodeCount[INSTINCT_COMPETENCEELEMENT];
+	RuntimeElement *pCERuntime;
+	int nRuntimeSize;
 
-	if (!pCENode || !nCECount) // should never happen
+	if (!_pPlan[INSTINCT_COMPETENCEELEMENT] || !_nNodeCount[INSTINCT_COMPETENCEELEMENT]) // should never happen
 		return INSTINCT_ERROR;
 
-	nSize = sizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
-
-	for (instinctID i = 0; i < nCECount; i++)
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
+	pCERuntime = firstChildRuntime(pCompetence, INSTINCT_COMPETENCE, INSTINCT_COMPETENCEELEMENT);
+	_sWork.ulFlagsCleared += pCompetence->sCompetence.sChildren.bElementCount;
+	for (instinctID i = 0; i < pCompetence->sCompetence.sChildren.bElementCount; i++)
 	{
-		// find correct CE's based on ParentID
-		if (pCENode->sCompetenceElement.sParentChild.bRuntime_ParentID == bParentID)
-		{
-			pCENode->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
-		}
-		pCENode = (PlanElement *)((unsigned char *)pCENode + nSize);
+		pCERuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
+		pCERuntime = (RuntimeElement *)((unsigned char *)pCERuntime + nRuntimeSize);
 	}
 	return INSTINCT_SUCCESS;
 }
 
 // this is a helper function just to clear the bRuntime_Status flags
-// of all APE's associated with a given ParentID
-unsigned char Planner::clearAPECompletedFlags(instinctID bParentID)
+// of all APE's of a given Action Pattern
+unsigned char Planner::clearAPECompletedFlags(PlanElement *pActionPattern, RuntimeElement *)
 {
-	PlanElement *pAPENode;
-	instinctID nAPECount;
-	int nSize;
+	RuntimeElement *pAPERuntime;
+	int nRuntimeSize;
 
-	pAPENode = _pPlan[INSTINCT_ACTIONPATTERNELEMENT];
-	nAPECount = _nNodeCount[INSTINCT_ACTIONPATTERNELEMENT];
-
-	if (!pAPENode || !nAPECount) // should never happen
+	if (!_pPlan[INSTINCT_ACTIONPATTERNELEMENT] || !_nNodeCount[INSTINCT_ACTIONPATTERNELEMENT]) // should never happen
 		return INSTINCT_ERROR;
 
-	nSize = sizeFromNodeType(INSTINCT_ACTIONPATTERNELEMENT);
-
-	for (instinctID i = 0; i < nAPECount; i++)
+	nRuntimeSize = runtimeSizeFromNodeType(INSTINCT_ACTIONPATTERNELEMENT);
+	pAPERuntime = firstChildRuntime(pActionPattern, INSTINCT_ACTIONPATTERN, INSTINCT_ACTIONPATTERNELEMENT);
+	_sWork.ulFlagsCleared += pActionPattern->sActionPattern.sChildren.bElementCount;
+	for (instinctID i = 0; i < pActionPattern->sActionPattern.sChildren.bElementCount; i++)
 	{
-		// find correct CE's based on ParentID
-		if (pAPENode->sActionPatternElement.sParentChild.bRuntime_ParentID == bParentID)
-		{
-			pAPENode->sActionPatternElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
-		}
-		pAPENode = (PlanElement *)((unsigned char *)pAPENode + nSize);
+		pAPERuntime->sActionPatternElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
+		pAPERuntime = (RuntimeElement *)((unsigned char *)pAPERuntime + nRuntimeSize);
 	}
 	return INSTINCT_SUCCESS;
 }
 
 // Execute a specific Action Pattern Element. Must be from an Action Pattern (AP)
 // An Action Pattern Element (APE) may contain an Action (A), an Action Pattern (AP), or a Competence (C)
-unsigned char Planner::executeAPE(PlanElement *pAPE, PlanElement *pDrive)
+unsigned char Planner::executeAPE(PlanElement *pAPE, RuntimeElement *pAPERuntime, PlanElement *pDrive)
 {
 	PlanElement *pElement;
-	unsigned char bNodeType;
+	RuntimeElement *pElementRuntime;
 	unsigned char bRtn = 0;
 
 	// update the runtime execution counter for the Action Pattern Element
-	countExecution(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+	countExecution(pAPE, pAPERuntime, INSTINCT_ACTIONPATTERNELEMENT, pDrive);
 
-	// get a pointer to the child element, and fill nNodeType with its type
-	pElement = findChildAorAPorC(pAPE->sActionPatternElement.sParentChild.bRuntime_ChildID, &bNodeType);
+	// get a pointer to the child element, linked by linkPlan()
+	pElement = elementFromIndex(&pAPE->sActionPatternElement.sParentChild.sChildLink);
+	pElementRuntime = runtimeFromIndex(&pAPE->sActionPatternElement.sParentChild.sChildLink);
 
 	if (!pElement)
 	{
-		countError(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+		countError(pAPE, pAPERuntime, INSTINCT_ACTIONPATTERNELEMENT, pDrive);
 		return INSTINCT_ERROR; // only happens if plan structure is malformed
 	}
 
-	switch (bNodeType)
+	switch (pAPE->sActionPatternElement.sParentChild.sChildLink.bNodeType)
 	{
 	case INSTINCT_ACTION:
-		bRtn = executeAction(pElement, pDrive);
+		bRtn = executeAction(pElement, pElementRuntime, pDrive);
 		break;
 	case INSTINCT_ACTIONPATTERN:
-		bRtn = executeActionPattern(pElement, pDrive);
+		bRtn = executeActionPattern(pElement, pElementRuntime, pDrive);
 		break;
 	case INSTINCT_COMPETENCE:
-		bRtn = executeCompetence(pElement, pDrive);
+		bRtn = executeCompetence(pElement, pElementRuntime, pDrive);
 		break;
 	default:
 		bRtn = INSTINCT_FAIL;
@@ -1078,16 +1511,16 @@ unsigned char Planner::executeAPE(PlanElement *pAPE, PlanElement *pDrive)
 	switch (INSTINCT_RTN(bRtn))
 	{
 	case INSTINCT_SUCCESS:
-		countSuccess(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+		countSuccess(pAPE, pAPERuntime, INSTINCT_ACTIONPATTERNELEMENT, pDrive);
 		break;
 	case INSTINCT_IN_PROGRESS:
-		countInProgress(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+		countInProgress(pAPE, pAPERuntime, INSTINCT_ACTIONPATTERNELEMENT, pDrive);
 		break;
 	case INSTINCT_FAIL:
-		countFail(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+		countFail(pAPE, pAPERuntime, INSTINCT_ACTIONPATTERNELEMENT, pDrive);
 		break;
 	case INSTINCT_ERROR:
-		countError(pAPE, INSTINCT_ACTIONPATTERNELEMENT);
+		countError(pAPE, pAPERuntime, INSTINCT_ACTIONPATTERNELEMENT, pDrive);
 		break;
 	}
 
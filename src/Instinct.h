@@ -61,20 +61,79 @@
 #define INSTINCT_RTN_DATA(rtn) ((rtn) >> 2)
 #define INSTINCT_RTN_COMBINE(rtn, data) (((rtn) & 0x03) | ((data) << 2))
 
+// these are the events recorded by the TraceMonitor
+#define INSTINCT_TRACE_EXECUTED		0
+#define INSTINCT_TRACE_SUCCESS		1
+#define INSTINCT_TRACE_IN_PROGRESS	2
+#define INSTINCT_TRACE_FAIL			3
+#define INSTINCT_TRACE_ERROR		4
+#define INSTINCT_TRACE_SENSE		5
+
+// set where the C++11 standard library is available, which it is not on Arduino
+#if !defined(ARDUINO) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700))
+	#define INSTINCT_CPP11
+	#include <atomic>
+	#include <thread>
+	#include <mutex>
+	#include <condition_variable>
+	#include <chrono>
+#endif
+
+// the TraceMonitor ring buffer uses C++11 atomics where they are available. Arduino is single core,
+// so there volatile indexes are enough, provided the buffer is only read outside of interrupt handlers
+#if defined(INSTINCT_CPP11)
+	#define INSTINCT_TRACE_ATOMIC
+#endif
+
+// the PlannerPool steps many Planners at once on a pool of threads, so it is only built where C++11 threads are available
+#if defined(INSTINCT_CPP11)
+	#define INSTINCT_PLANNER_POOL
+#endif
+
+// the SystemClock reads micros() on Arduino, and std::chrono::steady_clock where C++11 is available
+#if defined(INSTINCT_CPP11)
+	#define INSTINCT_STEADY_CLOCK
+#endif
+#if defined(ARDUINO) || defined(INSTINCT_STEADY_CLOCK)
+	#define INSTINCT_SYSTEM_CLOCK
+#endif
+
+// the alignment of a type. alignof is C++11, and only in MSVC from Visual Studio 2015, so otherwise ask the compiler
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+	#define INSTINCT_ALIGNOF(T)	alignof(T)
+#elif defined(_MSC_VER)
+	#define INSTINCT_ALIGNOF(T)	__alignof(T)
+#else
+	#define INSTINCT_ALIGNOF(T)	__alignof__(T)
+#endif
+
 namespace Instinct {
 
 // for Arduino, use single bytes for Node ID's and therefore node counters etc, otherwise use unsigned int
-#ifndef _MSC_VER
-	typedef unsigned char instinctID;
-	typedef unsigned char senseID;
-	typedef unsigned char actionID;
-#else
+// define INSTINCT_16BIT_IDS to use 16 bit ID's for large plans on other platforms
+#if defined(_MSC_VER)
 	typedef unsigned int instinctID;
 	typedef unsigned int senseID;
 	typedef unsigned int actionID;
+#elif defined(INSTINCT_16BIT_IDS)
+	typedef unsigned short instinctID;
+	typedef unsigned short senseID;
+	typedef unsigned short actionID;
+#else
+	typedef unsigned char instinctID;
+	typedef unsigned char senseID;
+	typedef unsigned char actionID;
 #endif
 
-#define INSTINCT_MAX_INSTINCTID  ((0x01 << (sizeof(Instinct::instinctID)*8))-1)
+#define INSTINCT_MAX_INSTINCTID  ((Instinct::instinctID)-1)
+
+// the most entries the ElementID index may have, so ElementID's must be less than this. With 32 bit ID's not every ID
+// can be indexed, so the index is limited to a sensible size
+#if defined(_MSC_VER)
+	#define INSTINCT_MAX_INDEX_SIZE	0x1000000UL
+#else
+	#define INSTINCT_MAX_INDEX_SIZE	((unsigned long)INSTINCT_MAX_INSTINCTID + 1)
+#endif
 
 typedef struct {
 	senseID bSenseID;
@@ -94,7 +153,6 @@ typedef struct {
 	instinctID bRampIncrement;
 	instinctID bUrgencyMultiplier;
 	instinctID bRuntime_Priority;
-	unsigned char bRuntime_Checked;
 	unsigned int uiRampInterval;
 	unsigned int uiRuntime_RampIntervalCounter;
 } DrivePriorityType;
@@ -119,13 +177,58 @@ typedef struct {
 	instinctID bRuntime_ElementID;
 } RuntimeReferences;
 
+// an entry in the ElementID index, holding the node type and the position of the element within its plan buffer
+// bNodeType is INSTINCT_NODE_TYPES where no element has been added with that ID
+// the same form is used to hold links from elements to their children, resolved by linkPlan()
+typedef struct {
+	unsigned char bNodeType;
+	instinctID bElement;
+} ElementIndexType;
+
+// A binary plan image holds this header, then the elements of each node type in their plan buffer form,
+// then optionally the ElementID index. Offsets are from the start of the image. An image can only be used
+// on a platform with the same element sizes as the one that wrote it
+#define INSTINCT_PLAN_IMAGE_MAGIC	0x494E5354 // "INST"
+#define INSTINCT_PLAN_IMAGE_VERSION	1
+
+typedef struct {
+	unsigned long ulMagic;
+	unsigned long ulImageSize;
+	unsigned char bVersion;
+	unsigned char bIDSize; // sizeof(instinctID)
+	unsigned short uiElementSize[INSTINCT_NODE_TYPES];
+	instinctID nNodeCount[INSTINCT_NODE_TYPES];
+	unsigned long ulElementOffset[INSTINCT_NODE_TYPES];
+	unsigned long ulIndexOffset; // zero if there is no index
+	unsigned long ulIndexSize; // number of index entries
+} PlanImageHeaderType;
+
+// a runtime state buffer starts with this header, followed by the ElementID and runtime values of each element
+#define INSTINCT_RUNTIME_STATE_MAGIC	0x52 // 'R'
+#define INSTINCT_RUNTIME_STATE_VERSION	1
+
+typedef struct {
+	unsigned char bMagic;
+	unsigned char bVersion;
+	unsigned char bIDSize; // sizeof(instinctID)
+	instinctID nNodeCount[INSTINCT_NODE_TYPES];
+} RuntimeStateHeaderType;
+
 typedef struct {
 	instinctID bRuntime_ParentID;
 	instinctID bRuntime_ChildID;
+	ElementIndexType sChildLink; // set by linkPlan()
 } ParentChildReferences;
 
+// the position and number of an element's children, which linkPlan() stores together in their plan buffer
+typedef struct {
+	instinctID bFirstElement;
+	instinctID bElementCount;
+} ChildListType;
+
 typedef struct {
 	instinctID bRuntime_CurrentElementID;
+	ChildListType sChildren; // APE's in order, set by linkPlan()
 } ActionPatternType;
 
 typedef struct {
@@ -138,6 +241,7 @@ typedef struct {
 typedef struct {
 	instinctID bRuntime_CurrentElementID;
 	unsigned char bUseORWithinCEGroup;
+	ChildListType sChildren; // CE's in priority order, set by linkPlan()
 } CompetenceType;
 
 typedef struct {
@@ -154,6 +258,7 @@ typedef struct {
 	DrivePriorityType sDrivePriority;
 	FrequencyType sFrequency;
 	instinctID bRuntime_ChildID;
+	ElementIndexType sChildLink; // set by linkPlan()
 	unsigned char bRuntime_Status; // see INSTINCT_STATUS_*
 } DriveType;
 
@@ -181,10 +286,130 @@ typedef struct {
 	PlanElement sElement;
 } PlanNode;
 
+// The runtime values of each node type. The elements in the plan buffers hold only the definition of the plan, which never changes
+// as it runs and may be shared by many Planners. Each Planner keeps the runtime values of its elements in its own buffers,
+// in the same order as the elements. The runtime fields of PlanElement are only used when a node is copied in or out of the plan
+typedef struct {
+	instinctID bRuntime_CurrentElementID;
+} ActionPatternRuntimeType;
+
+typedef struct {
+	unsigned char bRuntime_Status; // see INSTINCT_RUNTIME_*
+} ActionPatternElementRuntimeType;
+
+typedef struct {
+	instinctID bRuntime_CurrentElementID;
+} CompetenceRuntimeType;
+
+typedef struct {
+	unsigned char bRuntime_Released;
+	unsigned char bRuntime_RetryCount;
+	unsigned char bRuntime_Status; // see INSTINCT_RUNTIME_*
+} CompetenceElementRuntimeType;
+
+typedef struct {
+	unsigned int uiRuntime_RampIntervalCounter;
+	unsigned int uiRuntime_IntervalCounter;
+	instinctID bRuntime_Priority;
+	unsigned char bRuntime_Released;
+	unsigned char bRuntime_Status; // see INSTINCT_STATUS_*
+} DriveRuntimeType;
+
+typedef struct {
+	unsigned char bRuntime_CheckForComplete;
+} ActionRuntimeType;
+
+typedef struct {
+	RuntimeCounters sCounters;
+	union {
+		ActionPatternRuntimeType sActionPattern;
+		ActionPatternElementRuntimeType sActionPatternElement;
+		CompetenceRuntimeType sCompetence;
+		CompetenceElementRuntimeType sCompetenceElement;
+		DriveRuntimeType sDrive;
+		ActionRuntimeType sAction;
+	};
+} RuntimeElement;
+
+// one entry per senseID in the Planner's sense cache
+typedef struct {
+	int nValue;
+	unsigned int uiRuntime_Cycle; // the plan cycle in which nValue was read, or zero if not yet read
+	unsigned char bCacheable; // cleared for senses whose value may change within a plan cycle
+} SenseCacheType;
+
+// returned by nextTimerEvent() when no Drive timer is waiting to expire
+#define INSTINCT_NO_TIMER_EVENT	((unsigned int)-1)
+
+// the deadlines of a Drive's timers on the timer clock, while the Planner runs tickless
+typedef struct {
+	unsigned long ulIntervalDeadline;
+	unsigned long ulRampDeadline;
+	unsigned char bIntervalPending; // cleared once the frequency interval has expired, until checkDriveFrequency() restarts it
+} DriveTimerType;
+
+// a Drive timer waiting to expire. The Planner holds these in a heap, earliest deadline first
+typedef struct {
+	unsigned long ulDeadline;
+	instinctID nDrive; // position of the Drive in the plan buffer
+	unsigned char bRamp; // set for the ramp interval, clear for the frequency interval
+} TimerEventType;
+
+// the number of buckets in each latency histogram. Bucket 0 counts times of zero ticks, and bucket n counts times
+// of 2^(n-1) to 2^n - 1 ticks. The last bucket also counts every longer time
+#define INSTINCT_LATENCY_BUCKETS	16
+
+// the times taken by one plan element, in ticks of the Planner's Clock. Counts stop at their maximum rather than roll over
+typedef struct {
+	unsigned int uiCount[INSTINCT_LATENCY_BUCKETS];
+} LatencyHistogramType;
+
+// the latency histograms of one plan element, held by ElementID
+typedef struct {
+	LatencyHistogramType sExecute; // executeDrive() for Drives, the Actions callback for Actions
+	LatencyHistogramType sReleaser; // checkReleaser() for Drives and Competence Elements
+} NodeLatencyType;
+
+// counts of the work done inside a Planner, to show where the time in a plan cycle goes without timing it
+typedef struct {
+	unsigned long ulCycles; // plan cycles run by runPlan()
+	unsigned long ulDrivesScanned; // Drives examined by runPlan()
+	unsigned long ulCEsScanned; // Competence Elements examined by findNextCE() and findCEForReleaserCheck()
+	unsigned long ulAPEsScanned; // Action Pattern Elements examined by findNextAPE()
+	unsigned long ulElementLookups; // calls to findElement()
+	unsigned long ulFlagsCleared; // runtime status flags visited to clear them after a Competence or Action Pattern completes
+	unsigned long ulSenseReads; // releaser senses read from the Senses, not counting those found in the sense cache
+	unsigned long ulMonitorCalls; // notifications sent to the Monitor
+} WorkCountersType;
+
+// each buffer in the plan arena starts on a multiple of this many bytes. Elsewhere than Arduino this is a cache line,
+// so that the runtime values, which change as the plan runs, do not share a line with the plan definition
+#ifndef INSTINCT_ARENA_ALIGN
+	#ifdef ARDUINO
+		#define INSTINCT_ARENA_ALIGN	sizeof(void *)
+	#else
+		#define INSTINCT_ARENA_ALIGN	64
+	#endif
+#endif
+
+// the capacity given to a node type with no buffer when the plan grows. Buffers that are full double in size
+#define INSTINCT_PLAN_GROWTH_MIN	4
+
+// where each buffer lies in the plan arena, as offsets from its aligned start
+typedef struct {
+	unsigned long ulRuntimeOffset[INSTINCT_NODE_TYPES];
+	unsigned long ulDriveOrderOffset;
+	unsigned long ulPlanOffset[INSTINCT_NODE_TYPES]; // only used when the arena holds the plan elements
+	unsigned long ulIndexOffset;
+	unsigned long ulSize;
+} ArenaLayoutType;
+
 
 class Senses {
 public:
 	virtual int readSense(const senseID nSense) = 0;
+	// read nCount senses at once. Override this where the hardware can read many senses in one transaction
+	virtual unsigned char readSenses(const senseID *pSenses, int *pSenseValues, const unsigned int uiCount);
 };
 
 class Actions {
@@ -192,6 +417,27 @@ public:
 	virtual unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete) = 0;
 };
 
+// the time source for latency histograms. readClock() may roll over, as only the difference between two readings is used
+class Clock {
+public:
+	virtual unsigned long readClock(void) = 0;
+};
+
+// supplies the memory for a PlanManager's plan arena, and for its index should that outgrow the arena
+class Allocator {
+public:
+	virtual void * allocate(const unsigned long ulSize) = 0; // returns 0 if there is no room
+	virtual void release(void *pMemory) = 0;
+};
+
+#ifdef INSTINCT_SYSTEM_CLOCK
+// reads the time in microseconds
+class SystemClock : public Clock {
+public:
+	unsigned long readClock(void);
+};
+#endif
+
 class Monitor {
 public:
 	virtual unsigned char nodeExecuted(const PlanNode * pPlanNode) = 0;
@@ -202,9 +448,90 @@ public:
 	virtual unsigned char nodeSense(const ReleaserType *pReleaser, const int nSenseValue) = 0;
 };
 
+// Monitor2 is passed the plan element itself rather than a copy, along with its runtime values, its node type and the Drive it is running under.
+// The runtime fields of the element itself are not used. Neither must be kept, as they are only valid during the call, and may move if the plan is changed
+class Monitor2 {
+public:
+	virtual void planCycle(const unsigned long ulCycle); // called at the start of each plan cycle
+	virtual unsigned char nodeExecuted(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive) = 0;
+	virtual unsigned char nodeSuccess(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive) = 0;
+	virtual unsigned char nodeInProgress(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive) = 0;
+	virtual unsigned char nodeFail(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive) = 0;
+	virtual unsigned char nodeError(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive) = 0;
+	virtual unsigned char nodeSense(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const ReleaserType *pReleaser,
+		const int nSenseValue, const PlanElement *pDrive) = 0;
+};
+
+// passes Monitor2 notifications on to a Monitor, copying each element into a PlanNode as before
+class MonitorAdapter : public Monitor2 {
+public:
+	MonitorAdapter(Monitor *pMonitor);
+	void setMonitor(Monitor *pMonitor);
+	Monitor * monitor(void);
+	unsigned char nodeExecuted(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeSuccess(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeInProgress(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeFail(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeError(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeSense(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const ReleaserType *pReleaser,
+		const int nSenseValue, const PlanElement *pDrive);
+
+private:
+	Monitor * _pMonitor;
+	unsigned char copyNode(PlanNode *pPlanNode, const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType);
+};
+
+// a fixed size binary record of one Monitor2 notification
+typedef struct {
+	unsigned long ulCycle;
+	int nSenseValue; // only for INSTINCT_TRACE_SENSE
+	instinctID bElementID;
+	instinctID bDriveID;
+	unsigned char bNodeType;
+	unsigned char bEvent;
+} TraceRecordType;
+
+#ifdef INSTINCT_TRACE_ATOMIC
+	typedef std::atomic<unsigned int> traceIndex;
+	typedef std::atomic<unsigned long> traceCount;
+#else
+	typedef volatile unsigned int traceIndex;
+	typedef volatile unsigned long traceCount;
+#endif
+
+// Records each notification into a single producer, single consumer lock free ring buffer, so that a Monitor
+// does not have to format text on the planner thread. The planner writes records as it runs, and another thread,
+// or the main loop, calls readRecord() to drain them. Records are dropped, and counted, if the ring is full
+class TraceMonitor : public Monitor2 {
+public:
+	TraceMonitor(TraceRecordType *pBuffer, const unsigned int uiBufferSize);
+	unsigned char readRecord(TraceRecordType *pRecord); // consumer side - returns false if the ring is empty
+	unsigned int readRecords(TraceRecordType *pRecords, const unsigned int uiMaxRecords);
+	unsigned long droppedRecords(void);
+	void planCycle(const unsigned long ulCycle);
+	unsigned char nodeExecuted(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeSuccess(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeInProgress(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeFail(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeError(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *pDrive);
+	unsigned char nodeSense(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const ReleaserType *pReleaser,
+		const int nSenseValue, const PlanElement *pDrive);
+
+private:
+	TraceRecordType * _pBuffer;
+	unsigned int _uiBufferSize;
+	traceIndex _uiHead; // next record to write, only changed by the producer
+	traceIndex _uiTail; // next record to read, only changed by the consumer
+	unsigned long _ulCycle;
+	traceCount _ulDropped; // only changed by the producer, but may be read by the consumer
+	unsigned char writeRecord(const PlanElement *pElement, const unsigned char bNodeType, const unsigned char bEvent,
+		const int nSenseValue, const PlanElement *pDrive);
+};
+
 class PlanManager {
 public:
 	PlanManager(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Monitor *pMonitor);
+	~PlanManager();
 	void setPlanID(const int nPlanID);
 	int getPlanID(void);
 	unsigned char executeCommand(const char * pCmd, char *pRtnBuff, const int nRtnBuffLen);
@@ -227,88 +554,281 @@ public:
 	unsigned char addCompetence(const instinctID bRuntime_ElementID, const unsigned char bUseORWithinCEGroup);
 	unsigned char getNode(PlanNode *pPlanNode, const instinctID nElementID); // fill pointer to a plan node based on ElementID
 	unsigned char updateNode(PlanNode *pPlanNode); // update a plan node based on ElementID and node type
+	unsigned char patchNode(PlanNode *pPlanNode); // change the definition of a plan node, keeping its runtime values
+	void setMonitor(Monitor *pMonitor);
+	void setMonitor(Monitor2 *pMonitor); // receive notifications without copying plan elements
+	unsigned long planImageSize(const unsigned char bIncludeIndex);
+	unsigned char writePlanImage(unsigned char *pImage, const unsigned long ulImageSize, const unsigned char bIncludeIndex);
+	unsigned char adoptPlanImage(unsigned char *pImage, const unsigned long ulImageSize); // run the plan in place, without copying it. The image is only read, so may be in flash
+	unsigned char sharePlan(PlanManager *pPlanManager); // run the plan of another PlanManager, keeping only our own runtime values
+	unsigned char swapPlan(PlanManager *pPlanManager, const unsigned char bCarryRuntime); // take the plan built in pPlanManager, leaving it ours
+	unsigned char isPlanShared(void); // true if the plan elements belong to another PlanManager or a plan image, so cannot be changed
+	unsigned int runtimeStateSize(void);
+	unsigned int saveRuntimeState(unsigned char *pState, const unsigned int uiStateSize); // returns the bytes used, or 0 if too small
+	unsigned char restoreRuntimeState(const unsigned char *pState, const unsigned int uiStateSize);
+	unsigned char linkPlan(void); // resolve child references once the plan is loaded
+	instinctID brokenLinkID(void); // ElementID of the first element whose child could not be found by linkPlan()
 	unsigned char monitorNode(const instinctID bRuntime_ElementID, const unsigned char bMonitorExecuted, const unsigned char bMonitorSuccess,
 		const unsigned char bMonitorPending, const unsigned char bMonitorFail, const unsigned char bMonitorError, const unsigned char bMonitorSense);
 	void setGlobalMonitorFlags(const unsigned char bMonitorExecuted, const unsigned char bMonitorSuccess,
 		const unsigned char bMonitorPending, const unsigned char bMonitorFail, const unsigned char bMonitorError, const unsigned char bMonitorSense);
-	int sizeFromNodeType(const unsigned char nNodeType);
+	static int sizeFromNodeType(const unsigned char nNodeType);
+	static int runtimeSizeFromNodeType(const unsigned char nNodeType);
+	static void copyRuntime(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, const unsigned char bToElement);
 	unsigned char setDrivePriority(const instinctID bRuntime_ElementID, const instinctID bPriority);
 	unsigned char setRuntimeDrivePriority(const instinctID bRuntime_ElementID, const instinctID bPriority);
 	instinctID getDrivePriority(const instinctID bRuntime_ElementID);
 	instinctID getRuntimeDrivePriority(const instinctID bRuntime_ElementID);
+	void workCounters(WorkCountersType *pCounters); // copy the work counters
+	void clearWorkCounters(void);
+	void setAllocator(Allocator *pAllocator); // allocate the plan arena from pAllocator, or 0 for malloc()
+	void setArenaBuffer(unsigned char *pBuffer, const unsigned long ulBufferSize); // carve the plan arena from pBuffer, never using the heap
+	static unsigned long planArenaSize(const instinctID *pPlanSize); // the buffer size setArenaBuffer() needs for initialisePlan(pPlanSize)
+	unsigned long arenaSize(void);
+	unsigned long arenaUsed(void);
+	void enablePlanGrowth(const unsigned char bGrow); // let addNode() grow full plan buffers, rather than fail
 
 
 	protected:
 	Senses * _pSenses;
 	Actions * _pActions;
-	Monitor * _pMonitor;
+	Monitor2 * _pMonitor;
+	MonitorAdapter _sMonitorAdapter; // used when we are given a Monitor
 	instinctID _nPlanSize[INSTINCT_NODE_TYPES];
 	PlanElement * _pPlan[INSTINCT_NODE_TYPES];
 	PlanElement * _pLastNode[INSTINCT_NODE_TYPES];
+	RuntimeElement * _pRuntime[INSTINCT_NODE_TYPES]; // the runtime values of the elements, in the same order
 	instinctID _nNodeCount[INSTINCT_NODE_TYPES];
+	ElementIndexType * _pIndex; // indexed by ElementID, to find any element without searching
+	unsigned int _uiIndexSize;
+	unsigned char _bOwnsIndex; // set when the index is a block of its own, outside the arena
+	unsigned char _bArenaIndex; // set when the index is carved from the arena
+	unsigned char _bSharedPlan; // set when the plan elements belong to another PlanManager or a plan image
+	PlanManager * _pSharedFrom; // the PlanManager whose plan we share, if any
+	unsigned int _uiShareCount; // the number of PlanManagers sharing our plan, which cannot be changed while any do
+	unsigned char _bLinked; // cleared whenever the plan changes, until linkPlan() is called
+	instinctID _bBrokenLinkID;
+	instinctID * _pDriveOrder; // Drive positions, highest Runtime_Priority first, set by linkPlan()
+	instinctID _bRunningDrive; // position of the only Drive that may be running, or (instinctID)-1 if not known
+	senseID * _pReleaserSenses; // each sense tested by a Drive or CE releaser, set by linkPlan() if _bListReleaserSenses
+	unsigned int _uiReleaserSenseCount;
+	unsigned char _bListReleaserSenses;
 	unsigned char _bGlobalMonitorFlags;
+	DriveTimerType * _pDriveTimers; // one for each Drive position, used by a tickless Planner
+	TimerEventType * _pTimerHeap;
+	unsigned int _uiTimerCount; // timers in the heap
+	instinctID _nTimerDrives; // Drives that _pDriveTimers and _pTimerHeap have room for
+	unsigned long _ulTimerClock; // the total of the times given to processTimers() since the heap was built
+	unsigned char _bTimersValid; // set while the heap, not the Drive runtime counters, holds the Drive timers
 	int _nPlanID; // a numeric identifier for the plan, useful where there are many plans
+	WorkCountersType _sWork;
+	Allocator * _pAllocator;
+	unsigned char * _pArenaBuffer; // the user's buffer, if the arena is not allocated
+	unsigned long _ulArenaBufferSize;
+	void * _pArenaMemory; // the allocated block holding the arena, to be released
+	unsigned char * _pArena; // the aligned start of the arena, holding the runtime values, Drive order, plan and index
+	unsigned long _ulArenaSize; // bytes available from _pArena
+	unsigned long _ulArenaUsed;
+	unsigned char _bGrowPlan;
 
 	PlanElement * findElement(const instinctID bElementID);
 	PlanElement * findElementAndType(const instinctID bElementID, unsigned char *pNodeType);
 	PlanElement * findElement(const instinctID bElementID, const unsigned char nNodeType);
 	PlanElement * findChildAorAPorC(const instinctID bElementID, unsigned char *pNodeType);
-	void countExecution(PlanElement *pElement, const unsigned char nNodeType);
-	void countSuccess(PlanElement *pElement, const unsigned char nNodeType);
-	void countInProgress(PlanElement *pElement, const unsigned char nNodeType);
-	void countFail(PlanElement *pElement, const unsigned char nNodeType);
-	void countError(PlanElement *pElement, const unsigned char nNodeType);
-	void countSense(PlanElement *pElement, ReleaserType *pReleaser, const int nSenseValue);
+	PlanElement * elementFromIndex(const ElementIndexType *pEntry);
+	RuntimeElement * runtimeFromIndex(const ElementIndexType *pEntry);
+	RuntimeElement * runtime(PlanElement *pElement, const unsigned char nNodeType);
+	unsigned char linkChild(const instinctID bElementID, const instinctID bChildID, ElementIndexType *pChildLink);
+	void groupChildren(const unsigned char nNodeType, const unsigned char nParentType);
+	ParentChildReferences * parentChild(PlanElement *pElement, const unsigned char nNodeType);
+	ChildListType * childList(PlanElement *pElement, const unsigned char nNodeType);
+	instinctID childOrder(PlanElement *pElement, const unsigned char nNodeType);
+	PlanElement * firstChild(PlanElement *pElement, const unsigned char nNodeType, const unsigned char nChildType);
+	RuntimeElement * firstChildRuntime(PlanElement *pElement, const unsigned char nNodeType, const unsigned char nChildType);
+	ReleaserType * releaser(PlanElement *pElement, const unsigned char nNodeType);
+	unsigned char listReleaserSenses(void);
+	unsigned char growIndex(const unsigned int uiIndexSize);
+	void releasePlan(void);
+	static unsigned long arenaLayout(ArenaLayoutType *pLayout, const instinctID *pPlanSize, const unsigned char bPlan, const unsigned int uiIndexSize);
+	unsigned char allocateArena(const unsigned char bPlan, const unsigned int uiIndexSize);
+	unsigned char growPlan(const unsigned char nNodeType);
+	void * memAllocate(const unsigned long ulSize);
+	void memRelease(void *pMemory);
+	unsigned char buildTimers(void);
+	void syncTimers(const unsigned char bRelease);
+	void syncDriveTimers(const instinctID nDrive);
+	void pushTimer(const instinctID nDrive, const unsigned char bRamp, const unsigned long ulDeadline);
+	void popTimer(void);
+	int runtimeFields(RuntimeElement *pRuntime, const unsigned char nNodeType, unsigned char *pState, const unsigned char bSave);
+	void checkCurrentElements(void);
+	unsigned long planImageLayout(PlanImageHeaderType *pHeader, const unsigned char bIncludeIndex);
+	void sortDriveOrder(void);
+	void countExecution(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, PlanElement *pDrive);
+	void countSuccess(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, PlanElement *pDrive);
+	void countInProgress(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, PlanElement *pDrive);
+	void countFail(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, PlanElement *pDrive);
+	void countError(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, PlanElement *pDrive);
+	void countSense(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, ReleaserType *pReleaser, const int nSenseValue, PlanElement *pDrive);
 };
 
 
 class Planner : public PlanManager {
 public:
 	Planner(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Monitor *pMonitor);
+	~Planner();
 	unsigned char runPlan(void);
 	unsigned char processTimers(const unsigned int uiTime);
+	unsigned char enableTicklessTimers(const unsigned char bTickless); // only touch the Drives whose timers expire in processTimers()
+	unsigned int nextTimerEvent(void); // the time until the next Drive timer expires, or INSTINCT_NO_TIMER_EVENT
+	unsigned long planCycles(void); // the number of plan cycles run by runPlan()
 
 	int readSense(const senseID nSense);
 	unsigned char executeAction(const actionID nAction, const int nActionValue, const unsigned char bCheckForComplete);
 
+	unsigned char enableSenseCache(const unsigned int uiSenseCount); // cache senses 0 to uiSenseCount-1 for each plan cycle, 0 to disable
+	unsigned char setSenseCacheable(const senseID nSense, const unsigned char bCacheable);
+	unsigned long senseCacheHits(void);
+	unsigned long senseCacheMisses(void);
+	unsigned char enableSensePrefetch(const unsigned char bPrefetch); // read all releaser senses into the cache at the start of each cycle
+
+	// evaluate one releaser for many agents running the same plan, given each agent's sense value and Drive status.
+	// pReleased holds each agent's bRuntime_Released latch, and is updated just as checkReleaser() would update it.
+	// pReleaseMask, if given, receives one bit per agent, agent 0 in bit 0 of the first byte. Returns the number of agents released
+	static unsigned int checkReleasers(const ReleaserType *pReleaser, const int *pSenseValues, const unsigned char *pDriveStatus,
+		unsigned char *pReleased, unsigned char *pReleaseMask, const unsigned int uiCount);
+	static unsigned char releaserLanes(void); // the number of agents checkReleasers() evaluates at once
+
+	unsigned char enableLatencyHistograms(Clock *pClock); // time Drives, Actions and releasers with the given Clock, 0 to disable
+	void clearLatencyHistograms(void);
+	const LatencyHistogramType * latencyHistogram(const instinctID nElementID, const unsigned char bReleaser);
+
 private:
-	unsigned char executeDrive(PlanElement * pDrive);
-	unsigned char executeCE(PlanElement *pCompetenceElement, PlanElement *pDrive);
-	unsigned char executeAction(PlanElement *pAction, PlanElement *pDrive);
-	unsigned char executeActionPattern(PlanElement *pActionPattern, PlanElement *pDrive);
-	unsigned char executeCompetence(PlanElement *pCompetence, PlanElement *pDrive);
+	SenseCacheType * _pSenseCache;
+	unsigned int _uiSenseCacheSize;
+	unsigned int _uiSenseCacheCycle;
+	unsigned long _ulSenseCacheHits;
+	unsigned long _ulSenseCacheMisses;
+	senseID * _pPrefetchSenses;
+	int * _pPrefetchValues;
+	unsigned int _uiPrefetchSize;
+	unsigned long _ulPlanCycles;
+	unsigned char _bTicklessTimers;
+	Clock * _pClock;
+	NodeLatencyType * _pLatency;
+	unsigned int _uiLatencySize;
+
+
+	unsigned char executeDrive(PlanElement * pDrive, RuntimeElement *pDriveRuntime);
+	unsigned char executeCE(PlanElement *pCompetenceElement, RuntimeElement *pCERuntime, PlanElement *pDrive);
+	unsigned char executeAction(PlanElement *pAction, RuntimeElement *pActionRuntime, PlanElement *pDrive);
+	unsigned char executeActionPattern(PlanElement *pActionPattern, RuntimeElement *pAPRuntime, PlanElement *pDrive);
+	unsigned char executeCompetence(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, PlanElement *pDrive);
 
 	// these are the second level functions for complex logic operations
-	unsigned char executeCompetenceInitial(PlanElement *pCompetence, PlanElement *pDrive);
-	unsigned char executeCompetenceSubsequent(PlanElement *pCompetence, PlanElement *pDrive);
-	unsigned char processExecutedCE(PlanElement *pCE, PlanElement *pCompetence, PlanElement *pDrive, const unsigned char bRetVal);
-	unsigned char clearCENotReleasedStatus(const instinctID bParentCompetenceID, const instinctID nCEPriority);
+	unsigned char executeCompetenceInitial(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, PlanElement *pDrive);
+	unsigned char executeCompetenceSubsequent(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, PlanElement *pDrive);
+	unsigned char processExecutedCE(PlanElement *pCE, RuntimeElement *pCERuntime, PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime,
+		PlanElement *pDrive, const unsigned char bRetVal);
+	unsigned char clearCENotReleasedStatus(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, const instinctID nCEPriority);
 
 	// these are essentially helper functions for the main private functions above
-	unsigned char checkReleaser(PlanElement *pPlanElement, ReleaserType * pReleaser, DriveType *pDrive);
-	unsigned char checkDriveFrequency(DriveType *pDrive);
-	PlanElement * findCEForReleaserCheck(const instinctID bParentCompetenceID, const instinctID bLastElementPriority);
-	PlanElement * findNextCE(const instinctID bParentCompetenceID, const instinctID bLastElementPriority,
+	unsigned char checkReleaser(PlanElement *pPlanElement, RuntimeElement *pRuntime, ReleaserType * pReleaser, PlanElement *pDrive);
+	unsigned char testReleaser(PlanElement *pPlanElement, RuntimeElement *pRuntime, ReleaserType * pReleaser, PlanElement *pDrive);
+	void recordLatency(const PlanElement *pPlanElement, const unsigned char bReleaser, const unsigned long ulStart);
+	int readReleaserSense(const senseID nSense);
+	void prefetchSenses(void);
+	unsigned char checkDriveFrequency(DriveType *pDrive, DriveRuntimeType *pDriveRuntime);
+	void restartDriveTimer(const instinctID nDrive);
+	void rampDrivePriority(DriveType *pDrive, DriveRuntimeType *pDriveRuntime);
+	PlanElement * findCEForReleaserCheck(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, const instinctID bLastElementPriority);
+	PlanElement * findNextCE(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime, const instinctID bLastElementPriority,
 		const unsigned char bNextLevel, const unsigned char bIncludeNotReleased);
-	PlanElement * findNextAPE(const instinctID bParentActionPatternID, const instinctID bLastElementOrder);
-	unsigned char executeAPE(PlanElement *pActionPatternElement, PlanElement *pDrive);
+	PlanElement * findNextAPE(PlanElement *pActionPattern, RuntimeElement *pAPRuntime, PlanElement *pLastAPE);
+	unsigned char executeAPE(PlanElement *pActionPatternElement, RuntimeElement *pAPERuntime, PlanElement *pDrive);
 	unsigned char testCEForRunningAP(PlanElement *pCE);
-	unsigned char clearCECompletedFlags(instinctID bParentID);
-	unsigned char clearAPECompletedFlags(instinctID bParentID);
+	unsigned char clearCECompletedFlags(PlanElement *pCompetence, RuntimeElement *pCompetenceRuntime);
+	unsigned char clearAPECompletedFlags(PlanElement *pActionPattern, RuntimeElement *pAPRuntime);
 };
 
+// the most parameters taken by any plan command
+#define INSTINCT_MAX_COMMAND_PARAMS	12
+// the longest line of a plan script read by loadPlan()
+#define INSTINCT_MAX_COMMAND_LENGTH	100
+
 class CmdPlanner : public Planner {
 public:
 	CmdPlanner(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Monitor *pMonitor);
 	const char * help(void);
 	unsigned char executeCommand(const char * pCmd, char *pRtnBuff, const int nRtnBuffLen); // execute a plan command and return data as a string
+	static int parseCommand(const char *pCmd, char *pCmdChars, int *pParams); // split a command into its characters and parameters
+	unsigned char loadPlan(const char *pText, const unsigned long ulLength); // replace the plan with a script of commands, sized to fit
+#ifndef ARDUINO
+	unsigned char loadPlanFromFile(const char *pFileName);
+#endif
+	unsigned long loadErrorLine(void); // the first line of the last script loaded that failed, or zero
+	unsigned long loadErrorCount(void); // the number of lines of the last script loaded that failed
 	unsigned char displayNode(char *pStrBuff, const int nBuffLen, const instinctID nElementID); // fill a string buffer with the command needed to add the node
 	unsigned char displayNode(char *pStrBuff, const int nBuffLen, const PlanNode *pPlanNode);
 	unsigned char displayNodeCounters(char *pStrBuff, const int nBuffLen, const instinctID nElementID); // fill a string buffer with the counters for the node
 	unsigned char displayNodeCounters(char *pStrBuff, const int nBuffLen, const PlanNode *pPlanNode);
 	unsigned char displayReleaser(char *pStrBuff, const int nBuffLen, const ReleaserType *pReleaser);
+	unsigned char displayNodeLatency(char *pStrBuff, const int nBuffLen, const instinctID nElementID); // fill a string buffer with the latency histograms for the node
+	unsigned char displayWorkCounters(char *pStrBuff, const int nBuffLen);
+
+private:
+	unsigned long _ulLoadErrorLine;
+	unsigned long _ulLoadErrorCount;
 };
 
+#ifdef INSTINCT_PLANNER_POOL
+// the planners stepped by one thread of a PlannerPool, as the run of positions uiNext to uiEnd - 1.
+// threads that have finished their own run steal chunks from the runs of other threads.
+// the padding keeps each run on its own cache line, so that threads taking chunks do not slow each other down
+typedef struct {
+	std::atomic<unsigned int> uiNext;
+	unsigned int uiEnd;
+	unsigned char bPad[64 - sizeof(std::atomic<unsigned int>) - sizeof(unsigned int)];
+} PlannerRunType;
+
+// steps many Planners on each tick, calling processTimers() and then runPlan() on each, just as a single loop would.
+// each Planner is only ever stepped by one thread at a time, and step() returns once every Planner has been stepped,
+// so the result is the same whatever the number of threads, provided the Planners do not share their Senses, Actions or Monitors.
+// Planners may share a plan with sharePlan(), but no plan may be changed during step()
+class PlannerPool {
+public:
+	PlannerPool(const unsigned int uiMaxPlanners, const unsigned int uiThreadCount); // uiThreadCount of 0 uses a thread per core
+	~PlannerPool();
+	unsigned char addPlanner(Planner *pPlanner); // the Planner still belongs to the caller, and must outlive the pool
+	unsigned int plannerCount(void);
+	Planner * planner(const unsigned int uiPlanner);
+	unsigned int threadCount(void);
+	void setChunkSize(const unsigned int uiChunkSize); // the number of Planners taken from a run at a time
+	unsigned int step(const unsigned int uiTime); // returns the number of Planners for which runPlan() returned true
+	unsigned char planResult(const unsigned int uiPlanner); // what runPlan() returned for the Planner in the last step()
+	unsigned long stolenChunks(void);
+
+private:
+	Planner ** _pPlanners;
+	unsigned char * _pResults;
+	unsigned int _uiMaxPlanners;
+	unsigned int _uiPlannerCount;
+	unsigned int _uiThreadCount;
+	unsigned int _uiChunkSize;
+	unsigned int _uiTime;
+	PlannerRunType * _pRuns; // one for each thread, the calling thread being thread 0
+	std::thread * _pThreads; // the other _uiThreadCount - 1 threads
+	std::mutex _sMutex;
+	std::condition_variable _sStart;
+	std::condition_variable _sDone;
+	unsigned long _ulTick; // changed to start the threads on the next tick
+	unsigned int _uiRunning; // threads yet to finish the current tick
+	unsigned char _bStop;
+	std::atomic<unsigned long> _ulStolenChunks;
+
+	void runThread(const unsigned int uiThread);
+	void stepRuns(const unsigned int uiThread);
+};
+#endif
 
 // ** the following structures and class are separate to the Planner itself, but allow names and ID's to be stored and retrieved
 // ** this is useful for debugging or for textual monitoring of plan operation
@@ -87,7 +87,7 @@ char * Names::getElementName(const instinctID bRuntime_ElementID)
 instinctID Names::getElementID(const char *pName)
 {
 	if (!pElementNameBuffer || !pName)
-		return NULL;
+		return 0;
 
 	ElementNameEntryType *pEntry = pElementNameBuffer->sEntry;
 
@@ -22,27 +22,72 @@
 #endif
 
 #include "Instinct.h"
+#include <stddef.h>
 
 namespace Instinct {
 
 PlanManager::PlanManager(instinctID *pPlanSize, Senses *pSenses, Actions *pActions, Monitor *pMonitor)
+	: _sMonitorAdapter(pMonitor)
 {
 	_nPlanID = 0;
 	_pSenses = pSenses;
 	_pActions = pActions;
-	_pMonitor = pMonitor;
+	_pMonitor = pMonitor ? &_sMonitorAdapter : 0;
+	_bGlobalMonitorFlags = 0;
 
 	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
 	{
 		_pPlan[i] = 0;
 		_pLastNode[i] = 0;
+		_pRuntime[i] = 0;
 		_nPlanSize[i] = 0;
 		_nNodeCount[i] = 0;
 	}
+	_pIndex = 0;
+	_uiIndexSize = 0;
+	_bOwnsIndex = false;
+	_bArenaIndex = false;
+	_bSharedPlan = false;
+	_pSharedFrom = 0;
+	_uiShareCount = 0;
+	_bLinked = false;
+	_bBrokenLinkID = 0;
+	_pDriveOrder = 0;
+	_bRunningDrive = (instinctID)-1;
+	_pReleaserSenses = 0;
+	_uiReleaserSenseCount = 0;
+	_bListReleaserSenses = false;
+	_pDriveTimers = 0;
+	_pTimerHeap = 0;
+	_uiTimerCount = 0;
+	_nTimerDrives = 0;
+	_ulTimerClock = 0;
+	_bTimersValid = false;
+	clearWorkCounters();
+	_pAllocator = 0;
+	_pArenaBuffer = 0;
+	_ulArenaBufferSize = 0;
+	_pArenaMemory = 0;
+	_pArena = 0;
+	_ulArenaSize = 0;
+	_ulArenaUsed = 0;
+	_bGrowPlan = false;
 
 	initialisePlan(pPlanSize);
 }
 
+// release the plan buffers
+PlanManager::~PlanManager()
+{
+	releasePlan();
+	if (_pReleaserSenses)
+		free((void *)_pReleaserSenses);
+	if (_pDriveTimers)
+		free((void *)_pDriveTimers);
+	if (_pTimerHeap)
+		free((void *)_pTimerHeap);
+}
+
 // the PlanID is a useful identifier to identify which plan we are using, but it need not be used
 void PlanManager::setPlanID(const int nPlanID)
 {
@@ -232,60 +277,398 @@ instinctID PlanManager::maxElementID(void)
 }
 
 
-//reset the current plan
+//reset the current plan, unless other PlanManagers are sharing it
 unsigned char PlanManager::initialisePlan(instinctID *pPlanSize)
 {
-	// set up the memory buffer for the various node types
+	unsigned int uiTotalSize = 0;
+
+	if (_uiShareCount)
+		return false;
+
+	_bLinked = false;
+	_bBrokenLinkID = 0;
+	_bRunningDrive = (instinctID)-1;
+
+	// the index is rebuilt as nodes are added
+	releasePlan();
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		_nPlanSize[i] = *(pPlanSize + i);
+		uiTotalSize += _nPlanSize[i];
+	}
+
+	// plans normally number their elements from 1, so size the index for that. It grows if larger ID's are added
+	if (!allocateArena(true, uiTotalSize ? uiTotalSize + 1 : 0))
+	{
+		// insufficient room for the plan is a fatal error
+		releasePlan();
+		return false;
+	}
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		_pLastNode[i] = _pPlan[i];
+
+	return uiTotalSize ? growIndex(uiTotalSize + 1) : true;
+}
+
+// release the arena and any index outside it, and empty the plan.
+// Plan elements and an index that belong to an adopted plan image or another PlanManager are left alone
+void PlanManager::releasePlan(void)
+{
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		_pPlan[i] = 0;
+		_pLastNode[i] = 0;
+		_pRuntime[i] = 0;
+		_nPlanSize[i] = 0;
+		_nNodeCount[i] = 0;
+	}
+	if (_pIndex && _bOwnsIndex)
+		memRelease((void *)_pIndex);
+	_pIndex = 0;
+	_uiIndexSize = 0;
+	_bOwnsIndex = false;
+	_bArenaIndex = false;
+	_pDriveOrder = 0;
+	if (_pArenaMemory)
+		memRelease(_pArenaMemory);
+	_pArenaMemory = 0;
+	_pArena = 0;
+	_ulArenaSize = 0;
+	_ulArenaUsed = 0;
+	_bSharedPlan = false;
+	if (_pSharedFrom)
+		_pSharedFrom->_uiShareCount--;
+	_pSharedFrom = 0;
+	_bTimersValid = false;
+}
+
+// round up to the start of the next buffer in the arena
+static unsigned long arenaAlign(const unsigned long ulOffset)
+{
+	return (ulOffset + INSTINCT_ARENA_ALIGN - 1) / INSTINCT_ARENA_ALIGN * INSTINCT_ARENA_ALIGN;
+}
+
+// the first aligned address in a block of memory
+static unsigned char * arenaStart(void *pMemory)
+{
+	return (unsigned char *)pMemory + (INSTINCT_ARENA_ALIGN - (size_t)pMemory % INSTINCT_ARENA_ALIGN) % INSTINCT_ARENA_ALIGN;
+}
+
+// place each buffer in the arena and return its size. The runtime values and Drive order come first, as they are
+// written as the plan runs, then the plan elements if the arena holds them, and last room for uiIndexSize index entries
+unsigned long PlanManager::arenaLayout(ArenaLayoutType *pLayout, const instinctID *pPlanSize, const unsigned char bPlan, const unsigned int uiIndexSize)
+{
+	unsigned long ulOffset = 0;
+
+	memset(pLayout, 0, sizeof(ArenaLayoutType));
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		pLayout->ulRuntimeOffset[i] = ulOffset;
+		ulOffset = arenaAlign(ulOffset + (unsigned long)pPlanSize[i] * runtimeSizeFromNodeType(i));
+	}
+	pLayout->ulDriveOrderOffset = ulOffset;
+	ulOffset = arenaAlign(ulOffset + (unsigned long)pPlanSize[INSTINCT_DRIVE] * sizeof(instinctID));
+	for (unsigned char i = 0; bPlan && (i < INSTINCT_NODE_TYPES); i++)
+	{
+		pLayout->ulPlanOffset[i] = ulOffset;
+		ulOffset = arenaAlign(ulOffset + (unsigned long)pPlanSize[i] * sizeFromNodeType(i));
+	}
+	pLayout->ulIndexOffset = ulOffset;
+	ulOffset += (unsigned long)uiIndexSize * sizeof(ElementIndexType);
+
+	pLayout->ulSize = ulOffset;
+	return ulOffset;
+}
+
+// the size of arena buffer that initialisePlan() needs for a plan of this size, allowing for the buffer to be aligned
+unsigned long PlanManager::planArenaSize(const instinctID *pPlanSize)
+{
+	ArenaLayoutType sLayout;
+	unsigned int uiTotalSize = 0;
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		uiTotalSize += pPlanSize[i];
+	if (!uiTotalSize)
+		return 0;
+
+	return arenaLayout(&sLayout, pPlanSize, true, uiTotalSize + 1) + INSTINCT_ARENA_ALIGN - 1;
+}
+
+// Take one block of memory for the zeroed runtime values of as many elements as each plan buffer can hold, room to hold every Drive
+// in priority order, the plan buffers themselves if bPlan, and uiIndexSize index entries. Each is carved from the block,
+// and any Drives already in the plan start at their initial priority. The block comes from the arena buffer if there is one,
+// otherwise from the Allocator or malloc()
+unsigned char PlanManager::allocateArena(const unsigned char bPlan, const unsigned int uiIndexSize)
+{
+	ArenaLayoutType sLayout;
+	PlanElement *pElement;
+	RuntimeElement *pRuntime;
+
+	unsigned long ulSize = arenaLayout(&sLayout, _nPlanSize, bPlan, uiIndexSize);
+	if (!ulSize)
+		return true; // an empty plan needs no memory at all
+
+	if (_pArenaBuffer)
+	{
+		unsigned long ulSkip = (unsigned long)(arenaStart(_pArenaBuffer) - _pArenaBuffer);
+		if (_ulArenaBufferSize < ulSkip + ulSize)
+			return false;
+		_pArena = _pArenaBuffer + ulSkip;
+		_ulArenaSize = _ulArenaBufferSize - ulSkip;
+	}
+	else
+	{
+		_pArenaMemory = memAllocate(ulSize + INSTINCT_ARENA_ALIGN - 1);
+		if (!_pArenaMemory)
+			return false;
+		_pArena = arenaStart(_pArenaMemory);
+		_ulArenaSize = ulSize;
+	}
+	memset(_pArena, 0, ulSize);
+	_ulArenaUsed = sLayout.ulIndexOffset; // growIndex() takes the rest
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		if (!_nPlanSize[i])
+			continue;
+		_pRuntime[i] = (RuntimeElement *)(_pArena + sLayout.ulRuntimeOffset[i]);
+		if (bPlan)
+			_pPlan[i] = (PlanElement *)(_pArena + sLayout.ulPlanOffset[i]);
+	}
+	if (_nPlanSize[INSTINCT_DRIVE])
+		_pDriveOrder = (instinctID *)(_pArena + sLayout.ulDriveOrderOffset);
+	_bTimersValid = false; // the Drive timers start again from the new runtime counters
+
+	pElement = _pPlan[INSTINCT_DRIVE];
+	pRuntime = _pRuntime[INSTINCT_DRIVE];
+	for (instinctID i = 0; i < _nNodeCount[INSTINCT_DRIVE]; i++)
+	{
+		pRuntime->sDrive.bRuntime_Priority = pElement->sDrive.sDrivePriority.bPriority;
+		pElement = (PlanElement *)((unsigned char *)pElement + sizeFromNodeType(INSTINCT_DRIVE));
+		pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + runtimeSizeFromNodeType(INSTINCT_DRIVE));
+	}
+
+	return true;
+}
+
+void * PlanManager::memAllocate(const unsigned long ulSize)
+{
+	return _pAllocator ? _pAllocator->allocate(ulSize) : malloc(ulSize);
+}
+
+void PlanManager::memRelease(void *pMemory)
+{
+	if (_pAllocator)
+		_pAllocator->release(pMemory);
+	else
+		free(pMemory);
+}
+
+// Allocate the plan arena from pAllocator from now on, or with malloc() if it is 0. The current plan is emptied,
+// as its memory came from elsewhere, so call initialisePlan() or load a plan next
+void PlanManager::setAllocator(Allocator *pAllocator)
+{
+	releasePlan();
+	_pAllocator = pAllocator;
+}
+
+// Carve the plan arena from pBuffer from now on, so that the plan takes no memory from the heap. planArenaSize() gives the size
+// needed to initialise a plan. The buffer must stay in place while the PlanManager uses it. If pBuffer is 0 the arena is allocated again.
+// The current plan is emptied, so call initialisePlan() or load a plan next
+void PlanManager::setArenaBuffer(unsigned char *pBuffer, const unsigned long ulBufferSize)
+{
+	releasePlan();
+	_pArenaBuffer = pBuffer;
+	_ulArenaBufferSize = pBuffer ? ulBufferSize : 0;
+}
+
+// the bytes available in the arena, and those used
+unsigned long PlanManager::arenaSize(void)
+{
+	return _ulArenaSize;
+}
+
+unsigned long PlanManager::arenaUsed(void)
+{
+	return _ulArenaUsed;
+}
+
+// Let addNode() grow the buffer of a node type when it is full, so that a plan can be built up a node at a time without
+// being sized first. Each time, every buffer moves to a new arena, so the arena cannot be an arena buffer. Nodes must not be
+// added from a Senses or Actions callback while this is enabled, as runPlan() holds pointers into the arena
+void PlanManager::enablePlanGrowth(const unsigned char bGrow)
+{
+	_bGrowPlan = bGrow;
+}
+
+// Double the buffer of nNodeType, or give it INSTINCT_PLAN_GROWTH_MIN elements if it has none. A new arena is allocated and
+// the plan elements, runtime values, Drive order and an index in the arena are copied across as they are. These all refer
+// to elements by their position within their buffer, which does not change, so the index and links stay good
+unsigned char PlanManager::growPlan(const unsigned char nNodeType)
+{
+	ArenaLayoutType sLayout;
+	instinctID nPlanSize[INSTINCT_NODE_TYPES];
+
+	if (_pArenaBuffer)
+		return false;
+
+	unsigned long ulGrowTo = _nPlanSize[nNodeType] ? (unsigned long)_nPlanSize[nNodeType] * 2 : INSTINCT_PLAN_GROWTH_MIN;
+	if (ulGrowTo > (unsigned long)INSTINCT_MAX_INSTINCTID)
+		ulGrowTo = INSTINCT_MAX_INSTINCTID;
+	if (ulGrowTo <= _nPlanSize[nNodeType])
+		return false;
+
+	memcpy(nPlanSize, _nPlanSize, sizeof(nPlanSize));
+	nPlanSize[nNodeType] = (instinctID)ulGrowTo;
+	unsigned long ulSize = arenaLayout(&sLayout, nPlanSize, true, _bArenaIndex ? _uiIndexSize : 0);
+
+	void *pMemory = memAllocate(ulSize + INSTINCT_ARENA_ALIGN - 1);
+	if (!pMemory)
+		return false;
+	unsigned char *pArena = arenaStart(pMemory);
+	memset(pArena, 0, ulSize);
+
 	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
 	{
-		if (_pPlan[i])
+		_nPlanSize[i] = nPlanSize[i];
+		if (!_nPlanSize[i])
+			continue;
+		if (_nNodeCount[i])
 		{
-			free((void *)_pPlan[i]);
-			_pPlan[i] = 0;
-			_pLastNode[i] = 0;
-			_nPlanSize[i] = 0;
-			_nNodeCount[i] = 0;
+			memcpy(pArena + sLayout.ulPlanOffset[i], _pPlan[i], (unsigned long)_nNodeCount[i] * sizeFromNodeType(i));
+			memcpy(pArena + sLayout.ulRuntimeOffset[i], _pRuntime[i], (unsigned long)_nNodeCount[i] * runtimeSizeFromNodeType(i));
 		}
-		unsigned int nSize = *(pPlanSize + i);
-		unsigned int nBuffSize;
-		if (nSize != 0)
-		{
-			nBuffSize = nSize * sizeFromNodeType(i);
-			_pPlan[i] = (PlanElement *)malloc(nBuffSize);
+		_pPlan[i] = (PlanElement *)(pArena + sLayout.ulPlanOffset[i]);
+		_pRuntime[i] = (RuntimeElement *)(pArena + sLayout.ulRuntimeOffset[i]);
+		_pLastNode[i] = (PlanElement *)((unsigned char *)_pPlan[i] + (_nNodeCount[i] ? (_nNodeCount[i] - 1) * sizeFromNodeType(i) : 0));
+	}
+	if (_nPlanSize[INSTINCT_DRIVE])
+	{
+		if (_nNodeCount[INSTINCT_DRIVE])
+			memcpy(pArena + sLayout.ulDriveOrderOffset, _pDriveOrder, _nNodeCount[INSTINCT_DRIVE] * sizeof(instinctID));
+		_pDriveOrder = (instinctID *)(pArena + sLayout.ulDriveOrderOffset);
+	}
+	if (_bArenaIndex)
+	{
+		memcpy(pArena + sLayout.ulIndexOffset, _pIndex, _uiIndexSize * sizeof(ElementIndexType));
+		_pIndex = (ElementIndexType *)(pArena + sLayout.ulIndexOffset);
+	}
 
-			// if the malloc fails this is a fatal error as insufficient room for plan
-			if (!_pPlan[i])
-				return false;
-			memset(_pPlan[i], 0, nBuffSize);
-			_nPlanSize[i] = nSize;
-			_pLastNode[i] = _pPlan[i];
+	if (_pArenaMemory)
+		memRelease(_pArenaMemory);
+	_pArenaMemory = pMemory;
+	_pArena = pArena;
+	_ulArenaSize = ulSize;
+	_ulArenaUsed = ulSize;
+
+	return true;
+}
+
+// extend the ElementID index so that it can hold ID's up to uiIndexSize - 1, marking new entries as unused.
+// Spare room in the arena is used first, and then a block of its own. An arena buffer never falls back on the heap
+unsigned char PlanManager::growIndex(const unsigned int uiIndexSize)
+{
+	ElementIndexType *pIndex = 0;
+	unsigned long ulBytes = (unsigned long)uiIndexSize * sizeof(ElementIndexType);
+	unsigned char bArenaIndex = false;
+	unsigned char bCopy = true; // the entries we have move to the new index, unless it grew where it is
+
+	if (uiIndexSize <= _uiIndexSize)
+		return true;
+
+	if (_pArena)
+	{
+		// the index can grow in place if nothing follows it in the arena
+		unsigned long ulOffset = arenaAlign(_ulArenaUsed);
+		if (_bArenaIndex && ((unsigned char *)(_pIndex + _uiIndexSize) == _pArena + _ulArenaUsed))
+			ulOffset = (unsigned long)((unsigned char *)_pIndex - _pArena);
+		if (ulOffset + ulBytes <= _ulArenaSize)
+		{
+			pIndex = (ElementIndexType *)(_pArena + ulOffset);
+			_ulArenaUsed = ulOffset + ulBytes;
+			bArenaIndex = true;
+			bCopy = (pIndex != _pIndex);
+		}
+	}
+	if (!pIndex)
+	{
+		if (_pArenaBuffer)
+			return false;
+		if (_bOwnsIndex && !_pAllocator)
+		{
+			pIndex = (ElementIndexType *)realloc((void *)_pIndex, ulBytes);
+			bCopy = false;
 		}
+		else
+			pIndex = (ElementIndexType *)memAllocate(ulBytes);
+		if (!pIndex)
+			return false;
+	}
+
+	if (bCopy)
+	{
+		if (_uiIndexSize)
+			memcpy(pIndex, _pIndex, _uiIndexSize * sizeof(ElementIndexType));
+		if (_bOwnsIndex)
+			memRelease((void *)_pIndex);
+	}
+	_bArenaIndex = bArenaIndex;
+	_bOwnsIndex = !bArenaIndex;
+
+	for (unsigned int i = _uiIndexSize; i < uiIndexSize; i++)
+	{
+		pIndex[i].bNodeType = INSTINCT_NODE_TYPES;
+		pIndex[i].bElement = 0;
 	}
-	// all memory allocations successful
+	_pIndex = pIndex;
+	_uiIndexSize = uiIndexSize;
+
 	return true;
 }
 
 // add a plan node to the end of the plan
 // check there is space in the correct plan buffer first
-// update _nNodeCount and _pLastNode
+// update _nNodeCount and _pLastNode. A plan cannot be added to while it is shared
 unsigned char PlanManager::addNode(PlanNode *pNode)
 {
 	int nNodeSize;
 	int nLastNodeSize;
 	unsigned char nNodeType;
 
-	if (!pNode)
+	if (!pNode || _bSharedPlan || _uiShareCount)
 		return false;
 	nNodeType = pNode->bNodeType;
 	nNodeSize = sizeFromNodeType(nNodeType);
 	if (!nNodeSize)
 		return false; // not a valid node type
 
+	// check there is room to add the new plan node, making more if the plan may grow
+	if ((_nNodeCount[nNodeType] >= _nPlanSize[nNodeType]) && !(_bGrowPlan && growPlan(nNodeType)))
+		return false;
+
 	if (!_pLastNode[nNodeType])
 		return false; // no buffer for nodes of this type
 
-	// check there is room to add the new plan node
-	if (_nNodeCount[nNodeType] >= _nPlanSize[nNodeType])
+	// make sure the ElementID can be indexed, doubling the index if it needs to grow
+	unsigned int uiElementID = pNode->sElement.sReferences.bRuntime_ElementID;
+	if (uiElementID >= INSTINCT_MAX_INDEX_SIZE)
+		return false;
+	if (uiElementID >= _uiIndexSize)
+	{
+		unsigned int uiIndexSize = _uiIndexSize * 2;
+		if (uiIndexSize <= uiElementID)
+			uiIndexSize = uiElementID + 1;
+		if (uiIndexSize > INSTINCT_MAX_INDEX_SIZE)
+			uiIndexSize = (unsigned int)INSTINCT_MAX_INDEX_SIZE;
+		if (!growIndex(uiIndexSize))
+			return false;
+	}
+	if (uiElementID >= _uiIndexSize)
+		return false;
+
+	// ElementID's must be unique across the whole plan
+	if (_pIndex[uiElementID].bNodeType != INSTINCT_NODE_TYPES)
 		return false;
 
 	// Get size of last node, or zero if no nodes yet
@@ -298,13 +681,20 @@ unsigned char PlanManager::addNode(PlanNode *pNode)
 	case INSTINCT_DRIVE:
 		// for Drive we need to copy the initial Drive Priority to the Runtime value before any processing starts
 		pNode->sElement.sDrive.sDrivePriority.bRuntime_Priority = pNode->sElement.sDrive.sDrivePriority.bPriority;
+		// a tickless Planner must build its timers again to include the new Drive
+		syncTimers(true);
 		break;
 	}
 
-	// all is good, so add the node
+	// all is good, so add the node, and its runtime values alongside
 	_pLastNode[nNodeType] = (PlanElement *)((unsigned char *)_pLastNode[nNodeType] + nLastNodeSize);
 	memcpy(_pLastNode[nNodeType], &(pNode->sElement), nNodeSize);
+	copyRuntime(&(pNode->sElement), (RuntimeElement *)((unsigned char *)_pRuntime[nNodeType] +
+		_nNodeCount[nNodeType] * runtimeSizeFromNodeType(nNodeType)), nNodeType, false);
+	_pIndex[uiElementID].bNodeType = nNodeType;
+	_pIndex[uiElementID].bElement = _nNodeCount[nNodeType];
 	_nNodeCount[nNodeType]++;
+	_bLinked = false;
 
 	return true;
 }
@@ -313,36 +703,33 @@ unsigned char PlanManager::addNode(PlanNode *pNode)
 unsigned char PlanManager::getNode(PlanNode *pPlanNode, const instinctID uiElementID)
 {
 	PlanElement * pPlanElement;
+	unsigned char nNodeType;
 
 	if (!pPlanNode)
 		return false;
 
-	// run over all the plan buffers, searching for the correct ElementID in each buffer
-	// this could be quite slow
-	for (unsigned char nNodeType = 0; nNodeType < INSTINCT_NODE_TYPES; nNodeType++)
-	{
-		pPlanElement = findElement(uiElementID, nNodeType);
+	pPlanElement = findElementAndType(uiElementID, &nNodeType);
+	if (!pPlanElement)
+		return false; // no matching node found
 
-		if (pPlanElement)
-		{
-			pPlanNode->bNodeType = nNodeType;
-			memcpy(&(pPlanNode->sElement), pPlanElement, sizeFromNodeType(nNodeType));
+	if ((nNodeType == INSTINCT_DRIVE) && _bTimersValid)
+		syncDriveTimers(_pIndex[uiElementID].bElement);
 
-			return true; // all done
-		}
-	}
+	pPlanNode->bNodeType = nNodeType;
+	memcpy(&(pPlanNode->sElement), pPlanElement, sizeFromNodeType(nNodeType));
+	copyRuntime(&(pPlanNode->sElement), runtime(pPlanElement, nNodeType), nNodeType, true);
 
-	return false; // no matching node found
+	return true; // all done
 }
 
 // update a plan node based on its node type and elementID
-// first find a matching node, then copy its values over
+// first find a matching node, then copy its values over. A plan cannot be changed while it is shared
 unsigned char  PlanManager::updateNode(PlanNode *pNode)
 {
 	PlanElement * pPlanElement;
 
 	// check the supplied node for validity
-	if (!pNode)
+	if (!pNode || _bSharedPlan || _uiShareCount)
 		return false;
 
 	// search over all nodes of the matching node type
@@ -350,265 +737,1397 @@ unsigned char  PlanManager::updateNode(PlanNode *pNode)
 	if (!pPlanElement) // not found
 		return false;
 
+	if (pNode->bNodeType == INSTINCT_DRIVE)
+		syncTimers(true); // the Drive's timers may have changed
+
 	memcpy(pPlanElement, &(pNode->sElement), sizeFromNodeType(pNode->bNodeType));
+	copyRuntime(&(pNode->sElement), runtime(pPlanElement, pNode->bNodeType), pNode->bNodeType, false);
+	_bLinked = false; // the child may have changed
 
 	return true; // all done
 }
 
-// set the monitoring flags on a node
-unsigned char PlanManager::monitorNode(const instinctID bRuntime_ElementID, const unsigned char bMonitorExecuted, const unsigned char bMonitorSuccess,
-	const unsigned char bMonitorPending, const unsigned char bMonitorFail, const unsigned char bMonitorError, const unsigned char bMonitorSense)
+// Change the definition of an element already in the plan, leaving its runtime values as they are, so that a running plan
+// can be tuned. The runtime fields of pNode are ignored. Only what depends on the changed values is redone - the Drive order
+// is sorted again when a Drive priority changes, the releaser senses are listed again when a releaser reads a different sense,
+// and the plan is only relinked when a child, a parent, a CE priority or an APE order changes. A Drive whose runtime priority
+// has not ramped away from its priority moves to the new priority, and a CE or APE moved to another parent is no longer the current
+// element of its old parent. On relinking, children with the same priority or order keep
+// the order they had when the plan was last linked. A plan cannot be changed while it is shared
+unsigned char PlanManager::patchNode(PlanNode *pNode)
 {
+	PlanElement sOld;
+	RuntimeElement sOldRuntime;
 	PlanElement *pElement;
+	unsigned char bRelink = false;
 
-	if (!_pMonitor)
+	if (!pNode || _bSharedPlan || _uiShareCount)
 		return false;
-	pElement = findElement(bRuntime_ElementID);
+
+	unsigned char nNodeType = pNode->bNodeType;
+	pElement = findElement(pNode->sElement.sReferences.bRuntime_ElementID, nNodeType);
 	if (!pElement)
 		return false;
-	pElement->sCounters.bMonitorFlags = (bMonitorExecuted ? 0x01 : 0x0) | (bMonitorSuccess ? 0x02 : 0x0) | (bMonitorPending ? 0x04 : 0x0) |
-		(bMonitorFail ? 0x08 : 0x0) | (bMonitorError ? 0x10 : 0x0) | (bMonitorSense ? 0x20 : 0x0);
-	return true;
-}
 
-// set the global flags that will cause monitoring of all executions and successes
-void PlanManager::setGlobalMonitorFlags(const unsigned char bMonitorExecuted, const unsigned char bMonitorSuccess,
-	const unsigned char bMonitorPending, const unsigned char bMonitorFail, const unsigned char bMonitorError, const unsigned char bMonitorSense)
-{
-	_bGlobalMonitorFlags = (bMonitorExecuted ? 0x01 : 0x0) | (bMonitorSuccess ? 0x02 : 0x0) | (bMonitorPending ? 0x04 : 0x0) |
-		(bMonitorFail ? 0x08 : 0x0) | (bMonitorError ? 0x10 : 0x0) | (bMonitorSense ? 0x20 : 0x0);
-}
+	if (nNodeType == INSTINCT_DRIVE)
+		syncTimers(true); // the Drive's timers may have changed
 
-// set the Drive Priority for the given element ID. Return 0 if not found
-unsigned char PlanManager::setDrivePriority(const instinctID bRuntime_ElementID, const instinctID bPriority)
-{
-	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
-	if (!pDrive)
-		return false;
+	int nSize = sizeFromNodeType(nNodeType);
+	memcpy(&sOld, pElement, nSize);
+	memcpy(pElement, &(pNode->sElement), nSize);
 
-	pDrive->sDrive.sDrivePriority.bPriority = bPriority;
+	// the runtime fields of the element itself are unused, but are kept so that the plan image is not changed by them
+	copyRuntime(&sOld, &sOldRuntime, nNodeType, false);
+	copyRuntime(pElement, &sOldRuntime, nNodeType, true);
 
-	return true;
-}
+	// keep what linkPlan() resolved, unless it was resolved from a value that has changed
+	ParentChildReferences *pParentChild = parentChild(pElement, nNodeType);
+	if (pParentChild)
+	{
+		ParentChildReferences *pOld = parentChild(&sOld, nNodeType);
+		pParentChild->sChildLink = pOld->sChildLink;
+		if ((pParentChild->bRuntime_ParentID != pOld->bRuntime_ParentID) || (pParentChild->bRuntime_ChildID != pOld->bRuntime_ChildID) ||
+			(childOrder(pElement, nNodeType) != childOrder(&sOld, nNodeType)))
+			bRelink = true;
+
+		// an old parent that is part way through this element must not resume at it once it has gone
+		if (pParentChild->bRuntime_ParentID != pOld->bRuntime_ParentID)
+		{
+			unsigned char nParentType = (nNodeType == INSTINCT_ACTIONPATTERNELEMENT) ? INSTINCT_ACTIONPATTERN : INSTINCT_COMPETENCE;
+			PlanElement *pParent = findElement(pOld->bRuntime_ParentID, nParentType);
+			if (pParent)
+			{
+				RuntimeElement *pParentRuntime = runtime(pParent, nParentType);
+				instinctID *pCurrentID = (nParentType == INSTINCT_ACTIONPATTERN) ? &pParentRuntime->sActionPattern.bRuntime_CurrentElementID :
+					&pParentRuntime->sCompetence.bRuntime_CurrentElementID;
+				if (*pCurrentID == pElement->sReferences.bRuntime_ElementID)
+					*pCurrentID = 0;
+			}
+		}
+	}
+	ChildListType *pChildren = childList(pElement, nNodeType);
+	if (pChildren)
+		*pChildren = *childList(&sOld, nNodeType);
 
-// set the Drive Priority for the given element ID. Return 0 if not found
-unsigned char PlanManager::setRuntimeDrivePriority(const instinctID bRuntime_ElementID, const instinctID bPriority)
-{
-	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
-	if (!pDrive)
-		return false;
+	if (nNodeType == INSTINCT_DRIVE)
+	{
+		pElement->sDrive.sChildLink = sOld.sDrive.sChildLink;
+		if (pElement->sDrive.bRuntime_ChildID != sOld.sDrive.bRuntime_ChildID)
+			bRelink = true;
+
+		RuntimeElement *pRuntime = runtime(pElement, INSTINCT_DRIVE);
+		if (pRuntime->sDrive.bRuntime_Priority == sOld.sDrive.sDrivePriority.bPriority)
+			pRuntime->sDrive.bRuntime_Priority = pElement->sDrive.sDrivePriority.bPriority;
+		if (_bLinked)
+			sortDriveOrder();
+	}
+
+	ReleaserType *pReleaser = releaser(pElement, nNodeType);
+	if (pReleaser && _bLinked && _bListReleaserSenses)
+	{
+		ReleaserType *pOld = releaser(&sOld, nNodeType);
+		if ((pReleaser->bSenseID != pOld->bSenseID) || (pReleaser->bComparator != pOld->bComparator))
+			listReleaserSenses();
+	}
 
-	pDrive->sDrive.sDrivePriority.bRuntime_Priority = bPriority;
+	if (bRelink)
+		_bLinked = false;
 
 	return true;
 }
 
-// get the Drive Priority for the given element ID. Return 0 if not found
-instinctID PlanManager::getDrivePriority(const instinctID bRuntime_ElementID)
+// fill in the header of a plan image for the current plan, and return the size of the image
+// each part of the image is aligned as it would be in memory
+unsigned long PlanManager::planImageLayout(PlanImageHeaderType *pHeader, const unsigned char bIncludeIndex)
 {
-	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
-	if (!pDrive)
-		return 0;
+	unsigned long ulOffset;
 
-	return pDrive->sDrive.sDrivePriority.bPriority;
+	memset(pHeader, 0, sizeof(PlanImageHeaderType));
+	pHeader->ulMagic = INSTINCT_PLAN_IMAGE_MAGIC;
+	pHeader->bVersion = INSTINCT_PLAN_IMAGE_VERSION;
+	pHeader->bIDSize = sizeof(instinctID);
+
+	ulOffset = sizeof(PlanImageHeaderType);
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		ulOffset = (ulOffset + INSTINCT_ALIGNOF(PlanElement) - 1) / INSTINCT_ALIGNOF(PlanElement) * INSTINCT_ALIGNOF(PlanElement);
+		pHeader->uiElementSize[i] = (unsigned short)sizeFromNodeType(i);
+		pHeader->nNodeCount[i] = _nNodeCount[i];
+		pHeader->ulElementOffset[i] = ulOffset;
+		ulOffset += (unsigned long)_nNodeCount[i] * pHeader->uiElementSize[i];
+	}
+
+	if (bIncludeIndex && _uiIndexSize)
+	{
+		ulOffset = (ulOffset + INSTINCT_ALIGNOF(ElementIndexType) - 1) / INSTINCT_ALIGNOF(ElementIndexType) * INSTINCT_ALIGNOF(ElementIndexType);
+		pHeader->ulIndexOffset = ulOffset;
+		pHeader->ulIndexSize = _uiIndexSize;
+		ulOffset += _uiIndexSize * sizeof(ElementIndexType);
+	}
+
+	pHeader->ulImageSize = ulOffset;
+	return ulOffset;
 }
 
-// get the Runtime Drive Priority for the given element ID. Return 0 if not found
-instinctID PlanManager::getRuntimeDrivePriority(const instinctID bRuntime_ElementID)
+// the number of bytes needed by writePlanImage()
+unsigned long PlanManager::planImageSize(const unsigned char bIncludeIndex)
 {
-	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
-	if (!pDrive)
-		return false;
+	PlanImageHeaderType sHeader;
 
-	return pDrive->sDrive.sDrivePriority.bRuntime_Priority;
+	return planImageLayout(&sHeader, bIncludeIndex);
 }
 
-// find an element based on the supplied ElementID and NodeType
-// return null pointer if no match
-PlanElement * PlanManager::findElement(const instinctID bElementID, const unsigned char nNodeType)
+// Write the plan as a binary image into pImage, which must be aligned for a PlanElement. The plan is linked first,
+// so the elements are stored grouped and sorted. Only the definition of the plan is written - see saveRuntimeState().
+// With bIncludeIndex, the ElementID index is written too, so that adoptPlanImage() need not build it
+unsigned char PlanManager::writePlanImage(unsigned char *pImage, const unsigned long ulImageSize, const unsigned char bIncludeIndex)
 {
-	PlanElement *pPlanElement = 0;
-	int nSize;
+	PlanImageHeaderType sHeader;
 
-	nSize = sizeFromNodeType(nNodeType);
-	if (!nSize) // invalid node type
-		return 0;
+	if (!pImage || (planImageLayout(&sHeader, bIncludeIndex) > ulImageSize))
+		return false;
 
-	pPlanElement = _pPlan[nNodeType];
+	if (!_bLinked)
+		linkPlan();
 
-	for (instinctID i = 0; i < _nNodeCount[nNodeType]; i++)
+	memset(pImage, 0, sHeader.ulImageSize);
+	memcpy(pImage, &sHeader, sizeof(PlanImageHeaderType));
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
 	{
-		if (pPlanElement->sReferences.bRuntime_ElementID == bElementID)
-		{
-			return pPlanElement;
-		}
-		pPlanElement = (PlanElement *)((unsigned char *)pPlanElement + nSize);
+		if (sHeader.nNodeCount[i])
+			memcpy(pImage + sHeader.ulElementOffset[i], _pPlan[i], (unsigned long)sHeader.nNodeCount[i] * sHeader.uiElementSize[i]);
 	}
+	if (sHeader.ulIndexOffset)
+		memcpy(pImage + sHeader.ulIndexOffset, _pIndex, sHeader.ulIndexSize * sizeof(ElementIndexType));
 
-	return 0; // no match
+	return true;
 }
 
-// find an element based on the supplied ElementID
-// return null pointer if no match
-PlanElement * PlanManager::findElement(const instinctID bElementID)
+// a child link in a plan image must be to an Action, Action Pattern or Competence within the image, or be broken
+static unsigned char validImageLink(const ElementIndexType *pLink, const PlanImageHeaderType *pHeader)
 {
-	PlanElement *pElement;
-	for (int i = 0; i < INSTINCT_NODE_TYPES; i++)
+	switch (pLink->bNodeType)
 	{
-		pElement = findElement(bElementID, i);
-		if (pElement)
-		{
-			return pElement;
-		}
+	case INSTINCT_ACTION:
+	case INSTINCT_ACTIONPATTERN:
+	case INSTINCT_COMPETENCE:
+		return (pLink->bElement < pHeader->nNodeCount[pLink->bNodeType]) ? true : false;
+	case INSTINCT_NODE_TYPES:
+		return true;
 	}
-	return 0;
+	return false;
 }
 
-// find an element based on the supplied ElementID, populate the NodeType element
-// return null pointer if no match
-PlanElement * PlanManager::findElementAndType(const instinctID bElementID, unsigned char *pNodeType)
+// the children of a Competence or Action Pattern in a plan image must lie within the image's CE's or APE's
+static unsigned char validImageChildren(const ChildListType *pChildren, const instinctID nChildCount)
 {
-	PlanElement *pElement;
-	for (int i = 0; i < INSTINCT_NODE_TYPES; i++)
-	{
-		pElement = findElement(bElementID, i);
-		if (pElement)
-		{
-			*pNodeType = i;
-			return pElement;
-		}
-	}
-	return 0;
+	return ((unsigned long)pChildren->bFirstElement + pChildren->bElementCount <= nChildCount) ? true : false;
 }
 
-// find an Action (A), an Action Pattern (AP), or a Competence (C)
-// return pointer to the Element, and populate the NodeType
-PlanElement * PlanManager::findChildAorAPorC(const instinctID bElementID, unsigned char *pNodeType)
+// Replace the current plan with the plan image in pImage, using the elements where they are rather than copying them.
+// The image may be a file mapped into memory, or a region of RAM or flash. It must stay in place until the plan is reset or the
+// PlanManager is destroyed. The image is only read, as the runtime values are kept apart from it, so one image may be adopted
+// by many Planners, and on Linux a file may be mapped with mmap(PROT_READ, MAP_SHARED). The adopted plan cannot be changed.
+// If the image has no index then one is built. Our own plan cannot be replaced while others share it. The image is checked before the current plan is released, including
+// every child link and list and every index entry, and false is returned if it is not valid for this platform
+unsigned char PlanManager::adoptPlanImage(unsigned char *pImage, const unsigned long ulImageSize)
 {
-	PlanElement *pPlanElement;
+	PlanImageHeaderType sHeader;
+	unsigned int uiTotalSize = 0;
 
-	if (pPlanElement = findElement(bElementID, INSTINCT_ACTION))
-	{
-		*pNodeType = INSTINCT_ACTION;
-		return pPlanElement;
-	}
-	else if (pPlanElement = findElement(bElementID, INSTINCT_ACTIONPATTERN))
-	{
-		*pNodeType = INSTINCT_ACTIONPATTERN;
-		return pPlanElement;
-	}
-	else if (pPlanElement = findElement(bElementID, INSTINCT_COMPETENCE))
-	{
-		*pNodeType = INSTINCT_COMPETENCE;
-		return pPlanElement;
-	} else
+	if (!pImage || (ulImageSize < sizeof(PlanImageHeaderType)) || ((size_t)pImage % INSTINCT_ALIGNOF(PlanElement)) || _uiShareCount)
+		return false;
+
+	memcpy(&sHeader, pImage, sizeof(PlanImageHeaderType));
+	if ((sHeader.ulMagic != INSTINCT_PLAN_IMAGE_MAGIC) || (sHeader.bVersion != INSTINCT_PLAN_IMAGE_VERSION) ||
+		(sHeader.bIDSize != sizeof(instinctID)) || (sHeader.ulImageSize > ulImageSize))
+		return false;
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
 	{
-		*pNodeType = INSTINCT_NODE_TYPES; // this will always be an invalid node type (Defensive Coding!)
+		if ((sHeader.uiElementSize[i] != sizeFromNodeType(i)) || (sHeader.ulElementOffset[i] % INSTINCT_ALIGNOF(PlanElement)) ||
+			(sHeader.ulElementOffset[i] + (unsigned long)sHeader.nNodeCount[i] * sHeader.uiElementSize[i] > sHeader.ulImageSize))
+			return false;
+		uiTotalSize += sHeader.nNodeCount[i];
 	}
-	return 0;
-}
 
-// Count runtime execution and notify Monitor if enabled
-void PlanManager::countExecution(PlanElement *pElement, const unsigned char bNodeType)
-{
-	pElement->sCounters.uiRuntime_ExecutionCount++;
-	if (_pMonitor && ((_bGlobalMonitorFlags & 0x01) || (pElement->sCounters.bMonitorFlags & 0x01)))
+	if (sHeader.ulIndexOffset)
 	{
-		PlanNode sNode;
-		int nNodeSize;
-		nNodeSize = sizeFromNodeType(bNodeType);
-		if (nNodeSize)
+		ElementIndexType *pIndex = (ElementIndexType *)(pImage + sHeader.ulIndexOffset);
+		if ((sHeader.ulIndexOffset % INSTINCT_ALIGNOF(ElementIndexType)) || (sHeader.ulIndexSize > INSTINCT_MAX_INDEX_SIZE) ||
+			(sHeader.ulIndexOffset + sHeader.ulIndexSize * sizeof(ElementIndexType) > sHeader.ulImageSize))
+			return false;
+		for (unsigned long i = 0; i < sHeader.ulIndexSize; i++)
 		{
-			sNode.bNodeType = bNodeType;
-			memcpy(&sNode.sElement, pElement, nNodeSize);
-			_pMonitor->nodeExecuted(&sNode);
+			if (pIndex[i].bNodeType == INSTINCT_NODE_TYPES)
+				continue;
+			if ((pIndex[i].bNodeType > INSTINCT_NODE_TYPES) || (pIndex[i].bElement >= sHeader.nNodeCount[pIndex[i].bNodeType]))
+				return false;
+			// the entry must lead back to the element with this ID
+			PlanElement *pElement = (PlanElement *)(pImage + sHeader.ulElementOffset[pIndex[i].bNodeType] +
+				(unsigned long)pIndex[i].bElement * sHeader.uiElementSize[pIndex[i].bNodeType]);
+			if (pElement->sReferences.bRuntime_ElementID != i)
+				return false;
 		}
 	}
-}
 
-// Count runtime success and notify Monitor if enabled
-void PlanManager::countSuccess(PlanElement *pElement, const unsigned char bNodeType)
-{
-	pElement->sCounters.uiRuntime_SuccessCount++;
-	if (_pMonitor && ((_bGlobalMonitorFlags & 0x02) || (pElement->sCounters.bMonitorFlags & 0x02)))
+	// the Planner follows the links and child lists without checking them, so they must all be within the image
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
 	{
-		PlanNode sNode;
-		int nNodeSize;
-		nNodeSize = sizeFromNodeType(bNodeType);
-		if (nNodeSize)
+		PlanElement *pElement = (PlanElement *)(pImage + sHeader.ulElementOffset[i]);
+		for (instinctID j = 0; j < sHeader.nNodeCount[i]; j++)
 		{
-			sNode.bNodeType = bNodeType;
-			memcpy(&sNode.sElement, pElement, nNodeSize);
-			_pMonitor->nodeSuccess(&sNode);
+			unsigned char bValid = (pElement->sReferences.bRuntime_ElementID < INSTINCT_MAX_INDEX_SIZE) ? true : false;
+			switch (i)
+			{
+			case INSTINCT_DRIVE:
+				bValid = bValid && validImageLink(&pElement->sDrive.sChildLink, &sHeader);
+				break;
+			case INSTINCT_COMPETENCEELEMENT:
+				bValid = bValid && validImageLink(&pElement->sCompetenceElement.sParentChild.sChildLink, &sHeader);
+				break;
+			case INSTINCT_ACTIONPATTERNELEMENT:
+				bValid = bValid && validImageLink(&pElement->sActionPatternElement.sParentChild.sChildLink, &sHeader);
+				break;
+			case INSTINCT_COMPETENCE:
+				bValid = bValid && validImageChildren(&pElement->sCompetence.sChildren, sHeader.nNodeCount[INSTINCT_COMPETENCEELEMENT]);
+				break;
+			case INSTINCT_ACTIONPATTERN:
+				bValid = bValid && validImageChildren(&pElement->sActionPattern.sChildren, sHeader.nNodeCount[INSTINCT_ACTIONPATTERNELEMENT]);
+				break;
+			}
+			if (!bValid)
+				return false;
+			pElement = (PlanElement *)((unsigned char *)pElement + sHeader.uiElementSize[i]);
 		}
 	}
-}
 
+	// the image is good, so drop the current plan and take up the image
+	releasePlan();
+	_bLinked = false;
+	_bBrokenLinkID = 0;
+	_bRunningDrive = (instinctID)-1;
 
-// Count runtime pending and notify Monitor if enabled
-void PlanManager::countInProgress(PlanElement *pElement, const unsigned char bNodeType)
+	// the image was linked when it was written
+	_bSharedPlan = true;
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		if (!sHeader.nNodeCount[i])
+			continue;
+		_pPlan[i] = (PlanElement *)(pImage + sHeader.ulElementOffset[i]);
+		_nPlanSize[i] = sHeader.nNodeCount[i];
+		_nNodeCount[i] = sHeader.nNodeCount[i];
+		_pLastNode[i] = (PlanElement *)((unsigned char *)_pPlan[i] + (sHeader.nNodeCount[i] - 1) * sHeader.uiElementSize[i]);
+	}
+
+	// the arena holds the runtime values, and the index if the image has none
+	if (!allocateArena(false, sHeader.ulIndexOffset ? 0 : uiTotalSize + 1))
+		return false;
+
+	if (sHeader.ulIndexOffset)
+	{
+		_pIndex = (ElementIndexType *)(pImage + sHeader.ulIndexOffset);
+		_uiIndexSize = (unsigned int)sHeader.ulIndexSize;
+	}
+	else if (uiTotalSize)
+	{
+		// no index in the image, so build one
+		if (!growIndex(uiTotalSize + 1))
+			return false;
+		for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		{
+			PlanElement *pElement = _pPlan[i];
+			for (instinctID j = 0; j < _nNodeCount[i]; j++)
+			{
+				unsigned int uiElementID = pElement->sReferences.bRuntime_ElementID;
+				if ((uiElementID >= _uiIndexSize) && !growIndex(uiElementID + 1))
+					return false;
+				_pIndex[uiElementID].bNodeType = i;
+				_pIndex[uiElementID].bElement = j;
+				pElement = (PlanElement *)((unsigned char *)pElement + sHeader.uiElementSize[i]);
+			}
+		}
+	}
+
+	return true;
+}
+
+// Run the plan held by pPlanManager, rather than a copy of it. Only the definition of the plan is shared, and this PlanManager
+// keeps its own runtime values, so many Planners can run the same plan with just a small block of memory each.
+// The plan is linked first. It cannot be changed through this PlanManager, nor through pPlanManager while it is shared, as
+// pPlanManager counts its sharers until they release the plan. pPlanManager must not be destroyed while it is shared. Sharing
+// the plan of a PlanManager that shares it in turn shares it with the owner. Returns false if our own plan is shared,
+// or if there is not enough memory for the runtime values
+unsigned char PlanManager::sharePlan(PlanManager *pPlanManager)
+{
+	if (!pPlanManager || (pPlanManager == this) || _uiShareCount)
+		return false;
+
+	if (!pPlanManager->_bLinked)
+		pPlanManager->linkPlan();
+
+	releasePlan();
+	_pSharedFrom = pPlanManager->_pSharedFrom ? pPlanManager->_pSharedFrom : (pPlanManager->_bSharedPlan ? 0 : pPlanManager);
+	if (_pSharedFrom)
+		_pSharedFrom->_uiShareCount++;
+	_bLinked = false;
+	_bBrokenLinkID = pPlanManager->_bBrokenLinkID;
+	_bRunningDrive = (instinctID)-1;
+
+	_bSharedPlan = true;
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		_pPlan[i] = pPlanManager->_pPlan[i];
+		_pLastNode[i] = pPlanManager->_pLastNode[i];
+		_nPlanSize[i] = pPlanManager->_nNodeCount[i];
+		_nNodeCount[i] = pPlanManager->_nNodeCount[i];
+	}
+	_pIndex = pPlanManager->_pIndex;
+	_uiIndexSize = pPlanManager->_uiIndexSize;
+
+	return allocateArena(false, 0);
+}
+
+// exchange a member of this PlanManager with the same member of pPlanManager
+#define INSTINCT_SWAP_MEMBER(member) \
+	{ \
+		unsigned char bTemp[sizeof(member)]; \
+		memcpy(bTemp, &(member), sizeof(member)); \
+		memcpy(&(member), &(pPlanManager->member), sizeof(member)); \
+		memcpy(&(pPlanManager->member), bTemp, sizeof(member)); \
+	}
+
+// Swap plans with pPlanManager, so that a new plan can be built in a staging PlanManager while this one runs, and then take
+// over between two calls to runPlan(). Only pointers are exchanged - the elements, runtime values, index and arena of each plan,
+// and where its arena came from, go with the plan. pPlanManager is left holding the old plan, ready to be reset and used again.
+// With bCarryRuntime, each element of the new plan whose ElementID and node type match an element of the old plan takes the
+// runtime values of that element, just as restoreRuntimeState() would. The new plan is linked here if it has not been already,
+// though that is better done while building it. Neither plan may be shared by other PlanManagers, though either PlanManager
+// may itself share the plan of another. Call this from the thread that runs the plan
+unsigned char PlanManager::swapPlan(PlanManager *pPlanManager, const unsigned char bCarryRuntime)
+{
+	unsigned char bState[sizeof(RuntimeElement)];
+
+	if (!pPlanManager || (pPlanManager == this) || _uiShareCount || pPlanManager->_uiShareCount)
+		return false;
+
+	if (!pPlanManager->_bLinked)
+		pPlanManager->linkPlan();
+
+	// the Drive timers of both plans go back into their runtime values, to be built again when they are next needed
+	syncTimers(true);
+	pPlanManager->syncTimers(true);
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		INSTINCT_SWAP_MEMBER(_nPlanSize[i]);
+		INSTINCT_SWAP_MEMBER(_pPlan[i]);
+		INSTINCT_SWAP_MEMBER(_pLastNode[i]);
+		INSTINCT_SWAP_MEMBER(_pRuntime[i]);
+		INSTINCT_SWAP_MEMBER(_nNodeCount[i]);
+	}
+	INSTINCT_SWAP_MEMBER(_pIndex);
+	INSTINCT_SWAP_MEMBER(_uiIndexSize);
+	INSTINCT_SWAP_MEMBER(_bOwnsIndex);
+	INSTINCT_SWAP_MEMBER(_bArenaIndex);
+	INSTINCT_SWAP_MEMBER(_bSharedPlan);
+	INSTINCT_SWAP_MEMBER(_pSharedFrom);
+	INSTINCT_SWAP_MEMBER(_bLinked);
+	INSTINCT_SWAP_MEMBER(_bBrokenLinkID);
+	INSTINCT_SWAP_MEMBER(_pDriveOrder);
+	INSTINCT_SWAP_MEMBER(_pAllocator);
+	INSTINCT_SWAP_MEMBER(_pArenaBuffer);
+	INSTINCT_SWAP_MEMBER(_ulArenaBufferSize);
+	INSTINCT_SWAP_MEMBER(_pArenaMemory);
+	INSTINCT_SWAP_MEMBER(_pArena);
+	INSTINCT_SWAP_MEMBER(_ulArenaSize);
+	INSTINCT_SWAP_MEMBER(_ulArenaUsed);
+
+	if (bCarryRuntime)
+	{
+		for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		{
+			PlanElement *pElement = _pPlan[i];
+			RuntimeElement *pRuntime = _pRuntime[i];
+			for (instinctID j = 0; j < _nNodeCount[i]; j++)
+			{
+				PlanElement *pOld = pPlanManager->findElement(pElement->sReferences.bRuntime_ElementID, i);
+				if (pOld)
+				{
+					runtimeFields(pPlanManager->runtime(pOld, i), i, bState, true);
+					runtimeFields(pRuntime, i, bState, false);
+				}
+				pElement = (PlanElement *)((unsigned char *)pElement + sizeFromNodeType(i));
+				pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + runtimeSizeFromNodeType(i));
+			}
+		}
+		checkCurrentElements(); // a CE or APE may have moved to another parent
+		if (_bLinked)
+			sortDriveOrder(); // the drive priorities have changed
+	}
+
+	// any Drive of either plan may now be running, and each must list the senses of its own releasers
+	_bRunningDrive = (instinctID)-1;
+	pPlanManager->_bRunningDrive = (instinctID)-1;
+	if (_bListReleaserSenses && _bLinked)
+		listReleaserSenses();
+	if (pPlanManager->_bListReleaserSenses && pPlanManager->_bLinked)
+		pPlanManager->listReleaserSenses();
+
+	return true;
+}
+
+// true if the plan is shared with another PlanManager, or adopted from a plan image
+unsigned char PlanManager::isPlanShared(void)
+{
+	return _bSharedPlan;
+}
+
+// copy one runtime value to or from a runtime state buffer, unless pState is null
+#define INSTINCT_STATE_FIELD(field) \
+	{ \
+		if (pState) \
+		{ \
+			if (bSave) \
+				memcpy(pState + nSize, &(field), sizeof(field)); \
+			else \
+				memcpy(&(field), pState + nSize, sizeof(field)); \
+		} \
+		nSize += sizeof(field); \
+	}
+
+// Save the runtime values of an element into pState, or restore them from it, and return the number of bytes they take.
+// This is the one list of the values that change as the plan runs. The monitor flags are left out, as they are set by the user
+int PlanManager::runtimeFields(RuntimeElement *pRuntime, const unsigned char nNodeType, unsigned char *pState, const unsigned char bSave)
+{
+	int nSize = 0;
+
+	INSTINCT_STATE_FIELD(pRuntime->sCounters.uiRuntime_ExecutionCount);
+	INSTINCT_STATE_FIELD(pRuntime->sCounters.uiRuntime_SuccessCount);
+	switch (nNodeType)
+	{
+	case INSTINCT_ACTIONPATTERN:
+		INSTINCT_STATE_FIELD(pRuntime->sActionPattern.bRuntime_CurrentElementID);
+		break;
+	case INSTINCT_ACTIONPATTERNELEMENT:
+		INSTINCT_STATE_FIELD(pRuntime->sActionPatternElement.bRuntime_Status);
+		break;
+	case INSTINCT_COMPETENCE:
+		INSTINCT_STATE_FIELD(pRuntime->sCompetence.bRuntime_CurrentElementID);
+		break;
+	case INSTINCT_COMPETENCEELEMENT:
+		INSTINCT_STATE_FIELD(pRuntime->sCompetenceElement.bRuntime_Released);
+		INSTINCT_STATE_FIELD(pRuntime->sCompetenceElement.bRuntime_RetryCount);
+		INSTINCT_STATE_FIELD(pRuntime->sCompetenceElement.bRuntime_Status);
+		break;
+	case INSTINCT_DRIVE:
+		INSTINCT_STATE_FIELD(pRuntime->sDrive.bRuntime_Released);
+		INSTINCT_STATE_FIELD(pRuntime->sDrive.bRuntime_Priority);
+		INSTINCT_STATE_FIELD(pRuntime->sDrive.uiRuntime_RampIntervalCounter);
+		INSTINCT_STATE_FIELD(pRuntime->sDrive.uiRuntime_IntervalCounter);
+		INSTINCT_STATE_FIELD(pRuntime->sDrive.bRuntime_Status);
+		break;
+	case INSTINCT_ACTION:
+		INSTINCT_STATE_FIELD(pRuntime->sAction.bRuntime_CheckForComplete);
+		break;
+	}
+
+	return nSize;
+}
+
+// the number of bytes needed by saveRuntimeState()
+unsigned int PlanManager::runtimeStateSize(void)
+{
+	unsigned int uiSize = sizeof(RuntimeStateHeaderType);
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		if (_nNodeCount[i])
+			uiSize += _nNodeCount[i] * (sizeof(instinctID) + runtimeFields(_pRuntime[i], i, 0, true));
+	}
+	return uiSize;
+}
+
+// Save just the runtime values of the plan - the counters, statuses, current elements, timers and drive priorities -
+// so that restoreRuntimeState() can put a plan with the same elements back into the same state.
+// Each element is saved with its ElementID. Returns the number of bytes used, or zero if uiStateSize is too small
+unsigned int PlanManager::saveRuntimeState(unsigned char *pState, const unsigned int uiStateSize)
+{
+	RuntimeStateHeaderType sHeader;
+	unsigned int uiSize;
+
+	if (!pState || (runtimeStateSize() > uiStateSize))
+		return 0;
+
+	syncTimers(false);
+
+	sHeader.bMagic = INSTINCT_RUNTIME_STATE_MAGIC;
+	sHeader.bVersion = INSTINCT_RUNTIME_STATE_VERSION;
+	sHeader.bIDSize = sizeof(instinctID);
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		sHeader.nNodeCount[i] = _nNodeCount[i];
+	memcpy(pState, &sHeader, sizeof(RuntimeStateHeaderType));
+	uiSize = sizeof(RuntimeStateHeaderType);
+
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		PlanElement *pElement = _pPlan[i];
+		RuntimeElement *pRuntime = _pRuntime[i];
+		for (instinctID j = 0; j < _nNodeCount[i]; j++)
+		{
+			memcpy(pState + uiSize, &pElement->sReferences.bRuntime_ElementID, sizeof(instinctID));
+			uiSize += sizeof(instinctID);
+			uiSize += runtimeFields(pRuntime, i, pState + uiSize, true);
+			pElement = (PlanElement *)((unsigned char *)pElement + sizeFromNodeType(i));
+			pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + runtimeSizeFromNodeType(i));
+		}
+	}
+
+	return uiSize;
+}
+
+// Restore the runtime values saved by saveRuntimeState(). The plan must have the same elements as the plan that was saved,
+// though they may have been added in a different order. The whole buffer is checked against the plan before anything
+// is changed, and false is returned if it does not match. An Action Pattern or Competence whose current element now belongs
+// to another parent starts again from the beginning
+unsigned char PlanManager::restoreRuntimeState(const unsigned char *pState, const unsigned int uiStateSize)
+{
+	RuntimeStateHeaderType sHeader;
+	unsigned int uiSize;
+	instinctID bElementID;
+
+	if (!pState || (uiStateSize < sizeof(RuntimeStateHeaderType)))
+		return false;
+
+	memcpy(&sHeader, pState, sizeof(RuntimeStateHeaderType));
+	if ((sHeader.bMagic != INSTINCT_RUNTIME_STATE_MAGIC) || (sHeader.bVersion != INSTINCT_RUNTIME_STATE_VERSION) ||
+		(sHeader.bIDSize != sizeof(instinctID)) || (runtimeStateSize() != uiStateSize))
+		return false;
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		if (sHeader.nNodeCount[i] != _nNodeCount[i])
+			return false;
+	}
+
+	// check every ElementID is in the plan with the same node type, then restore the values
+	for (unsigned char bRestore = false; bRestore <= true; bRestore++)
+	{
+		if (bRestore)
+			_bTimersValid = false; // the Drive timers start again from the restored counters
+		uiSize = sizeof(RuntimeStateHeaderType);
+		for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		{
+			int nFieldSize = _nNodeCount[i] ? runtimeFields(_pRuntime[i], i, 0, false) : 0;
+			for (instinctID j = 0; j < _nNodeCount[i]; j++)
+			{
+				memcpy(&bElementID, pState + uiSize, sizeof(instinctID));
+				uiSize += sizeof(instinctID);
+				PlanElement *pElement = findElement(bElementID, i);
+				if (!pElement)
+					return false;
+				if (bRestore)
+					runtimeFields(runtime(pElement, i), i, (unsigned char *)pState + uiSize, false);
+				uiSize += nFieldSize;
+			}
+		}
+	}
+	checkCurrentElements();
+
+	// the drive priorities have changed, and any drive may now be running
+	if (_bLinked)
+		sortDriveOrder();
+	_bRunningDrive = (instinctID)-1;
+
+	return true;
+}
+
+// Clear the current element of any Action Pattern or Competence whose current element is not one of its own children,
+// which can happen when runtime values are carried or restored into a plan where a CE or APE has moved to another parent.
+// The statuses of its children are cleared too, so that it starts again from the beginning
+void PlanManager::checkCurrentElements(void)
+{
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+	{
+		unsigned char nChildType;
+		if (i == INSTINCT_ACTIONPATTERN)
+			nChildType = INSTINCT_ACTIONPATTERNELEMENT;
+		else if (i == INSTINCT_COMPETENCE)
+			nChildType = INSTINCT_COMPETENCEELEMENT;
+		else
+			continue;
+
+		PlanElement *pElement = _pPlan[i];
+		RuntimeElement *pRuntime = _pRuntime[i];
+		for (instinctID j = 0; j < _nNodeCount[i]; j++)
+		{
+			instinctID *pCurrentID = (i == INSTINCT_ACTIONPATTERN) ? &pRuntime->sActionPattern.bRuntime_CurrentElementID :
+				&pRuntime->sCompetence.bRuntime_CurrentElementID;
+			PlanElement *pChild = *pCurrentID ? findElement(*pCurrentID, nChildType) : 0;
+			if (*pCurrentID && (!pChild || (parentChild(pChild, nChildType)->bRuntime_ParentID != pElement->sReferences.bRuntime_ElementID)))
+			{
+				*pCurrentID = 0;
+				pChild = _pPlan[nChildType];
+				RuntimeElement *pChildRuntime = _pRuntime[nChildType];
+				for (instinctID k = 0; k < _nNodeCount[nChildType]; k++)
+				{
+					if (parentChild(pChild, nChildType)->bRuntime_ParentID == pElement->sReferences.bRuntime_ElementID)
+					{
+						if (nChildType == INSTINCT_ACTIONPATTERNELEMENT)
+							pChildRuntime->sActionPatternElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
+						else
+							pChildRuntime->sCompetenceElement.bRuntime_Status = INSTINCT_RUNTIME_NOT_TESTED;
+					}
+					pChild = (PlanElement *)((unsigned char *)pChild + sizeFromNodeType(nChildType));
+					pChildRuntime = (RuntimeElement *)((unsigned char *)pChildRuntime + runtimeSizeFromNodeType(nChildType));
+				}
+			}
+			pElement = (PlanElement *)((unsigned char *)pElement + sizeFromNodeType(i));
+			pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + runtimeSizeFromNodeType(i));
+		}
+	}
+}
+
+// Resolve the child of every Drive, Competence Element and Action Pattern Element to the type and position
+// of the child element, so that the Planner can go straight to it on every cycle rather than searching the plan.
+// Also put the Drives in priority order, and reorder the Competence Elements so that the children of each Competence sit together, sorted by priority,
+// and the Action Pattern Elements so that each Action Pattern has a single run of APE's, sorted by order.
+// Call this once the plan is loaded - the Planner will call it before the next cycle if the plan has changed since.
+// Returns false if any child cannot be found, and brokenLinkID() then returns the ID of the first such element.
+// Elements with broken links return INSTINCT_ERROR when they are executed, as before.
+// A shared plan was linked by its owner, or before it was written as an image, so then only our own Drive order is set up.
+// The same goes for our own plan while others share it, as it was linked when first shared, and their runtime values
+// are in the order of its elements, so it must not be reordered
+unsigned char PlanManager::linkPlan(void)
+{
+	PlanElement *pElement;
+	int nSize;
+
+	if (!_bSharedPlan && !_uiShareCount)
+	{
+		_bBrokenLinkID = 0;
+
+		// gather the CE's of each Competence together in priority order, and the APE's of each Action Pattern in order.
+		// The child links of the CE's and APE's are used as working space, so this must be done before they are linked
+		groupChildren(INSTINCT_COMPETENCEELEMENT, INSTINCT_COMPETENCE);
+		groupChildren(INSTINCT_ACTIONPATTERNELEMENT, INSTINCT_ACTIONPATTERN);
+
+		pElement = _pPlan[INSTINCT_DRIVE];
+		nSize = sizeFromNodeType(INSTINCT_DRIVE);
+		for (instinctID i = 0; i < _nNodeCount[INSTINCT_DRIVE]; i++)
+		{
+			linkChild(pElement->sReferences.bRuntime_ElementID, pElement->sDrive.bRuntime_ChildID, &pElement->sDrive.sChildLink);
+			pElement = (PlanElement *)((unsigned char *)pElement + nSize);
+		}
+
+		pElement = _pPlan[INSTINCT_COMPETENCEELEMENT];
+		nSize = sizeFromNodeType(INSTINCT_COMPETENCEELEMENT);
+		for (instinctID i = 0; i < _nNodeCount[INSTINCT_COMPETENCEELEMENT]; i++)
+		{
+			linkChild(pElement->sReferences.bRuntime_ElementID, pElement->sCompetenceElement.sParentChild.bRuntime_ChildID,
+				&pElement->sCompetenceElement.sParentChild.sChildLink);
+			pElement = (PlanElement *)((unsigned char *)pElement + nSize);
+		}
+
+		pElement = _pPlan[INSTINCT_ACTIONPATTERNELEMENT];
+		nSize = sizeFromNodeType(INSTINCT_ACTIONPATTERNELEMENT);
+		for (instinctID i = 0; i < _nNodeCount[INSTINCT_ACTIONPATTERNELEMENT]; i++)
+		{
+			linkChild(pElement->sReferences.bRuntime_ElementID, pElement->sActionPatternElement.sParentChild.bRuntime_ChildID,
+				&pElement->sActionPatternElement.sParentChild.sChildLink);
+			pElement = (PlanElement *)((unsigned char *)pElement + nSize);
+		}
+	}
+
+	for (instinctID i = 0; i < _nNodeCount[INSTINCT_DRIVE]; i++)
+		_pDriveOrder[i] = i;
+	sortDriveOrder();
+
+	// runtime values may have been changed by updateNode(), so the Planner must check all Drives for one that is running
+	_bRunningDrive = (instinctID)-1;
+
+	// list the senses the releasers test, so that the Planner can read them all at once
+	if (_bListReleaserSenses)
+		listReleaserSenses();
+
+	_bLinked = true;
+
+	return _bBrokenLinkID ? false : true;
+}
+
+// return the ElementID of the first element found by linkPlan() with a broken child reference, or zero if none
+instinctID PlanManager::brokenLinkID(void)
+{
+	return _bBrokenLinkID;
+}
+
+// resolve a single child reference, which must be to an Action, Action Pattern or Competence
+// record the first element that has a broken reference
+unsigned char PlanManager::linkChild(const instinctID bElementID, const instinctID bChildID, ElementIndexType *pChildLink)
+{
+	if (findChildAorAPorC(bChildID, &pChildLink->bNodeType))
+	{
+		pChildLink->bElement = _pIndex[bChildID].bElement;
+		return true;
+	}
+
+	pChildLink->bElement = 0;
+	if (!_bBrokenLinkID)
+		_bBrokenLinkID = bElementID;
+
+	return false;
+}
+
+// Reorder the plan buffer for nNodeType so that the children of each parent of nParentType are held together
+// in parent order, each group sorted by its order field while otherwise keeping the order in which they were added.
+// Children whose parent cannot be found go at the end, and are recorded as broken links.
+// Each child element's sChildLink.bElement is used to hold the position it is moving to, so no extra memory is needed.
+// The runtime values of the children move with them
+void PlanManager::groupChildren(const unsigned char nNodeType, const unsigned char nParentType)
+{
+	PlanElement *pParent;
+	PlanElement *pChild;
+	PlanElement *pElement;
+	PlanElement sTemp;
+	RuntimeElement *pChildRuntime;
+	RuntimeElement *pRuntime;
+	RuntimeElement sRuntimeTemp;
+	ChildListType *pList;
+	int nSize = sizeFromNodeType(nNodeType);
+	int nRuntimeSize = runtimeSizeFromNodeType(nNodeType);
+	int nParentSize = sizeFromNodeType(nParentType);
+	instinctID nCount = _nNodeCount[nNodeType];
+	instinctID nPosition = 0;
+	instinctID nOrphan;
+
+	// count the children of each parent
+	pParent = _pPlan[nParentType];
+	for (instinctID i = 0; i < _nNodeCount[nParentType]; i++)
+	{
+		pList = childList(pParent, nParentType);
+		pList->bFirstElement = 0;
+		pList->bElementCount = 0;
+		pParent = (PlanElement *)((unsigned char *)pParent + nParentSize);
+	}
+	pChild = _pPlan[nNodeType];
+	for (instinctID i = 0; i < nCount; i++)
+	{
+		if (pParent = findElement(parentChild(pChild, nNodeType)->bRuntime_ParentID, nParentType))
+			childList(pParent, nParentType)->bElementCount++;
+		pChild = (PlanElement *)((unsigned char *)pChild + nSize);
+	}
+
+	// allocate each parent its space in the buffer, and work out where each child will go
+	pParent = _pPlan[nParentType];
+	for (instinctID i = 0; i < _nNodeCount[nParentType]; i++)
+	{
+		pList = childList(pParent, nParentType);
+		pList->bFirstElement = nPosition;
+		nPosition += pList->bElementCount;
+		pList->bElementCount = 0;
+		pParent = (PlanElement *)((unsigned char *)pParent + nParentSize);
+	}
+	nOrphan = nPosition;
+	pChild = _pPlan[nNodeType];
+	for (instinctID i = 0; i < nCount; i++)
+	{
+		if (pParent = findElement(parentChild(pChild, nNodeType)->bRuntime_ParentID, nParentType))
+		{
+			pList = childList(pParent, nParentType);
+			parentChild(pChild, nNodeType)->sChildLink.bElement = pList->bFirstElement + pList->bElementCount++;
+		}
+		else
+		{
+			parentChild(pChild, nNodeType)->sChildLink.bElement = nOrphan++;
+			if (!_bBrokenLinkID)
+				_bBrokenLinkID = pChild->sReferences.bRuntime_ElementID;
+		}
+		pChild = (PlanElement *)((unsigned char *)pChild + nSize);
+	}
+
+	// move the children into place by swapping each one into its position, until the one arriving belongs there
+	pChild = _pPlan[nNodeType];
+	pChildRuntime = _pRuntime[nNodeType];
+	for (instinctID i = 0; i < nCount; i++)
+	{
+		instinctID nTo;
+		while ((nTo = parentChild(pChild, nNodeType)->sChildLink.bElement) != i)
+		{
+			pElement = (PlanElement *)((unsigned char *)_pPlan[nNodeType] + nTo * nSize);
+			memcpy(&sTemp, pElement, nSize);
+			memcpy(pElement, pChild, nSize);
+			memcpy(pChild, &sTemp, nSize);
+			pRuntime = (RuntimeElement *)((unsigned char *)_pRuntime[nNodeType] + nTo * nRuntimeSize);
+			memcpy(&sRuntimeTemp, pRuntime, nRuntimeSize);
+			memcpy(pRuntime, pChildRuntime, nRuntimeSize);
+			memcpy(pChildRuntime, &sRuntimeTemp, nRuntimeSize);
+		}
+		pChild = (PlanElement *)((unsigned char *)pChild + nSize);
+		pChildRuntime = (RuntimeElement *)((unsigned char *)pChildRuntime + nRuntimeSize);
+	}
+
+	// insertion sort each group of children, which keeps children with the same order in the order they were added
+	pParent = _pPlan[nParentType];
+	for (instinctID i = 0; i < _nNodeCount[nParentType]; i++)
+	{
+		pList = childList(pParent, nParentType);
+		pChild = firstChild(pParent, nParentType, nNodeType);
+		pChildRuntime = firstChildRuntime(pParent, nParentType, nNodeType);
+		for (instinctID j = 1; j < pList->bElementCount; j++)
+		{
+			instinctID k = j;
+			memcpy(&sTemp, (unsigned char *)pChild + j * nSize, nSize);
+			memcpy(&sRuntimeTemp, (unsigned char *)pChildRuntime + j * nRuntimeSize, nRuntimeSize);
+			for (; k && (childOrder((PlanElement *)((unsigned char *)pChild + (k - 1) * nSize), nNodeType) > childOrder(&sTemp, nNodeType)); k--)
+			{
+				memcpy((unsigned char *)pChild + k * nSize, (unsigned char *)pChild + (k - 1) * nSize, nSize);
+				memcpy((unsigned char *)pChildRuntime + k * nRuntimeSize, (unsigned char *)pChildRuntime + (k - 1) * nRuntimeSize, nRuntimeSize);
+			}
+			if (k != j)
+			{
+				memcpy((unsigned char *)pChild + k * nSize, &sTemp, nSize);
+				memcpy((unsigned char *)pChildRuntime + k * nRuntimeSize, &sRuntimeTemp, nRuntimeSize);
+			}
+		}
+		pParent = (PlanElement *)((unsigned char *)pParent + nParentSize);
+	}
+
+	// the children have moved, so update the index
+	pChild = _pPlan[nNodeType];
+	for (instinctID i = 0; i < nCount; i++)
+	{
+		_pIndex[pChild->sReferences.bRuntime_ElementID].bElement = i;
+		pChild = (PlanElement *)((unsigned char *)pChild + nSize);
+	}
+}
+
+// sort the Drive positions in _pDriveOrder by Runtime_Priority, highest first. Drives of the same priority stay
+// in the order they were added, so the first one we come across is tested first. Priorities change a few Drives
+// at a time, so the insertion sort only has to move those Drives
+void PlanManager::sortDriveOrder(void)
+{
+	RuntimeElement *pDrives = _pRuntime[INSTINCT_DRIVE];
+	int nSize = runtimeSizeFromNodeType(INSTINCT_DRIVE);
+
+	for (instinctID i = 1; i < _nNodeCount[INSTINCT_DRIVE]; i++)
+	{
+		instinctID bDrive = _pDriveOrder[i];
+		instinctID bPriority = ((RuntimeElement *)((unsigned char *)pDrives + bDrive * nSize))->sDrive.bRuntime_Priority;
+		instinctID j = i;
+		while (j > 0)
+		{
+			RuntimeElement *pPrevious = (RuntimeElement *)((unsigned char *)pDrives + _pDriveOrder[j - 1] * nSize);
+			if ((pPrevious->sDrive.bRuntime_Priority > bPriority) ||
+				((pPrevious->sDrive.bRuntime_Priority == bPriority) && (_pDriveOrder[j - 1] < bDrive)))
+				break;
+			_pDriveOrder[j] = _pDriveOrder[j - 1];
+			j--;
+		}
+		_pDriveOrder[j] = bDrive;
+	}
+}
+
+// ** Tickless timers. A tickless Planner holds each Drive's frequency and ramp timers as deadlines on a timer clock,
+// which processTimers() moves forward, and keeps the timers that have yet to expire in a heap, earliest deadline first.
+// The Drive runtime counters are then only brought up to date when they are read
+
+// build the timers from the Drive runtime counters, starting the timer clock again. Returns false if there is no room for them
+unsigned char PlanManager::buildTimers(void)
+{
+	instinctID nDrives = _nNodeCount[INSTINCT_DRIVE];
+	PlanElement *pElement = _pPlan[INSTINCT_DRIVE];
+	RuntimeElement *pRuntime = _pRuntime[INSTINCT_DRIVE];
+
+	if (!pElement || !pRuntime)
+		return false;
+
+	if (_nTimerDrives < nDrives)
+	{
+		DriveTimerType *pDriveTimers = (DriveTimerType *)realloc((void *)_pDriveTimers, nDrives * sizeof(DriveTimerType));
+		if (!pDriveTimers)
+			return false;
+		_pDriveTimers = pDriveTimers;
+		TimerEventType *pTimerHeap = (TimerEventType *)realloc((void *)_pTimerHeap, 2 * nDrives * sizeof(TimerEventType));
+		if (!pTimerHeap)
+			return false;
+		_pTimerHeap = pTimerHeap;
+		_nTimerDrives = nDrives;
+	}
+
+	_ulTimerClock = 0;
+	_uiTimerCount = 0;
+	for (instinctID i = 0; i < nDrives; i++)
+	{
+		DriveTimerType *pTimer = _pDriveTimers + i;
+
+		// a timer with no interval set up is never changed by processTimers(), so is left in the runtime counter.
+		// A frequency interval that has already expired has nothing left to wait for
+		pTimer->bIntervalPending = false;
+		if (pElement->sDrive.sFrequency.uiInterval && pRuntime->sDrive.uiRuntime_IntervalCounter)
+		{
+			pTimer->bIntervalPending = true;
+			pTimer->ulIntervalDeadline = pRuntime->sDrive.uiRuntime_IntervalCounter;
+			pushTimer(i, false, pTimer->ulIntervalDeadline);
+		}
+		// whereas an expired ramp interval ramps the priority on the next call to processTimers()
+		if (pElement->sDrive.sDrivePriority.uiRampInterval)
+		{
+			pTimer->ulRampDeadline = pRuntime->sDrive.uiRuntime_RampIntervalCounter;
+			pushTimer(i, true, pTimer->ulRampDeadline);
+		}
+		pElement = (PlanElement *)((unsigned char *)pElement + sizeFromNodeType(INSTINCT_DRIVE));
+		pRuntime = (RuntimeElement *)((unsigned char *)pRuntime + runtimeSizeFromNodeType(INSTINCT_DRIVE));
+	}
+	_bTimersValid = true;
+
+	return true;
+}
+
+// bring the runtime counters of every Drive up to date from the timers.
+// bRelease hands the timers back to the runtime counters, so that the counters can be changed
+void PlanManager::syncTimers(const unsigned char bRelease)
+{
+	if (!_bTimersValid)
+		return;
+
+	for (instinctID i = 0; i < _nNodeCount[INSTINCT_DRIVE]; i++)
+		syncDriveTimers(i);
+
+	if (bRelease)
+		_bTimersValid = false;
+}
+
+// bring the runtime counters of the Drive at position nDrive up to date from its timers
+void PlanManager::syncDriveTimers(const instinctID nDrive)
+{
+	PlanElement *pElement = (PlanElement *)((unsigned char *)_pPlan[INSTINCT_DRIVE] + nDrive * sizeFromNodeType(INSTINCT_DRIVE));
+	RuntimeElement *pRuntime = (RuntimeElement *)((unsigned char *)_pRuntime[INSTINCT_DRIVE] + nDrive * runtimeSizeFromNodeType(INSTINCT_DRIVE));
+	DriveTimerType *pTimer = _pDriveTimers + nDrive;
+
+	if (pElement->sDrive.sFrequency.uiInterval)
+		pRuntime->sDrive.uiRuntime_IntervalCounter = pTimer->bIntervalPending ? (unsigned int)(pTimer->ulIntervalDeadline - _ulTimerClock) : 0;
+	if (pElement->sDrive.sDrivePriority.uiRampInterval)
+		pRuntime->sDrive.uiRuntime_RampIntervalCounter = (unsigned int)(pTimer->ulRampDeadline - _ulTimerClock);
+}
+
+// add a timer to the heap. Deadlines are compared by their difference, so that the timer clock may roll over
+void PlanManager::pushTimer(const instinctID nDrive, const unsigned char bRamp, const unsigned long ulDeadline)
+{
+	unsigned int uiPos = _uiTimerCount++;
+
+	while (uiPos)
+	{
+		unsigned int uiParent = (uiPos - 1) / 2;
+		if ((long)(ulDeadline - _pTimerHeap[uiParent].ulDeadline) >= 0)
+			break;
+		_pTimerHeap[uiPos] = _pTimerHeap[uiParent];
+		uiPos = uiParent;
+	}
+	_pTimerHeap[uiPos].ulDeadline = ulDeadline;
+	_pTimerHeap[uiPos].nDrive = nDrive;
+	_pTimerHeap[uiPos].bRamp = bRamp;
+}
+
+// remove the timer with the earliest deadline from the heap
+void PlanManager::popTimer(void)
+{
+	TimerEventType sLast;
+	unsigned int uiPos = 0;
+
+	if (!_uiTimerCount)
+		return;
+
+	sLast = _pTimerHeap[--_uiTimerCount];
+	for (;;)
+	{
+		unsigned int uiChild = 2 * uiPos + 1;
+		if (uiChild >= _uiTimerCount)
+			break;
+		if ((uiChild + 1 < _uiTimerCount) && ((long)(_pTimerHeap[uiChild + 1].ulDeadline - _pTimerHeap[uiChild].ulDeadline) < 0))
+			uiChild++;
+		if ((long)(_pTimerHeap[uiChild].ulDeadline - sLast.ulDeadline) >= 0)
+			break;
+		_pTimerHeap[uiPos] = _pTimerHeap[uiChild];
+		uiPos = uiChild;
+	}
+	_pTimerHeap[uiPos] = sLast;
+}
+
+// return the releaser of a Drive or CE
+ReleaserType * PlanManager::releaser(PlanElement *pElement, const unsigned char nNodeType)
+{
+	switch (nNodeType)
+	{
+	case INSTINCT_DRIVE:
+		return &pElement->sDrive.sReleaser;
+	case INSTINCT_COMPETENCEELEMENT:
+		return &pElement->sCompetenceElement.sReleaser;
+	}
+	return 0;
+}
+
+// fill _pReleaserSenses with each senseID that is read by a Drive or CE releaser, listing each sense just once.
+// A bitmap of the senses already listed avoids searching the list
+unsigned char PlanManager::listReleaserSenses(void)
+{
+	static const unsigned char nReleaserTypes[] = { INSTINCT_DRIVE, INSTINCT_COMPETENCEELEMENT };
+	unsigned int uiMaxSense = 0;
+	unsigned int uiCount = 0;
+	unsigned char *pListed;
+
+	if (_pReleaserSenses)
+	{
+		free((void *)_pReleaserSenses);
+		_pReleaserSenses = 0;
+	}
+	_uiReleaserSenseCount = 0;
+
+	// first count the releasers that read a sense, and find the highest senseID
+	for (unsigned char t = 0; t < sizeof(nReleaserTypes); t++)
+	{
+		PlanElement *pElement = _pPlan[nReleaserTypes[t]];
+		int nSize = sizeFromNodeType(nReleaserTypes[t]);
+		for (instinctID i = 0; i < _nNodeCount[nReleaserTypes[t]]; i++)
+		{
+			ReleaserType *pReleaser = releaser(pElement, nReleaserTypes[t]);
+			if ((pReleaser->bComparator != INSTINCT_COMPARATOR_TR) && (pReleaser->bComparator != INSTINCT_COMPARATOR_FL))
+			{
+				uiCount++;
+				if (pReleaser->bSenseID > uiMaxSense)
+					uiMaxSense = pReleaser->bSenseID;
+			}
+			pElement = (PlanElement *)((unsigned char *)pElement + nSize);
+		}
+	}
+	if (!uiCount)
+		return true;
+
+	_pReleaserSenses = (senseID *)malloc(uiCount * sizeof(senseID));
+	pListed = (unsigned char *)malloc(uiMaxSense / 8 + 1);
+	if (!_pReleaserSenses || !pListed)
+	{
+		if (pListed)
+			free((void *)pListed);
+		return false;
+	}
+	memset(pListed, 0, uiMaxSense / 8 + 1);
+
+	// then list each sense the first time we come across it
+	for (unsigned char t = 0; t < sizeof(nReleaserTypes); t++)
+	{
+		PlanElement *pElement = _pPlan[nReleaserTypes[t]];
+		int nSize = sizeFromNodeType(nReleaserTypes[t]);
+		for (instinctID i = 0; i < _nNodeCount[nReleaserTypes[t]]; i++)
+		{
+			ReleaserType *pReleaser = releaser(pElement, nReleaserTypes[t]);
+			senseID nSense = pReleaser->bSenseID;
+			if ((pReleaser->bComparator != INSTINCT_COMPARATOR_TR) && (pReleaser->bComparator != INSTINCT_COMPARATOR_FL) &&
+				!(pListed[nSense / 8] & (0x01 << (nSense % 8))))
+			{
+				pListed[nSense / 8] |= (0x01 << (nSense % 8));
+				_pReleaserSenses[_uiReleaserSenseCount++] = nSense;
+			}
+			pElement = (PlanElement *)((unsigned char *)pElement + nSize);
+		}
+	}
+	free((void *)pListed);
+
+	return true;
+}
+
+// return the parent and child references of a CE or APE
+ParentChildReferences * PlanManager::parentChild(PlanElement *pElement, const unsigned char nNodeType)
+{
+	switch (nNodeType)
+	{
+	case INSTINCT_COMPETENCEELEMENT:
+		return &pElement->sCompetenceElement.sParentChild;
+	case INSTINCT_ACTIONPATTERNELEMENT:
+		return &pElement->sActionPatternElement.sParentChild;
+	}
+	return 0;
+}
+
+// return the list of children of a Competence or Action Pattern
+ChildListType * PlanManager::childList(PlanElement *pElement, const unsigned char nNodeType)
+{
+	switch (nNodeType)
+	{
+	case INSTINCT_COMPETENCE:
+		return &pElement->sCompetence.sChildren;
+	case INSTINCT_ACTIONPATTERN:
+		return &pElement->sActionPattern.sChildren;
+	}
+	return 0;
+}
+
+// return the value used to sort children within their parent - the priority of a CE, or the order of an APE
+instinctID PlanManager::childOrder(PlanElement *pElement, const unsigned char nNodeType)
 {
-	// pElement->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for pending
-	if (_pMonitor && ((_bGlobalMonitorFlags & 0x04) || (pElement->sCounters.bMonitorFlags & 0x04)))
+	switch (nNodeType)
 	{
-		PlanNode sNode;
-		int nNodeSize;
-		nNodeSize = sizeFromNodeType(bNodeType);
-		if (nNodeSize)
-		{
-			sNode.bNodeType = bNodeType;
-			memcpy(&sNode.sElement, pElement, nNodeSize);
-			_pMonitor->nodeInProgress(&sNode);
-		}
+	case INSTINCT_COMPETENCEELEMENT:
+		return pElement->sCompetenceElement.sPriority.bPriority;
+	case INSTINCT_ACTIONPATTERNELEMENT:
+		return pElement->sActionPatternElement.bOrder;
 	}
+	return 0;
 }
 
+// return a pointer to the first of the children grouped together for this element by linkPlan()
+PlanElement * PlanManager::firstChild(PlanElement *pElement, const unsigned char nNodeType, const unsigned char nChildType)
+{
+	return (PlanElement *)((unsigned char *)_pPlan[nChildType] + childList(pElement, nNodeType)->bFirstElement * sizeFromNodeType(nChildType));
+}
 
-// Count runtime fail and notify Monitor if enabled
-void PlanManager::countFail(PlanElement *pElement, const unsigned char bNodeType)
+// return a pointer to the runtime values of the first of the children grouped together for this element by linkPlan()
+RuntimeElement * PlanManager::firstChildRuntime(PlanElement *pElement, const unsigned char nNodeType, const unsigned char nChildType)
+{
+	return (RuntimeElement *)((unsigned char *)_pRuntime[nChildType] + childList(pElement, nNodeType)->bFirstElement * runtimeSizeFromNodeType(nChildType));
+}
+
+// notify pMonitor of plan execution from now on, through the MonitorAdapter
+void PlanManager::setMonitor(Monitor *pMonitor)
+{
+	_sMonitorAdapter.setMonitor(pMonitor);
+	_pMonitor = pMonitor ? &_sMonitorAdapter : 0;
+}
+
+// notify pMonitor of plan execution from now on, without copying the plan elements
+void PlanManager::setMonitor(Monitor2 *pMonitor)
+{
+	_pMonitor = pMonitor;
+}
+
+// set the monitoring flags on a node
+unsigned char PlanManager::monitorNode(const instinctID bRuntime_ElementID, const unsigned char bMonitorExecuted, const unsigned char bMonitorSuccess,
+	const unsigned char bMonitorPending, const unsigned char bMonitorFail, const unsigned char bMonitorError, const unsigned char bMonitorSense)
+{
+	PlanElement *pElement;
+	unsigned char nNodeType;
+
+	if (!_pMonitor)
+		return false;
+	pElement = findElementAndType(bRuntime_ElementID, &nNodeType);
+	if (!pElement)
+		return false;
+	runtime(pElement, nNodeType)->sCounters.bMonitorFlags = (bMonitorExecuted ? 0x01 : 0x0) | (bMonitorSuccess ? 0x02 : 0x0) | (bMonitorPending ? 0x04 : 0x0) |
+		(bMonitorFail ? 0x08 : 0x0) | (bMonitorError ? 0x10 : 0x0) | (bMonitorSense ? 0x20 : 0x0);
+	return true;
+}
+
+// set the global flags that will cause monitoring of all executions and successes
+void PlanManager::setGlobalMonitorFlags(const unsigned char bMonitorExecuted, const unsigned char bMonitorSuccess,
+	const unsigned char bMonitorPending, const unsigned char bMonitorFail, const unsigned char bMonitorError, const unsigned char bMonitorSense)
+{
+	_bGlobalMonitorFlags = (bMonitorExecuted ? 0x01 : 0x0) | (bMonitorSuccess ? 0x02 : 0x0) | (bMonitorPending ? 0x04 : 0x0) |
+		(bMonitorFail ? 0x08 : 0x0) | (bMonitorError ? 0x10 : 0x0) | (bMonitorSense ? 0x20 : 0x0);
+}
+
+// set the Drive Priority for the given element ID. Return 0 if not found, or if the plan is shared either way
+unsigned char PlanManager::setDrivePriority(const instinctID bRuntime_ElementID, const instinctID bPriority)
+{
+	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
+	if (!pDrive || _bSharedPlan || _uiShareCount)
+		return false;
+
+	pDrive->sDrive.sDrivePriority.bPriority = bPriority;
+
+	return true;
+}
+
+// set the Drive Priority for the given element ID. Return 0 if not found
+unsigned char PlanManager::setRuntimeDrivePriority(const instinctID bRuntime_ElementID, const instinctID bPriority)
+{
+	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
+	if (!pDrive)
+		return false;
+
+	runtime(pDrive, INSTINCT_DRIVE)->sDrive.bRuntime_Priority = bPriority;
+	if (_bLinked)
+		sortDriveOrder();
+
+	return true;
+}
+
+// get the Drive Priority for the given element ID. Return 0 if not found
+instinctID PlanManager::getDrivePriority(const instinctID bRuntime_ElementID)
+{
+	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
+	if (!pDrive)
+		return 0;
+
+	return pDrive->sDrive.sDrivePriority.bPriority;
+}
+
+// get the Runtime Drive Priority for the given element ID. Return 0 if not found
+instinctID PlanManager::getRuntimeDrivePriority(const instinctID bRuntime_ElementID)
+{
+	PlanElement *pDrive = findElement(bRuntime_ElementID, INSTINCT_DRIVE);
+	if (!pDrive)
+		return false;
+
+	return runtime(pDrive, INSTINCT_DRIVE)->sDrive.bRuntime_Priority;
+}
+
+// copy the counts of the work done by the Planner since the counters were last cleared
+void PlanManager::workCounters(WorkCountersType *pCounters)
+{
+	*pCounters = _sWork;
+}
+
+void PlanManager::clearWorkCounters(void)
+{
+	memset(&_sWork, 0, sizeof(_sWork));
+}
+
+// find an element based on the supplied ElementID and NodeType
+// return null pointer if no match
+PlanElement * PlanManager::findElement(const instinctID bElementID, const unsigned char nNodeType)
+{
+	_sWork.ulElementLookups++;
+	if ((bElementID >= _uiIndexSize) || (_pIndex[bElementID].bNodeType != nNodeType)) // no match
+		return 0;
+
+	return elementFromIndex(_pIndex + bElementID);
+}
+
+// return a pointer to the element described by an index entry or a child link
+// return null pointer if the entry does not hold a valid element
+PlanElement * PlanManager::elementFromIndex(const ElementIndexType *pEntry)
+{
+	int nSize;
+
+	nSize = sizeFromNodeType(pEntry->bNodeType);
+	if (!nSize) // invalid node type
+		return 0;
+
+	return (PlanElement *)((unsigned char *)_pPlan[pEntry->bNodeType] + pEntry->bElement * nSize);
+}
+
+// return a pointer to the runtime values of the element described by an index entry or a child link
+// return null pointer if the entry does not hold a valid element
+RuntimeElement * PlanManager::runtimeFromIndex(const ElementIndexType *pEntry)
+{
+	int nSize;
+
+	nSize = runtimeSizeFromNodeType(pEntry->bNodeType);
+	if (!nSize) // invalid node type
+		return 0;
+
+	return (RuntimeElement *)((unsigned char *)_pRuntime[pEntry->bNodeType] + pEntry->bElement * nSize);
+}
+
+// return a pointer to the runtime values of an element in the plan
+RuntimeElement * PlanManager::runtime(PlanElement *pElement, const unsigned char nNodeType)
+{
+	return (RuntimeElement *)((unsigned char *)_pRuntime[nNodeType] +
+		_pIndex[pElement->sReferences.bRuntime_ElementID].bElement * runtimeSizeFromNodeType(nNodeType));
+}
+
+// find an element based on the supplied ElementID
+// return null pointer if no match
+PlanElement * PlanManager::findElement(const instinctID bElementID)
+{
+	unsigned char nNodeType;
+
+	return findElementAndType(bElementID, &nNodeType);
+}
+
+// find an element based on the supplied ElementID, populate the NodeType element
+// return null pointer if no match
+PlanElement * PlanManager::findElementAndType(const instinctID bElementID, unsigned char *pNodeType)
+{
+	if (bElementID >= _uiIndexSize)
+		return 0;
+
+	*pNodeType = _pIndex[bElementID].bNodeType;
+
+	return findElement(bElementID, *pNodeType);
+}
+
+// find an Action (A), an Action Pattern (AP), or a Competence (C)
+// return pointer to the Element, and populate the NodeType
+PlanElement * PlanManager::findChildAorAPorC(const instinctID bElementID, unsigned char *pNodeType)
 {
-	// pElement->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for fail
-	if (_pMonitor && ((_bGlobalMonitorFlags & 0x08) || (pElement->sCounters.bMonitorFlags & 0x08)))
+	if (bElementID < _uiIndexSize)
 	{
-		PlanNode sNode;
-		int nNodeSize;
-		nNodeSize = sizeFromNodeType(bNodeType);
-		if (nNodeSize)
+		switch (_pIndex[bElementID].bNodeType)
 		{
-			sNode.bNodeType = bNodeType;
-			memcpy(&sNode.sElement, pElement, nNodeSize);
-			_pMonitor->nodeFail(&sNode);
+		case INSTINCT_ACTION:
+		case INSTINCT_ACTIONPATTERN:
+		case INSTINCT_COMPETENCE:
+			*pNodeType = _pIndex[bElementID].bNodeType;
+			return findElement(bElementID, *pNodeType);
 		}
 	}
+	*pNodeType = INSTINCT_NODE_TYPES; // this will always be an invalid node type (Defensive Coding!)
+
+	return 0;
+}
+
+// Count runtime execution and notify Monitor if enabled
+void PlanManager::countExecution(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char bNodeType, PlanElement *pDrive)
+{
+	pRuntime->sCounters.uiRuntime_ExecutionCount++;
+	if (_pMonitor && ((_bGlobalMonitorFlags & 0x01) || (pRuntime->sCounters.bMonitorFlags & 0x01)))
+	{
+		_sWork.ulMonitorCalls++;
+		_pMonitor->nodeExecuted(pElement, pRuntime, bNodeType, pDrive);
+	}
 }
 
+// Count runtime success and notify Monitor if enabled
+void PlanManager::countSuccess(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char bNodeType, PlanElement *pDrive)
+{
+	pRuntime->sCounters.uiRuntime_SuccessCount++;
+	if (_pMonitor && ((_bGlobalMonitorFlags & 0x02) || (pRuntime->sCounters.bMonitorFlags & 0x02)))
+	{
+		_sWork.ulMonitorCalls++;
+		_pMonitor->nodeSuccess(pElement, pRuntime, bNodeType, pDrive);
+	}
+}
 
-// Count runtime error and notify Monitor if enabled
-void PlanManager::countError(PlanElement *pElement, const unsigned char bNodeType)
+// Count runtime pending and notify Monitor if enabled
+void PlanManager::countInProgress(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char bNodeType, PlanElement *pDrive)
 {
-	// pElement->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for error
-	if (_pMonitor && ((_bGlobalMonitorFlags & 0x10) || (pElement->sCounters.bMonitorFlags & 0x10)))
+	// pRuntime->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for pending
+	if (_pMonitor && ((_bGlobalMonitorFlags & 0x04) || (pRuntime->sCounters.bMonitorFlags & 0x04)))
 	{
-		PlanNode sNode;
-		int nNodeSize;
-		nNodeSize = sizeFromNodeType(bNodeType);
-		if (nNodeSize)
-		{
-			sNode.bNodeType = bNodeType;
-			memcpy(&sNode.sElement, pElement, nNodeSize);
-			_pMonitor->nodeError(&sNode);
-		}
+		_sWork.ulMonitorCalls++;
+		_pMonitor->nodeInProgress(pElement, pRuntime, bNodeType, pDrive);
 	}
 }
 
+// Count runtime fail and notify Monitor if enabled
+void PlanManager::countFail(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char bNodeType, PlanElement *pDrive)
+{
+	// pRuntime->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for fail
+	if (_pMonitor && ((_bGlobalMonitorFlags & 0x08) || (pRuntime->sCounters.bMonitorFlags & 0x08)))
+	{
+		_sWork.ulMonitorCalls++;
+		_pMonitor->nodeFail(pElement, pRuntime, bNodeType, pDrive);
+	}
+}
 
 // Count runtime error and notify Monitor if enabled
-void PlanManager::countSense(PlanElement *pElement, ReleaserType *pReleaser, const int nSenseValue)
+void PlanManager::countError(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char bNodeType, PlanElement *pDrive)
+{
+	// pRuntime->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for error
+	if (_pMonitor && ((_bGlobalMonitorFlags & 0x10) || (pRuntime->sCounters.bMonitorFlags & 0x10)))
+	{
+		_sWork.ulMonitorCalls++;
+		_pMonitor->nodeError(pElement, pRuntime, bNodeType, pDrive);
+	}
+}
+
+// notify Monitor of a sense reading if enabled
+void PlanManager::countSense(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char bNodeType, ReleaserType *pReleaser, const int nSenseValue, PlanElement *pDrive)
 {
-	// pElement->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for sense
-	if (_pMonitor && ((_bGlobalMonitorFlags & 0x20) || (pElement->sCounters.bMonitorFlags & 0x20)))
+	// pRuntime->sCounters.uiRuntime_SuccessCount++; // currently we are not stored values for sense
+	if (_pMonitor && ((_bGlobalMonitorFlags & 0x20) || (pRuntime->sCounters.bMonitorFlags & 0x20)))
 	{
-			_pMonitor->nodeSense(pReleaser, nSenseValue);
+		_sWork.ulMonitorCalls++;
+		_pMonitor->nodeSense(pElement, pRuntime, bNodeType, pReleaser, nSenseValue, pDrive);
 	}
 }
 
@@ -644,7 +2163,168 @@ int PlanManager::sizeFromNodeType(const unsigned char bNodeType)
 		return 0;
 	}
 
-	return (nSize + sizeof(RuntimeReferences) + sizeof(RuntimeCounters));
+	// elements are stored end to end within each plan buffer, so allow for the padding
+	// the compiler places before the union, and round up to keep the next element aligned
+	nSize += offsetof(PlanElement, sActionPattern);
+
+	return (int)((nSize + INSTINCT_ALIGNOF(PlanElement) - 1) / INSTINCT_ALIGNOF(PlanElement) * INSTINCT_ALIGNOF(PlanElement));
+}
+
+// returns the memory needed for the runtime values of a node of a given type
+// returns zero on error
+int PlanManager::runtimeSizeFromNodeType(const unsigned char bNodeType)
+{
+	int nSize;
+
+	switch (bNodeType)
+	{
+	case INSTINCT_ACTION:
+		nSize = sizeof(ActionRuntimeType);
+		break;
+	case INSTINCT_ACTIONPATTERNELEMENT:
+		nSize = sizeof(ActionPatternElementRuntimeType);
+		break;
+	case INSTINCT_ACTIONPATTERN:
+		nSize = sizeof(ActionPatternRuntimeType);
+		break;
+	case INSTINCT_COMPETENCEELEMENT:
+		nSize = sizeof(CompetenceElementRuntimeType);
+		break;
+	case INSTINCT_COMPETENCE:
+		nSize = sizeof(CompetenceRuntimeType);
+		break;
+	case INSTINCT_DRIVE:
+		nSize = sizeof(DriveRuntimeType);
+		break;
+
+	default:
+		return 0;
+	}
+
+	// runtime values are stored end to end in the same way as the elements
+	nSize += offsetof(RuntimeElement, sActionPattern);
+
+	return (int)((nSize + INSTINCT_ALIGNOF(RuntimeElement) - 1) / INSTINCT_ALIGNOF(RuntimeElement) * INSTINCT_ALIGNOF(RuntimeElement));
+}
+
+// copy one runtime value between a PlanElement and its runtime values
+#define INSTINCT_RUNTIME_FIELD(elementField, runtimeField) \
+	{ \
+		if (bToElement) \
+			(elementField) = (runtimeField); \
+		else \
+			(runtimeField) = (elementField); \
+	}
+
+// Copy the runtime values of an element into the runtime fields of pElement, or the other way with bToElement clear.
+// PlanNodes hold the whole of an element in a PlanElement, so this is used whenever a node is copied in or out of the plan
+void PlanManager::copyRuntime(PlanElement *pElement, RuntimeElement *pRuntime, const unsigned char nNodeType, const unsigned char bToElement)
+{
+	INSTINCT_RUNTIME_FIELD(pElement->sCounters, pRuntime->sCounters);
+	switch (nNodeType)
+	{
+	case INSTINCT_ACTIONPATTERN:
+		INSTINCT_RUNTIME_FIELD(pElement->sActionPattern.bRuntime_CurrentElementID, pRuntime->sActionPattern.bRuntime_CurrentElementID);
+		break;
+	case INSTINCT_ACTIONPATTERNELEMENT:
+		INSTINCT_RUNTIME_FIELD(pElement->sActionPatternElement.bRuntime_Status, pRuntime->sActionPatternElement.bRuntime_Status);
+		break;
+	case INSTINCT_COMPETENCE:
+		INSTINCT_RUNTIME_FIELD(pElement->sCompetence.bRuntime_CurrentElementID, pRuntime->sCompetence.bRuntime_CurrentElementID);
+		break;
+	case INSTINCT_COMPETENCEELEMENT:
+		INSTINCT_RUNTIME_FIELD(pElement->sCompetenceElement.sReleaser.bRuntime_Released, pRuntime->sCompetenceElement.bRuntime_Released);
+		INSTINCT_RUNTIME_FIELD(pElement->sCompetenceElement.sRetry.bRuntime_RetryCount, pRuntime->sCompetenceElement.bRuntime_RetryCount);
+		INSTINCT_RUNTIME_FIELD(pElement->sCompetenceElement.bRuntime_Status, pRuntime->sCompetenceElement.bRuntime_Status);
+		break;
+	case INSTINCT_DRIVE:
+		INSTINCT_RUNTIME_FIELD(pElement->sDrive.sReleaser.bRuntime_Released, pRuntime->sDrive.bRuntime_Released);
+		INSTINCT_RUNTIME_FIELD(pElement->sDrive.sDrivePriority.bRuntime_Priority, pRuntime->sDrive.bRuntime_Priority);
+		INSTINCT_RUNTIME_FIELD(pElement->sDrive.sDrivePriority.uiRuntime_RampIntervalCounter, pRuntime->sDrive.uiRuntime_RampIntervalCounter);
+		INSTINCT_RUNTIME_FIELD(pElement->sDrive.sFrequency.uiRuntime_IntervalCounter, pRuntime->sDrive.uiRuntime_IntervalCounter);
+		INSTINCT_RUNTIME_FIELD(pElement->sDrive.bRuntime_Status, pRuntime->sDrive.bRuntime_Status);
+		break;
+	case INSTINCT_ACTION:
+		INSTINCT_RUNTIME_FIELD(pElement->sAction.bRuntime_CheckForComplete, pRuntime->sAction.bRuntime_CheckForComplete);
+		break;
+	}
+}
+
+// Monitors need not do anything at the start of a plan cycle
+void Monitor2::planCycle(const unsigned long)
+{
+}
+
+MonitorAdapter::MonitorAdapter(Monitor *pMonitor)
+{
+	_pMonitor = pMonitor;
+}
+
+void MonitorAdapter::setMonitor(Monitor *pMonitor)
+{
+	_pMonitor = pMonitor;
+}
+
+Monitor * MonitorAdapter::monitor(void)
+{
+	return _pMonitor;
+}
+
+// copy the element and its runtime values into the PlanNode that a Monitor expects
+unsigned char MonitorAdapter::copyNode(PlanNode *pPlanNode, const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType)
+{
+	int nNodeSize = PlanManager::sizeFromNodeType(bNodeType);
+	if (!_pMonitor || !nNodeSize)
+		return false;
+
+	pPlanNode->bNodeType = bNodeType;
+	memcpy(&pPlanNode->sElement, pElement, nNodeSize);
+	PlanManager::copyRuntime(&pPlanNode->sElement, (RuntimeElement *)pRuntime, bNodeType, true);
+	return true;
+}
+
+unsigned char MonitorAdapter::nodeExecuted(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *)
+{
+	PlanNode sNode;
+	return copyNode(&sNode, pElement, pRuntime, bNodeType) ? _pMonitor->nodeExecuted(&sNode) : false;
+}
+
+unsigned char MonitorAdapter::nodeSuccess(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *)
+{
+	PlanNode sNode;
+	return copyNode(&sNode, pElement, pRuntime, bNodeType) ? _pMonitor->nodeSuccess(&sNode) : false;
+}
+
+unsigned char MonitorAdapter::nodeInProgress(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *)
+{
+	PlanNode sNode;
+	return copyNode(&sNode, pElement, pRuntime, bNodeType) ? _pMonitor->nodeInProgress(&sNode) : false;
+}
+
+unsigned char MonitorAdapter::nodeFail(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *)
+{
+	PlanNode sNode;
+	return copyNode(&sNode, pElement, pRuntime, bNodeType) ? _pMonitor->nodeFail(&sNode) : false;
+}
+
+unsigned char MonitorAdapter::nodeError(const PlanElement *pElement, const RuntimeElement *pRuntime, const unsigned char bNodeType, const PlanElement *)
+{
+	PlanNode sNode;
+	return copyNode(&sNode, pElement, pRuntime, bNodeType) ? _pMonitor->nodeError(&sNode) : false;
+}
+
+// the releaser is copied so that it holds its runtime value
+unsigned char MonitorAdapter::nodeSense(const PlanElement *, const RuntimeElement *pRuntime, const unsigned char bNodeType,
+	const ReleaserType *pReleaser, const int nSenseValue, const PlanElement *)
+{
+	ReleaserType sReleaser;
+
+	if (!_pMonitor)
+		return false;
+
+	memcpy(&sReleaser, pReleaser, sizeof(ReleaserType));
+	sReleaser.bRuntime_Released = (bNodeType == INSTINCT_DRIVE) ? pRuntime->sDrive.bRuntime_Released : pRuntime->sCompetenceElement.bRuntime_Released;
+	return _pMonitor->nodeSense(&sReleaser, nSenseValue);
 }
 
 } // /namespace Instinct
\ No newline at end of file
@@ -0,0 +1,223 @@
+//  Instinct Reactive Planning Library
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include <stdafx.h>
+
+#ifndef _MSC_VER
+	#include "Arduino.h"
+#endif
+
+#include "Instinct.h"
+
+#ifdef INSTINCT_PLANNER_POOL
+
+#define INSTINCT_POOL_CHUNK_SIZE	32
+
+namespace Instinct {
+
+PlannerPool::PlannerPool(const unsigned int uiMaxPlanners, const unsigned int uiThreadCount)
+{
+	_uiMaxPlanners = uiMaxPlanners;
+	_uiPlannerCount = 0;
+	_uiThreadCount = uiThreadCount ? uiThreadCount : std::thread::hardware_concurrency();
+	if (!_uiThreadCount)
+		_uiThreadCount = 1;
+	_uiChunkSize = INSTINCT_POOL_CHUNK_SIZE;
+	_uiTime = 0;
+	_ulTick = 0;
+	_uiRunning = 0;
+	_bStop = false;
+	_ulStolenChunks = 0;
+
+	_pPlanners = (Planner **)malloc(uiMaxPlanners * sizeof(Planner *));
+	_pResults = (unsigned char *)malloc(uiMaxPlanners * sizeof(unsigned char));
+	if (!_pPlanners || !_pResults)
+		_uiMaxPlanners = 0;
+
+	_pRuns = new PlannerRunType[_uiThreadCount];
+	for (unsigned int i = 0; i < _uiThreadCount; i++)
+	{
+		_pRuns[i].uiNext = 0;
+		_pRuns[i].uiEnd = 0;
+	}
+
+	// the calling thread does its share of each step, so only start the others
+	_pThreads = _uiThreadCount > 1 ? new std::thread[_uiThreadCount - 1] : 0;
+	for (unsigned int i = 1; i < _uiThreadCount; i++)
+		_pThreads[i - 1] = std::thread(&PlannerPool::runThread, this, i);
+}
+
+PlannerPool::~PlannerPool()
+{
+	{
+		std::lock_guard<std::mutex> sLock(_sMutex);
+		_bStop = true;
+	}
+	_sStart.notify_all();
+	for (unsigned int i = 1; i < _uiThreadCount; i++)
+		_pThreads[i - 1].join();
+
+	if (_pThreads)
+		delete[] _pThreads;
+	delete[] _pRuns;
+	if (_pPlanners)
+		free((void *)_pPlanners);
+	if (_pResults)
+		free((void *)_pResults);
+}
+
+unsigned char PlannerPool::addPlanner(Planner *pPlanner)
+{
+	if (!pPlanner || _uiPlannerCount >= _uiMaxPlanners)
+		return false;
+
+	_pResults[_uiPlannerCount] = false;
+	_pPlanners[_uiPlannerCount++] = pPlanner;
+
+	return true;
+}
+
+unsigned int PlannerPool::plannerCount(void)
+{
+	return _uiPlannerCount;
+}
+
+Planner * PlannerPool::planner(const unsigned int uiPlanner)
+{
+	return uiPlanner < _uiPlannerCount ? _pPlanners[uiPlanner] : 0;
+}
+
+unsigned int PlannerPool::threadCount(void)
+{
+	return _uiThreadCount;
+}
+
+void PlannerPool::setChunkSize(const unsigned int uiChunkSize)
+{
+	_uiChunkSize = uiChunkSize ? uiChunkSize : 1;
+}
+
+unsigned char PlannerPool::planResult(const unsigned int uiPlanner)
+{
+	return uiPlanner < _uiPlannerCount ? _pResults[uiPlanner] : false;
+}
+
+unsigned long PlannerPool::stolenChunks(void)
+{
+	return _ulStolenChunks;
+}
+
+// step every Planner once, sharing them out between the threads, and return when all are done
+unsigned int PlannerPool::step(const unsigned int uiTime)
+{
+	unsigned int uiCount = 0;
+
+	// give each thread an equal run of Planners. Their positions stay fixed, so each agent's own steps
+	// happen in order from one tick to the next, whichever thread runs them
+	for (unsigned int i = 0; i < _uiThreadCount; i++)
+	{
+		_pRuns[i].uiNext.store((unsigned int)((unsigned long long)_uiPlannerCount * i / _uiThreadCount), std::memory_order_relaxed);
+		_pRuns[i].uiEnd = (unsigned int)((unsigned long long)_uiPlannerCount * (i + 1) / _uiThreadCount);
+	}
+	_uiTime = uiTime;
+
+	if (_uiThreadCount > 1)
+	{
+		// the runs are published to the other threads by the mutex
+		{
+			std::lock_guard<std::mutex> sLock(_sMutex);
+			_uiRunning = _uiThreadCount - 1;
+			_ulTick++;
+		}
+		_sStart.notify_all();
+	}
+
+	stepRuns(0);
+
+	if (_uiThreadCount > 1)
+	{
+		// wait at the barrier for the other threads to finish the tick
+		std::unique_lock<std::mutex> sLock(_sMutex);
+		while (_uiRunning)
+			_sDone.wait(sLock);
+	}
+
+	for (unsigned int i = 0; i < _uiPlannerCount; i++)
+	{
+		if (_pResults[i])
+			uiCount++;
+	}
+
+	return uiCount;
+}
+
+// wait for each tick to start, then step Planners until there are none left
+void PlannerPool::runThread(const unsigned int uiThread)
+{
+	unsigned long ulTick = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> sLock(_sMutex);
+			while (!_bStop && _ulTick == ulTick)
+				_sStart.wait(sLock);
+			if (_bStop)
+				return;
+			ulTick = _ulTick;
+		}
+
+		stepRuns(uiThread);
+
+		{
+			std::lock_guard<std::mutex> sLock(_sMutex);
+			if (!--_uiRunning)
+				_sDone.notify_one();
+		}
+	}
+}
+
+// take chunks from our own run first, then steal chunks from the runs of the other threads in turn.
+// every taker claims its chunk with a single atomic add, so no chunk is stepped twice
+void PlannerPool::stepRuns(const unsigned int uiThread)
+{
+	for (unsigned int i = 0; i < _uiThreadCount; i++)
+	{
+		PlannerRunType *pRun = _pRuns + (uiThread + i) % _uiThreadCount;
+
+		for (;;)
+		{
+			unsigned int uiStart = pRun->uiNext.fetch_add(_uiChunkSize, std::memory_order_relaxed);
+			if (uiStart >= pRun->uiEnd)
+				break;
+			unsigned int uiEnd = pRun->uiEnd - uiStart > _uiChunkSize ? uiStart + _uiChunkSize : pRun->uiEnd;
+
+			if (i)
+				_ulStolenChunks.fetch_add(1, std::memory_order_relaxed);
+
+			for (unsigned int j = uiStart; j < uiEnd; j++)
+			{
+				_pPlanners[j]->processTimers(_uiTime);
+				_pResults[j] = _pPlanners[j]->runPlan();
+			}
+		}
+	}
+}
+
+} // /namespace Instinct
+
+#endif // INSTINCT_PLANNER_POOL
@@ -0,0 +1,251 @@
+//  Instinct Reactive Planning Library
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include <stdafx.h>
+
+#ifndef _MSC_VER
+	#include "Arduino.h"
+#endif
+
+#include "Instinct.h"
+
+// checkReleasers() uses AVX2 when the compiler is allowed to (-mavx2 or -march=native), otherwise SSE2 on any x86 that has it,
+// otherwise one agent at a time. The vector code needs a 32 bit int, which Arduino AVR does not have
+#if !defined(ARDUINO) && defined(__AVX2__)
+	#define INSTINCT_RELEASER_AVX2
+	#include <immintrin.h>
+#elif !defined(ARDUINO) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define INSTINCT_RELEASER_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace Instinct {
+
+unsigned char Planner::releaserLanes(void)
+{
+#if defined(INSTINCT_RELEASER_AVX2)
+	return 8;
+#elif defined(INSTINCT_RELEASER_SSE2)
+	return 4;
+#else
+	return 1;
+#endif
+}
+
+// the same comparisons as checkReleaser(), for each agent in turn. The latch only applies hysteresis
+// if the Drive has been running, and the flex latch hysteresis is used when the Drive has been interrupted
+static unsigned int checkReleasersScalar(const ReleaserType *pReleaser, const int *pSenseValues, const unsigned char *pDriveStatus,
+	unsigned char *pReleased, unsigned char *pReleaseMask, const unsigned int uiStart, const unsigned int uiCount)
+{
+	unsigned int uiReleased = 0;
+
+	for (unsigned int i = uiStart; i < uiCount; i++)
+	{
+		int nTriggerValue = pReleaser->nSenseValue;
+		unsigned char bLatched = pReleased[i] && (pDriveStatus[i] != INSTINCT_STATUS_NOTRUNNING);
+		int nHysteresis = (pDriveStatus[i] == INSTINCT_STATUS_INTERRUPTED) ?
+			pReleaser->nSenseFlexLatchHysteresis :
+			pReleaser->nSenseHysteresis;
+		unsigned char bRelease;
+
+		switch (pReleaser->bComparator)
+		{
+		case INSTINCT_COMPARATOR_EQ:
+			bRelease = (pSenseValues[i] == nTriggerValue);
+			break;
+		case INSTINCT_COMPARATOR_NE:
+			bRelease = (pSenseValues[i] != nTriggerValue);
+			break;
+		case INSTINCT_COMPARATOR_GT:
+			if (bLatched)
+				nTriggerValue -= nHysteresis;
+			bRelease = (pSenseValues[i] > nTriggerValue);
+			break;
+		case INSTINCT_COMPARATOR_LT:
+			if (bLatched)
+				nTriggerValue += nHysteresis;
+			bRelease = (pSenseValues[i] < nTriggerValue);
+			break;
+		default:
+			bRelease = false;
+		}
+
+		pReleased[i] = bRelease ? true : false;
+		if (bRelease)
+		{
+			uiReleased++;
+			if (pReleaseMask)
+				pReleaseMask[i >> 3] |= 0x01 << (i & 0x07);
+		}
+	}
+
+	return uiReleased;
+}
+
+#if defined(INSTINCT_RELEASER_AVX2)
+// 8 agents at a time. Each lane holds one agent, and every comparison gives all ones in the lanes that are true
+static unsigned int checkReleasersVector(const ReleaserType *pReleaser, const int *pSenseValues, const unsigned char *pDriveStatus,
+	unsigned char *pReleased, unsigned char *pReleaseMask, const unsigned int uiCount, unsigned int *pDone)
+{
+	const __m256i vZero = _mm256_setzero_si256();
+	const __m256i vOnes = _mm256_set1_epi32(-1);
+	const __m256i vInterrupted = _mm256_set1_epi32(INSTINCT_STATUS_INTERRUPTED);
+	const __m256i vTrigger = _mm256_set1_epi32(pReleaser->nSenseValue);
+	const __m256i vHysteresis = _mm256_set1_epi32(pReleaser->nSenseHysteresis);
+	const __m256i vFlexHysteresis = _mm256_set1_epi32(pReleaser->nSenseFlexLatchHysteresis);
+	const __m256i vFirstBytes = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+	unsigned char bComparator = pReleaser->bComparator;
+	unsigned int uiReleased = 0;
+	unsigned int i;
+
+	for (i = 0; i + 8 <= uiCount; i += 8)
+	{
+		__m256i vSense = _mm256_loadu_si256((const __m256i *)(pSenseValues + i));
+		__m256i vRelease;
+
+		if (bComparator == INSTINCT_COMPARATOR_EQ)
+			vRelease = _mm256_cmpeq_epi32(vSense, vTrigger);
+		else if (bComparator == INSTINCT_COMPARATOR_NE)
+			vRelease = _mm256_xor_si256(_mm256_cmpeq_epi32(vSense, vTrigger), vOnes);
+		else
+		{
+			__m256i vStatus = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(pDriveStatus + i)));
+			__m256i vLatch = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(pReleased + i)));
+			// the hysteresis applies only to agents that were released, and whose Drive has been running
+			__m256i vNotLatched = _mm256_or_si256(_mm256_cmpeq_epi32(vLatch, vZero), _mm256_cmpeq_epi32(vStatus, vZero));
+			__m256i vHyst = _mm256_blendv_epi8(vHysteresis, vFlexHysteresis, _mm256_cmpeq_epi32(vStatus, vInterrupted));
+			vHyst = _mm256_andnot_si256(vNotLatched, vHyst);
+			if (bComparator == INSTINCT_COMPARATOR_GT)
+				vRelease = _mm256_cmpgt_epi32(vSense, _mm256_sub_epi32(vTrigger, vHyst));
+			else
+				vRelease = _mm256_cmpgt_epi32(_mm256_add_epi32(vTrigger, vHyst), vSense);
+		}
+
+		unsigned int uiMask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(vRelease));
+		// narrow the lanes to bytes of 0 or 1. The packs work within each 128 bit half, so bring the two halves' bytes together
+		__m256i vBytes = _mm256_packs_epi16(_mm256_packs_epi32(vRelease, vZero), vZero);
+		vBytes = _mm256_permutevar8x32_epi32(vBytes, vFirstBytes);
+		_mm_storel_epi64((__m128i *)(pReleased + i), _mm_and_si128(_mm256_castsi256_si128(vBytes), _mm_set1_epi8(1)));
+		if (pReleaseMask)
+			pReleaseMask[i >> 3] = (unsigned char)uiMask;
+		for (; uiMask; uiMask &= uiMask - 1)
+			uiReleased++;
+	}
+
+	*pDone = i;
+	return uiReleased;
+}
+#elif defined(INSTINCT_RELEASER_SSE2)
+// 4 agents at a time. Each lane holds one agent, and every comparison gives all ones in the lanes that are true
+static unsigned int checkReleasersVector(const ReleaserType *pReleaser, const int *pSenseValues, const unsigned char *pDriveStatus,
+	unsigned char *pReleased, unsigned char *pReleaseMask, const unsigned int uiCount, unsigned int *pDone)
+{
+	const __m128i vZero = _mm_setzero_si128();
+	const __m128i vOnes = _mm_set1_epi32(-1);
+	const __m128i vInterrupted = _mm_set1_epi32(INSTINCT_STATUS_INTERRUPTED);
+	const __m128i vTrigger = _mm_set1_epi32(pReleaser->nSenseValue);
+	const __m128i vHysteresis = _mm_set1_epi32(pReleaser->nSenseHysteresis);
+	const __m128i vFlexHysteresis = _mm_set1_epi32(pReleaser->nSenseFlexLatchHysteresis);
+	unsigned char bComparator = pReleaser->bComparator;
+	unsigned int uiReleased = 0;
+	unsigned int i;
+	int nBytes;
+
+	for (i = 0; i + 4 <= uiCount; i += 4)
+	{
+		__m128i vSense = _mm_loadu_si128((const __m128i *)(pSenseValues + i));
+		__m128i vRelease;
+
+		if (bComparator == INSTINCT_COMPARATOR_EQ)
+			vRelease = _mm_cmpeq_epi32(vSense, vTrigger);
+		else if (bComparator == INSTINCT_COMPARATOR_NE)
+			vRelease = _mm_xor_si128(_mm_cmpeq_epi32(vSense, vTrigger), vOnes);
+		else
+		{
+			memcpy(&nBytes, pDriveStatus + i, 4);
+			__m128i vStatus = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(nBytes), vZero), vZero);
+			memcpy(&nBytes, pReleased + i, 4);
+			__m128i vLatch = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(nBytes), vZero), vZero);
+			// the hysteresis applies only to agents that were released, and whose Drive has been running
+			__m128i vNotLatched = _mm_or_si128(_mm_cmpeq_epi32(vLatch, vZero), _mm_cmpeq_epi32(vStatus, vZero));
+			__m128i vFlex = _mm_cmpeq_epi32(vStatus, vInterrupted);
+			__m128i vHyst = _mm_or_si128(_mm_and_si128(vFlex, vFlexHysteresis), _mm_andnot_si128(vFlex, vHysteresis));
+			vHyst = _mm_andnot_si128(vNotLatched, vHyst);
+			if (bComparator == INSTINCT_COMPARATOR_GT)
+				vRelease = _mm_cmpgt_epi32(vSense, _mm_sub_epi32(vTrigger, vHyst));
+			else
+				vRelease = _mm_cmplt_epi32(vSense, _mm_add_epi32(vTrigger, vHyst));
+		}
+
+		unsigned int uiMask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(vRelease));
+		// narrow the lanes to bytes of 0 or 1
+		nBytes = _mm_cvtsi128_si32(_mm_and_si128(_mm_packs_epi16(_mm_packs_epi32(vRelease, vZero), vZero), _mm_set1_epi8(1)));
+		memcpy(pReleased + i, &nBytes, 4);
+		if (pReleaseMask)
+			pReleaseMask[i >> 3] |= (unsigned char)(uiMask << (i & 0x07));
+		for (; uiMask; uiMask &= uiMask - 1)
+			uiReleased++;
+	}
+
+	*pDone = i;
+	return uiReleased;
+}
+#endif
+
+unsigned int Planner::checkReleasers(const ReleaserType *pReleaser, const int *pSenseValues, const unsigned char *pDriveStatus,
+	unsigned char *pReleased, unsigned char *pReleaseMask, const unsigned int uiCount)
+{
+	unsigned int uiDone = 0;
+	unsigned int uiReleased = 0;
+
+	if (!pReleaser || !pReleased)
+		return 0;
+
+	if (pReleaseMask)
+		memset((void *)pReleaseMask, 0, (uiCount + 7) / 8);
+
+	// TR and FL don't need the sense values
+	if (pReleaser->bComparator == INSTINCT_COMPARATOR_TR || pReleaser->bComparator == INSTINCT_COMPARATOR_FL)
+	{
+		unsigned char bRelease = (pReleaser->bComparator == INSTINCT_COMPARATOR_TR);
+		memset((void *)pReleased, bRelease, uiCount);
+		if (pReleaseMask && bRelease)
+			memset((void *)pReleaseMask, 0xFF, (uiCount + 7) / 8);
+		uiReleased = bRelease ? uiCount : 0;
+	}
+	else
+	{
+		if (!pSenseValues || !pDriveStatus)
+			return 0;
+
+#if defined(INSTINCT_RELEASER_AVX2) || defined(INSTINCT_RELEASER_SSE2)
+		if (pReleaser->bComparator <= INSTINCT_COMPARATOR_LT)
+			uiReleased = checkReleasersVector(pReleaser, pSenseValues, pDriveStatus, pReleased, pReleaseMask, uiCount, &uiDone);
+#endif
+
+		// the agents left over, or all of them if there is no vector code
+		uiReleased += checkReleasersScalar(pReleaser, pSenseValues, pDriveStatus, pReleased, pReleaseMask, uiDone, uiCount);
+	}
+
+	// don't leave stray bits beyond the last agent in the mask
+	if (pReleaseMask && (uiCount & 0x07))
+		pReleaseMask[uiCount >> 3] &= (0x01 << (uiCount & 0x07)) - 1;
+
+	return uiReleased;
+}
+
+} // /namespace Instinct
@@ -0,0 +1,144 @@
+//  Instinct Reactive Planning Library
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include <stdafx.h>
+
+#ifndef _MSC_VER
+	#include "Arduino.h"
+#endif
+
+#include "Instinct.h"
+
+namespace Instinct {
+
+// the producer publishes a record by storing the head after writing it, and the consumer frees a record
+// by storing the tail after reading it. Each only reads the other's index
+#ifdef INSTINCT_TRACE_ATOMIC
+	#define TRACE_LOAD_OWN(index)		(index).load(std::memory_order_relaxed)
+	#define TRACE_LOAD_OTHER(index)		(index).load(std::memory_order_acquire)
+	#define TRACE_STORE(index, value)	(index).store((value), std::memory_order_release)
+#else
+	#define TRACE_LOAD_OWN(index)		(index)
+	#define TRACE_LOAD_OTHER(index)		(index)
+	#define TRACE_STORE(index, value)	((index) = (value))
+#endif
+
+// pBuffer holds uiBufferSize records, and the ring holds up to uiBufferSize - 1 of them
+TraceMonitor::TraceMonitor(TraceRecordType *pBuffer, const unsigned int uiBufferSize)
+{
+	_pBuffer = pBuffer;
+	_uiBufferSize = pBuffer ? uiBufferSize : 0;
+	TRACE_STORE(_uiHead, 0);
+	TRACE_STORE(_uiTail, 0);
+	_ulCycle = 0;
+	TRACE_STORE(_ulDropped, 0);
+}
+
+// copy the oldest record into pRecord and remove it from the ring. Returns false if there are no records
+unsigned char TraceMonitor::readRecord(TraceRecordType *pRecord)
+{
+	unsigned int uiTail = TRACE_LOAD_OWN(_uiTail);
+
+	if (uiTail == TRACE_LOAD_OTHER(_uiHead))
+		return false;
+
+	*pRecord = _pBuffer[uiTail];
+	TRACE_STORE(_uiTail, (uiTail + 1 < _uiBufferSize) ? uiTail + 1 : 0);
+
+	return true;
+}
+
+// read up to uiMaxRecords records, returning the number read
+unsigned int TraceMonitor::readRecords(TraceRecordType *pRecords, const unsigned int uiMaxRecords)
+{
+	unsigned int uiCount = 0;
+
+	while ((uiCount < uiMaxRecords) && readRecord(pRecords + uiCount))
+		uiCount++;
+
+	return uiCount;
+}
+
+// the number of records lost because the ring was full. Only the producer changes this, so either side may call it
+unsigned long TraceMonitor::droppedRecords(void)
+{
+	return TRACE_LOAD_OTHER(_ulDropped);
+}
+
+void TraceMonitor::planCycle(const unsigned long ulCycle)
+{
+	_ulCycle = ulCycle;
+}
+
+// add a record to the ring, or drop it if the ring is full
+unsigned char TraceMonitor::writeRecord(const PlanElement *pElement, const unsigned char bNodeType, const unsigned char bEvent,
+	const int nSenseValue, const PlanElement *pDrive)
+{
+	TraceRecordType *pRecord;
+	unsigned int uiHead = TRACE_LOAD_OWN(_uiHead);
+	unsigned int uiNext = (uiHead + 1 < _uiBufferSize) ? uiHead + 1 : 0;
+
+	if (!_uiBufferSize || (uiNext == TRACE_LOAD_OTHER(_uiTail)))
+	{
+		TRACE_STORE(_ulDropped, TRACE_LOAD_OWN(_ulDropped) + 1);
+		return false;
+	}
+
+	pRecord = _pBuffer + uiHead;
+	pRecord->ulCycle = _ulCycle;
+	pRecord->nSenseValue = nSenseValue;
+	pRecord->bElementID = pElement->sReferences.bRuntime_ElementID;
+	pRecord->bDriveID = pDrive ? pDrive->sReferences.bRuntime_ElementID : 0;
+	pRecord->bNodeType = bNodeType;
+	pRecord->bEvent = bEvent;
+	TRACE_STORE(_uiHead, uiNext);
+
+	return true;
+}
+
+unsigned char TraceMonitor::nodeExecuted(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const PlanElement *pDrive)
+{
+	return writeRecord(pElement, bNodeType, INSTINCT_TRACE_EXECUTED, 0, pDrive);
+}
+
+unsigned char TraceMonitor::nodeSuccess(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const PlanElement *pDrive)
+{
+	return writeRecord(pElement, bNodeType, INSTINCT_TRACE_SUCCESS, 0, pDrive);
+}
+
+unsigned char TraceMonitor::nodeInProgress(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const PlanElement *pDrive)
+{
+	return writeRecord(pElement, bNodeType, INSTINCT_TRACE_IN_PROGRESS, 0, pDrive);
+}
+
+unsigned char TraceMonitor::nodeFail(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const PlanElement *pDrive)
+{
+	return writeRecord(pElement, bNodeType, INSTINCT_TRACE_FAIL, 0, pDrive);
+}
+
+unsigned char TraceMonitor::nodeError(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const PlanElement *pDrive)
+{
+	return writeRecord(pElement, bNodeType, INSTINCT_TRACE_ERROR, 0, pDrive);
+}
+
+unsigned char TraceMonitor::nodeSense(const PlanElement *pElement, const RuntimeElement *, const unsigned char bNodeType, const ReleaserType *,
+	const int nSenseValue, const PlanElement *pDrive)
+{
+	return writeRecord(pElement, bNodeType, INSTINCT_TRACE_SENSE, nSenseValue, pDrive);
+}
+
+} // /namespace Instinct